@@ -1,44 +1,40 @@
-#version 330
+#version 460 core
 
 out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 vLocalPos;
 
-uniform sampler2D gDepth;
-uniform sampler2D gScene;
-uniform sampler2D uTransmittanceLUT;
-uniform sampler2D uMultiScatteringLUT;
+layout (binding = 0) uniform sampler2D gDepth;
+layout (binding = 4) uniform sampler2D gScene;
+layout (binding = 1) uniform sampler2D uTransmittanceLUT;
+layout (binding = 2) uniform sampler2D uMultiScatteringLUT;
+layout (binding = 5) uniform sampler2D uSkyViewLUT;
+layout (binding = 6) uniform sampler3D uFroxelScattering;    // integrated, see froxel_integrate.comp
+layout (binding = 7) uniform sampler3D uFroxelTransmittance;
+layout (binding = 8) uniform sampler2D uVolumetricScattering;    // reduced resolution raymarch, a = view depth
+layout (binding = 9) uniform sampler2D uVolumetricTransmittance;
 
-uniform sampler2DArrayShadow uShadowMap;
-uniform mat4 uCascadeMatrices[16];
-uniform int uCascadeCount;
+layout (binding = 3) uniform sampler2DArrayShadow uShadowMap;
 
-uniform vec3 viewPos; // m^-1
-uniform vec3 uLightDir;
-uniform mat4 uInvViewProj;
-uniform mat4 uLightProj;
+#include "include/frame.glsl"
+#include "include/shadow.glsl"
+#include "include/atmosphere.glsl"
 
-uniform bool uIsIBLPass;
+// the sky probe capture is its own variant (IBL_PASS defined), the branches on it fold away
+#ifdef IBL_PASS
+const bool IsIBLPass = true;
+#else
+const bool IsIBLPass = false;
+#endif
 
-uniform float exposure;
+uniform int uVolumetricMode;    // geometry pixels: 0 froxel volume, 1 raymarch here, 2/3 reduced resolution raymarch
 
-const float PI        = 3.14159265359;
-const float RGround   = 6360.0;
-const float RTop      = 6460.0;
-const float RhoAlbedo = 0.3;
+uniform mat4 uCaptureInvViewProj; // only used for the sky probe capture
 
-const vec3  RayleighScattering = vec3(5.802, 13.558, 33.1) * 0.001;
-const float RayleighAbsorption = 0.0;
-
-const float MieScattering     = 3.996 * 0.001; 
-const float MieAbsorption     = 4.40  * 0.001;
-
-const float OzoneScattering   = 0.0;
-const vec3  OzoneAbsorption   = vec3(0.650, 1.881, 0.085) * 0.001;
-
-const vec3 RayleighExtinction = RayleighScattering    + vec3(RayleighAbsorption);
-const vec3 MieExtinction      = vec3(MieScattering)   + vec3(MieAbsorption);
-const vec3 OzoneExtinction    = vec3(OzoneScattering) +      OzoneAbsorption;
+// picked in main() depending on IsIBLPass
+vec3 viewPos; // m^-1
+vec3 uLightDir;
+mat4 uInvViewProj;
 
 float IGN(vec2 uv)
 {
@@ -65,80 +61,88 @@ vec3 GetWorldPos(float depth, vec2 uv) {
     return view.xyz / view.w;
 }
 
-vec2 RaySphereIntersection(vec3 rayOrigin, vec3 rayDir, float radius)
-{
-    float a = dot(rayDir, rayDir);
-    float b = 2.0 * dot(rayOrigin, rayDir);
-    float c = dot(rayOrigin, rayOrigin) - (radius * radius);
-    float d = (b * b) - 4.0 * a * c;
-    if (d < 0.0) return vec2(-1.0);
-    float t1 = (-b - sqrt(d)) / (2.0 * a);
-    float t2 = (-b + sqrt(d)) / (2.0 * a);
-    return vec2(t1, t2);
-}
-
-vec3 GetTransmittanceFromLUT(vec3 pos, vec3 sunDir)
-{
-    float altitude = length(pos) - RGround;
-    float v = clamp(altitude / (RTop - RGround), 0.0, 1.0);
-    vec3 up = normalize(pos); 
-    float cosTheta = dot(up, normalize(sunDir));
-    float u = clamp((cosTheta + 1.0) / 2.0, 0.0, 1.0);
-    return texture(uTransmittanceLUT, vec2(u, v)).rgb;
-}
-
-vec3 GetMultiScattering(vec3 pos, float cosSunZenith)
+// slice z of the volume holds everything up to its far edge, hence the half texel shift
+void SampleFroxelVolume(vec2 uv, vec3 worldPos, out vec3 L, out vec3 T_view)
 {
-    float h = length(pos) - RGround;
-    float u = clamp((cosSunZenith + 1.0) / 2.0, 0.0, 1.0);
-    float v = clamp(h / (RTop - RGround), 0.0, 1.0);
-    return texture(uMultiScatteringLUT, vec2(u, v)).rgb;
+    float nearPlane = uFrame.Params.y;
+    float farPlane  = uFrame.Params.z;
+    float viewDepth = -(uFrame.View * vec4(worldPos, 1.0)).z;
+    float slice = log(max(viewDepth, nearPlane) / nearPlane) / log(farPlane / nearPlane) * float(FROXEL_Z);
+    vec3 coord = vec3(uv, (slice - 0.5) / float(FROXEL_Z));
+
+    L = texture(uFroxelScattering, coord).rgb;
+    T_view = texture(uFroxelTransmittance, coord).rgb;
 }
 
-float CalculateShadow(vec3 worldPos)
+// joint bilateral upsample of volumetric_march.comp, taps from another surface barely count
+void SampleLowResVolumetrics(vec2 uv, vec3 worldPos, out vec3 L, out vec3 T_view)
 {
-    float bias = 0.005; 
-    
-    for(int i = 0; i < uCascadeCount; ++i)
+    float viewDepth = -(uFrame.View * vec4(worldPos, 1.0)).z;
+    ivec2 size = textureSize(uVolumetricScattering, 0);
+    vec2 coord = uv * vec2(size) - 0.5;
+    ivec2 base = ivec2(floor(coord));
+    vec2 f = coord - vec2(base);
+
+    L = vec3(0.0);
+    T_view = vec3(0.0);
+    float totalWeight = 0.0;
+    for (int i = 0; i < 4; ++i)
     {
-        vec4 fragPosLightSpace = uCascadeMatrices[i] * vec4(worldPos, 1.0);
-        vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-        projCoords = projCoords * 0.5 + 0.5;
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 p = clamp(base + offset, ivec2(0), size - 1);
+        vec4 scattering = texelFetch(uVolumetricScattering, p, 0);
 
-        if(projCoords.x >= 0.0 && projCoords.x <= 1.0 && 
-           projCoords.y >= 0.0 && projCoords.y <= 1.0 && 
-           projCoords.z >= 0.0 && projCoords.z <= 1.0)
-        {
-            vec4 uv = vec4(projCoords.xy, i, projCoords.z - bias);
-            return texture(uShadowMap, uv);
-        }
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y / (abs(scattering.a - viewDepth) / viewDepth + 0.001);
+
+        L += scattering.rgb * weight;
+        T_view += texelFetch(uVolumetricTransmittance, p, 0).rgb * weight;
+        totalWeight += weight;
     }
 
-    return 1.0; 
+    L /= totalWeight;
+    T_view /= totalWeight;
 }
 
-float RayLeighPhase(float cosTheta) { return 3.0 * (1 + (cosTheta*cosTheta)) / (16.0 * PI); } // p_r
-float MiePhase(float cosTheta, float g) // p_m
+// inverse of the mapping in sky_view.frag
+vec3 SampleSkyViewLUT(vec3 camPosKM, vec3 rayDir, vec3 sunDir)
 {
-    float num   = (1.0 - g*g) * (1.0 + (cosTheta * cosTheta));
-    float denom = (2.0 + g*g) * pow(1.0 + g*g - 2.0 * g * cosTheta, 1.5);    
-    return (3.0 / (8.0 * PI)) * (num / denom);
+    const vec2 LUTSize = vec2(SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT);
+
+    float r = length(camPosKM);
+    vec3 up = camPosKM / r;
+    float vHorizon = sqrt(max(r * r - RGround * RGround, 0.0));
+    float beta = acos(clamp(vHorizon / r, -1.0, 1.0));
+    float zenithHorizonAngle = PI - beta;
+    float viewZenithAngle = acos(clamp(dot(rayDir, up), -1.0, 1.0));
+
+    vec2 uv;
+    if (viewZenithAngle < zenithHorizonAngle) uv.y = (1.0 - sqrt(1.0 - viewZenithAngle / zenithHorizonAngle)) * 0.5;
+    else                                      uv.y = sqrt((viewZenithAngle - zenithHorizonAngle) / beta) * 0.5 + 0.5;
+
+    vec3 rayHorizontal = rayDir - up * dot(rayDir, up);
+    vec3 sunHorizontal = sunDir - up * dot(sunDir, up);
+    float lengths = length(rayHorizontal) * length(sunHorizontal);
+    float lightViewCosAngle = lengths > 1e-6 ? dot(rayHorizontal, sunHorizontal) / lengths : 1.0;
+    uv.x = sqrt(clamp(-lightViewCosAngle * 0.5 + 0.5, 0.0, 1.0));
+
+    uv = (uv * (LUTSize - 1.0) + 0.5) / LUTSize;
+    return texture(uSkyViewLUT, uv).rgb;
 }
 
-const float IsotropicPhase = 1.0 / (4.0 * PI); // p_u
-float RayleighAltitudeDensityDistribution(float h) { return exp(-h/8.0); }
-float MieAltitudeDensityDistribution(float h) { return exp(-h/1.2); }
-float OzongAltitureDensityDistribution(float h) { return max(0.0, 1.0-(abs(h-25.0)/15.0)); }
-
 void main()
 {
+    viewPos = IsIBLPass ? vec3(0.0) : uFrame.CameraPosition.xyz;
+    uInvViewProj = IsIBLPass ? uCaptureInvViewProj : uFrame.InvViewProj;
+    uLightDir = -uFrame.SunDirection.xyz;
+
     float depthVal = texture(gDepth, TexCoords).r;
     vec3 worldPos = GetWorldPos(depthVal, TexCoords);
     vec3 rayDir = normalize(worldPos - viewPos);
 
     float ditherValue = IGN(gl_FragCoord.xy);
 
-    if (uIsIBLPass) {
+    if (IsIBLPass) {
         depthVal = 1.0;
         vec4 clip = vec4(TexCoords * 2.0 - 1.0, 1.0, 1.0);
         vec4 view = uInvViewProj * clip;
@@ -148,7 +152,7 @@ void main()
     vec3 camPosKM = viewPos * 0.001;
     camPosKM.y += RGround + 1.6;
     float sceneDistKM = length(worldPos - viewPos) * 0.001;
-    bool hitsGeometry = !uIsIBLPass && (depthVal < 1.0);
+    bool hitsGeometry = !IsIBLPass && (depthVal < 1.0);
 
     vec2 t_atmo = RaySphereIntersection(camPosKM, rayDir, RTop);
     if (t_atmo.y < 0.0) {
@@ -166,71 +170,84 @@ void main()
     vec2 t_ground = RaySphereIntersection(camPosKM, rayDir, RGround);
     if (t_ground.x > 0.0) tEnd = min(tEnd, t_ground.x);
 
-    int STEPS = hitsGeometry ? 16 : 32;
-    float dt = (tEnd - tStart) / float(STEPS);
-    vec3 currentPos = camPosKM + rayDir * (tStart + dt * 0.5);
-    float tCurrent = tStart + (dt*ditherValue);
-
     vec3 L = vec3(0.0);
     vec3 T_view = vec3(1.0);
     vec3 sunDir = normalize(uLightDir);
-    float sunE = 20.0;
 
-    float mu     = dot(rayDir, sunDir);
-    float phaseR = RayLeighPhase(mu);
-    float phaseM = MiePhase(mu, 0.8);
-    float tPrev = tStart;
-
-    for (int i = 0; i < STEPS; ++i)
+    if (!hitsGeometry)
+    {
+        // sky pixels and the probe capture, no shadows to march through so the LUT has it all
+        L = SampleSkyViewLUT(camPosKM, rayDir, sunDir);
+        T_view = t_ground.x > 0.0 ? vec3(0.0) : GetTransmittanceFromLUT(camPosKM, rayDir);
+    }
+    else if (uVolumetricMode == 0)
+    {
+        SampleFroxelVolume(TexCoords, worldPos, L, T_view);
+    }
+    else if (uVolumetricMode >= 2)
     {
-        float p = (float(i) + ditherValue) / float(STEPS);
-        float tCurrent = tStart + (tEnd - tStart) * (p * p);
-        float dt = tCurrent - tPrev;
-        dt = max(dt, 0.00001);
-        vec3 currentPos = camPosKM + rayDir * (tPrev + dt * 0.5);
+        SampleLowResVolumetrics(TexCoords, worldPos, L, T_view);
+    }
+    else
+    {
+        const int STEPS = 16;
+        float sunE = 20.0;
+
+        float mu     = dot(rayDir, sunDir);
+        float phaseR = RayLeighPhase(mu);
+        float phaseM = MiePhase(mu, 0.8);
+        float tPrev = tStart;
 
-        float h = length(currentPos) - RGround;
+        for (int i = 0; i < STEPS; ++i)
+        {
+            float p = (float(i) + ditherValue) / float(STEPS);
+            float tCurrent = tStart + (tEnd - tStart) * (p * p);
+            float dt = tCurrent - tPrev;
+            dt = max(dt, 0.00001);
+            vec3 currentPos = camPosKM + rayDir * (tPrev + dt * 0.5);
+
+            float h = length(currentPos) - RGround;
 
-        float d_r = RayleighAltitudeDensityDistribution(h);
-        float d_m = MieAltitudeDensityDistribution(h);
-        float d_o = OzongAltitureDensityDistribution(h);
+            float d_r = RayleighAltitudeDensityDistribution(h);
+            float d_m = MieAltitudeDensityDistribution(h);
+            float d_o = OzongAltitureDensityDistribution(h);
 
-        vec3 sigma_s_r = RayleighScattering * d_r;
-        vec3 sigma_s_m = vec3(MieScattering) * d_m;
-        vec3 sigma_t   = (RayleighExtinction * d_r) +
-                         (MieExtinction      * d_m) +
-                         (OzoneExtinction    * d_o);
+            vec3 sigma_s_r = RayleighScattering * d_r;
+            vec3 sigma_s_m = vec3(MieScattering) * d_m;
+            vec3 sigma_t   = (RayleighExtinction * d_r) +
+                             (MieExtinction      * d_m) +
+                             (OzoneExtinction    * d_o);
 
-        vec3 T_sun = GetTransmittanceFromLUT(currentPos, sunDir);
+            vec3 T_sun = GetTransmittanceFromLUT(currentPos, sunDir);
 
-        float distFromCamMeters = (length(currentPos - camPosKM)) * 1000.0;
-        vec3 sampleWorldPos = viewPos + (rayDir * distFromCamMeters);
+            float distFromCamMeters = (length(currentPos - camPosKM)) * 1000.0;
+            vec3 sampleWorldPos = viewPos + (rayDir * distFromCamMeters);
         
-        float lightVisibility = CalculateShadow(sampleWorldPos);
-        if (uIsIBLPass) lightVisibility = 1.0;
+            float lightVisibility = IsIBLPass ? 1.0 : CalculateShadow(sampleWorldPos);
 
-        vec3 singleScattering = (sigma_s_r * phaseR + sigma_s_m * phaseM) * T_sun * lightVisibility;
+            vec3 singleScattering = (sigma_s_r * phaseR + sigma_s_m * phaseM) * T_sun * lightVisibility;
         
-        vec3 ms = GetMultiScattering(currentPos, dot(normalize(currentPos), sunDir));
-        vec3 multiScattering = ms * (sigma_s_r + sigma_s_m);
+            vec3 ms = GetMultiScattering(currentPos, dot(normalize(currentPos), sunDir));
+            vec3 multiScattering = ms * (sigma_s_r + sigma_s_m);
 
-        vec3 S = (singleScattering + multiScattering) * sunE;
+            vec3 S = (singleScattering + multiScattering) * sunE;
 
-        L += S * T_view * dt;
-        T_view *= exp(-sigma_t * dt);
+            L += S * T_view * dt;
+            T_view *= exp(-sigma_t * dt);
         
-        tPrev = tCurrent;
+            tPrev = tCurrent;
+        }
     }
     
     vec3 sceneColor = vec3(0.0);
-    if (!uIsIBLPass) {
+    if (!IsIBLPass) {
         sceneColor = texture(gScene, TexCoords).rgb;
     }
 
     vec3 finalColor = (sceneColor * T_view) + L;
 
-    if (!uIsIBLPass) {
-        finalColor = finalColor * exposure;
+    if (!IsIBLPass) {
+        finalColor = finalColor * uFrame.Params.x;
         const float a = 2.51;
         const float b = 0.03;
         const float c = 2.43;
@@ -246,7 +263,7 @@ void main()
     float sunAngularRadius = 0.9999;
     float sunIntensity = smoothstep(sunAngularRadius, sunAngularRadius + 0.0001, sunDot);
     
-    if (sunIntensity > 0.0 && !hitsGeometry && t_ground.x < 0.0 && !uIsIBLPass)
+    if (sunIntensity > 0.0 && !hitsGeometry && t_ground.x < 0.0 && !IsIBLPass)
     {
         FragColor.rgb = FragColor.rgb + (vec3(1.0) * sunIntensity * T_view);
     }
@@ -14,6 +14,9 @@ in VS_OUT {
 uniform sampler2D uAlbedo;
 uniform sampler2D uNormal;
 uniform sampler2D uARM;
+uniform bool uPackedGBuffer; // slim layout: no position target, octahedral rg16 normals
+
+#include "include/octahedral.glsl"
 
 // https://iquilezles.org/articles/texturerepetition/
 vec4 hash4( vec2 p ) { return fract(sin(vec4( 1.0+dot(p,vec2(37.0,17.0)), 
@@ -57,7 +60,7 @@ void main()
     tNormal = normalize(tNormal * 2.0 - 1.0);
     vec3 viewNormal = normalize(fs_in.TBN * tNormal);
     
-    gNormal = vec4(viewNormal, 1.0);
+    gNormal = uPackedGBuffer ? vec4(EncodeNormal(viewNormal), 0.0, 1.0) : vec4(viewNormal, 1.0);
 
     vec3 tAlbedo = texture(uAlbedo, fs_in.TexCoords).rgb;
     vec3 tARM    = texture(uARM, fs_in.TexCoords).rgb;
@@ -1,4 +1,4 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -12,17 +12,17 @@ out VS_OUT
     mat3 TBN;
 } vs_out;
 
-uniform mat4 uView;
-uniform mat4 uProjection;
+#include "include/frame.glsl"
+
 uniform mat4 uModel;
 
 void main()
 {
-    vec4 viewPos = uView * uModel * vec4(aPos, 1.0);
+    vec4 viewPos = uFrame.View * uModel * vec4(aPos, 1.0);
     vs_out.FragPos = viewPos.xyz;
     vs_out.TexCoords = aTexCoords;
 
-    mat3 normalMatrix = transpose(inverse(mat3(uView * uModel)));
+    mat3 normalMatrix = transpose(inverse(mat3(uFrame.View * uModel)));
 
     vec3 N = normalize(normalMatrix * aNormal);
     vec3 T = normalize(normalMatrix * aTangent);
@@ -35,5 +35,5 @@ void main()
 
     vs_out.TBN = mat3(T, B, N);
 
-    gl_Position = uProjection * viewPos;
+    gl_Position = uFrame.Projection * viewPos;
 }
\ No newline at end of file
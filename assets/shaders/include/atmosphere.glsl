@@ -0,0 +1,60 @@
+// Hillaire 2020 planet and media, distances in km. transmittance.frag and multi_scattering.frag
+// build the LUTs, uTransmittanceLUT and uMultiScatteringLUT have to be declared before the include.
+// the LUTs have no mips, textureLod keeps the lookups valid in compute shaders too
+
+const float PI        = 3.14159265359;
+const float RGround   = 6360.0;
+const float RTop      = 6460.0;
+
+const vec3  RayleighScattering = vec3(5.802, 13.558, 33.1) * 0.001;
+const float MieScattering      = 3.996 * 0.001;
+const float MieAbsorption      = 4.40  * 0.001;
+const vec3  OzoneAbsorption    = vec3(0.650, 1.881, 0.085) * 0.001;
+
+const vec3 RayleighExtinction = RayleighScattering;
+const vec3 MieExtinction      = vec3(MieScattering + MieAbsorption);
+const vec3 OzoneExtinction    = OzoneAbsorption;
+
+const float IsotropicPhase = 1.0 / (4.0 * PI);
+
+vec2 RaySphereIntersection(vec3 rayOrigin, vec3 rayDir, float radius)
+{
+    float a = dot(rayDir, rayDir);
+    float b = 2.0 * dot(rayOrigin, rayDir);
+    float c = dot(rayOrigin, rayOrigin) - (radius * radius);
+    float d = (b * b) - 4.0 * a * c;
+    if (d < 0.0) return vec2(-1.0);
+    float t1 = (-b - sqrt(d)) / (2.0 * a);
+    float t2 = (-b + sqrt(d)) / (2.0 * a);
+    return vec2(t1, t2);
+}
+
+// sunDir normalized
+vec3 GetTransmittanceFromLUT(vec3 pos, vec3 sunDir)
+{
+    float altitude = length(pos) - RGround;
+    float v = clamp(altitude / (RTop - RGround), 0.0, 1.0);
+    float cosTheta = dot(normalize(pos), sunDir);
+    float u = clamp((cosTheta + 1.0) / 2.0, 0.0, 1.0);
+    return textureLod(uTransmittanceLUT, vec2(u, v), 0.0).rgb;
+}
+
+vec3 GetMultiScattering(vec3 pos, float cosSunZenith)
+{
+    float h = length(pos) - RGround;
+    float u = clamp((cosSunZenith + 1.0) / 2.0, 0.0, 1.0);
+    float v = clamp(h / (RTop - RGround), 0.0, 1.0);
+    return textureLod(uMultiScatteringLUT, vec2(u, v), 0.0).rgb;
+}
+
+float RayLeighPhase(float cosTheta) { return 3.0 * (1 + (cosTheta*cosTheta)) / (16.0 * PI); }
+float MiePhase(float cosTheta, float g)
+{
+    float num   = (1.0 - g*g) * (1.0 + (cosTheta * cosTheta));
+    float denom = (2.0 + g*g) * pow(1.0 + g*g - 2.0 * g * cosTheta, 1.5);
+    return (3.0 / (8.0 * PI)) * (num / denom);
+}
+
+float RayleighAltitudeDensityDistribution(float h) { return exp(-h/8.0); }
+float MieAltitudeDensityDistribution(float h) { return exp(-h/1.2); }
+float OzongAltitureDensityDistribution(float h) { return max(0.0, 1.0-(abs(h-25.0)/15.0)); }
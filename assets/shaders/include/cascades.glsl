@@ -0,0 +1,7 @@
+// sun shadow cascades, CascadeBlock in UniformBlocks.h. MAX_CASCADES is set by the renderer
+layout (std140, binding = 1) uniform CascadeBlock
+{
+    mat4 Matrices[MAX_CASCADES];
+    vec4 PlaneDistances[MAX_CASCADES];
+    int Count;
+} uCascades;
@@ -0,0 +1,15 @@
+// per frame constants, FrameBlock in UniformBlocks.h
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 View;
+    mat4 Projection;
+    mat4 InvView;
+    mat4 InvProjection;
+    mat4 ViewProj;
+    mat4 InvViewProj;
+    vec4 CameraPosition;
+    vec4 SunDirection;
+    vec4 SunColor;   // a = intensity
+    vec4 ScreenSize; // w, h, 1/w, 1/h
+    vec4 Params;     // x exposure, y near, z far
+} uFrame;
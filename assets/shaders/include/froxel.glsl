@@ -0,0 +1,9 @@
+// froxel volume layout, FROXEL_X/Y/Z are set by the renderer
+
+// log slices between the near and far plane, same distribution as the light clusters
+float SliceToViewDepth(float slice)
+{
+    float nearPlane = uFrame.Params.y;
+    float farPlane  = uFrame.Params.z;
+    return nearPlane * pow(farPlane / nearPlane, slice / float(FROXEL_Z));
+}
@@ -0,0 +1,36 @@
+// clustered local lights, filled by Renderer::LightCullingPass. CLUSTER_X/Y/Z are set by the renderer
+struct PointLight
+{
+    vec4 position;    // w = radius
+    vec4 color;       // a = intensity
+    vec4 attenuation; // constant, linear, quadratic, w = first shadow tile or -1
+};
+
+struct SpotLight
+{
+    vec4 position;    // w = radius
+    vec4 direction;
+    vec4 color;       // a = intensity
+    vec4 cone;        // cos inner, cos outer, constant, w = shadow tile or -1
+};
+
+struct Cluster
+{
+    uint offset;
+    uint pointCount;
+    uint spotCount;
+    uint pad;
+};
+
+layout (std430, binding = 0) readonly buffer PointLightBuffer { PointLight uPointLights[]; };
+layout (std430, binding = 1) readonly buffer SpotLightBuffer  { SpotLight uSpotLights[]; };
+layout (std430, binding = 2) readonly buffer ClusterBuffer    { Cluster uClusters[]; };
+layout (std430, binding = 3) readonly buffer LightIndexBuffer { uint uLightIndices[]; };
+
+// smooth falloff to zero at the culling radius
+float RadiusWindow(float distance, float radius)
+{
+    float x = distance / radius;
+    float w = clamp(1.0 - x * x * x * x, 0.0, 1.0);
+    return w * w;
+}
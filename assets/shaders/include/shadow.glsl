@@ -0,0 +1,24 @@
+// single tap cascade lookup for the participating media, the surfaces filter in lighting.frag.
+// needs uShadowMap (sampler2DArrayShadow) declared before the include
+#include "cascades.glsl"
+
+float CalculateShadow(vec3 worldPos)
+{
+    float bias = 0.005;
+
+    for(int i = 0; i < uCascades.Count; ++i)
+    {
+        vec4 fragPosLightSpace = uCascades.Matrices[i] * vec4(worldPos, 1.0);
+        vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+        projCoords = projCoords * 0.5 + 0.5;
+
+        if(projCoords.x >= 0.0 && projCoords.x <= 1.0 &&
+           projCoords.y >= 0.0 && projCoords.y <= 1.0 &&
+           projCoords.z >= 0.0 && projCoords.z <= 1.0)
+        {
+            return texture(uShadowMap, vec4(projCoords.xy, i, projCoords.z - bias));
+        }
+    }
+
+    return 1.0;
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 460 core
 out vec4 FragColor;
 
 in vec2 TexCoords;
@@ -8,66 +8,34 @@ uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
 uniform sampler2D gARM;
 uniform sampler2D gSSAO;
+uniform sampler2D gDepth;
+uniform bool uPackedGBuffer; // position from depth, octahedral normals
 
 // uniform samplerCube irradianceMap;
 // uniform samplerCube prefilterMap;
 // uniform sampler2D brdfLUT;
 
 uniform sampler2DArrayShadow uShadowMap;
-uniform int uCascadeCount;
-uniform float uCascadePlaneDistances[16];
-uniform mat4 uCascadeMatrices[16];
+uniform sampler2DShadow uShadowAtlas;
 
 // uniform sampler2D uPrefilteredMap;
 uniform sampler2D uTransmittanceLUT;
 uniform samplerCube uSkyProbe;
 
-#define MAX_DIR_LIGHTS 4
-#define MAX_POINT_LIGHTS 16
-#define MAX_SPOT_LIGHTS 8
+uniform bool uDebugClusters;
 
-struct DirectionalLight
-{
-    vec3 direction;
-    vec3 color;
-    float intensity;
-};
-
-struct PointLight
-{
-    vec3 position;
-    vec3 color;
-    float intensity;
-    
-    float constant;
-    float linear;
-    float quadratic;
-};
+#include "include/frame.glsl"
+#include "include/cascades.glsl"
+#include "include/lights.glsl"
+#include "include/octahedral.glsl"
 
-struct SpotLight
+struct LocalShadow
 {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float intensity;
-    
-    float constant;
-    float innerCutoff;
-    float outerCutoff;
+    mat4 viewProj;
+    vec4 atlasRect;   // xy offset, zw size in atlas uv, zero size = not rendered yet
 };
 
-uniform DirectionalLight uDirLights[MAX_DIR_LIGHTS];
-uniform PointLight uPointLights[MAX_POINT_LIGHTS];
-uniform SpotLight uSpotLights[MAX_SPOT_LIGHTS];
-
-uniform vec3  uSunDirection;
-uniform vec3  uSunColor;
-uniform float uSunIntensity;
-
-uniform int uPointLightCount;
-uniform int uSpotLightCount;
-uniform mat4 uInverseView;
-uniform mat4 uView;
+layout (std430, binding = 4) readonly buffer LocalShadowBuffer { LocalShadow uLocalShadows[]; };
 
 const float PI = 3.14159265359;
 
@@ -84,6 +52,21 @@ vec3 GetTransmittance(vec3 worldPos, vec3 lightDir)
     return texture(uTransmittanceLUT, vec2(u, v)).rgb;
 }
 
+// same log depth slicing as Renderer::LightCullingPass
+uint GetClusterIndex(vec2 uv, float viewDepth)
+{
+    float nearPlane = uFrame.Params.y;
+    float farPlane  = uFrame.Params.z;
+
+    float slice = log(max(viewDepth, nearPlane) / nearPlane) * float(CLUSTER_Z) / log(farPlane / nearPlane);
+    uvec3 cluster = uvec3(
+        min(uint(uv.x * CLUSTER_X), uint(CLUSTER_X - 1)),
+        min(uint(uv.y * CLUSTER_Y), uint(CLUSTER_Y - 1)),
+        min(uint(max(slice, 0.0)), uint(CLUSTER_Z - 1))
+    );
+    return cluster.x + cluster.y * CLUSTER_X + cluster.z * CLUSTER_X * CLUSTER_Y;
+}
+
 float D_GGX(vec3 N, vec3 H, float roughness)
 {
     float a = roughness * roughness;
@@ -143,14 +126,14 @@ vec3 CalculatePBRLighting(vec3 L, vec3 V, vec3 N, vec3 radiance, vec3 albedo, fl
 
 float SampleShadowMap(int layer, vec3 fragPosWorld, vec3 normal, vec3 lightDir)
 {
-    vec4 fragPosLightSpace = uCascadeMatrices[layer] * vec4(fragPosWorld, 1.0);
+    vec4 fragPosLightSpace = uCascades.Matrices[layer] * vec4(fragPosWorld, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
 
     if (projCoords.z > 1.0) return 0.0;
 
     float bias = max(0.005 * (1.0 - dot(normal, lightDir)), 0.0005);
-    if (layer == uCascadeCount - 1) bias *= 0.5;
+    if (layer == uCascades.Count - 1) bias *= 0.5;
     
     float currentDepth = projCoords.z;
     
@@ -175,27 +158,27 @@ float SampleShadowMap(int layer, vec3 fragPosWorld, vec3 normal, vec3 lightDir)
 
 float ShadowCalculation(vec3 fragPosWorld, vec3 normal, vec3 lightDir)
 {
-    vec4 fragPosView = uView * vec4(fragPosWorld, 1.0);
+    vec4 fragPosView = uFrame.View * vec4(fragPosWorld, 1.0);
     float depthValue = abs(fragPosView.z);
 
     int layer = -1;
-    for (int i = 0; i < uCascadeCount; ++i)
+    for (int i = 0; i < uCascades.Count; ++i)
     {
-        if (depthValue < uCascadePlaneDistances[i])
+        if (depthValue < uCascades.PlaneDistances[i].x)
         {
             layer = i;
             break;
         }
     }
-    if (layer == -1) layer = uCascadeCount - 1;
+    if (layer == -1) layer = uCascades.Count - 1;
 
     float shadow = SampleShadowMap(layer, fragPosWorld, normal, lightDir);
     float blendDistance = 20.0; 
     
-    float nextSplitDistance = uCascadePlaneDistances[layer];
+    float nextSplitDistance = uCascades.PlaneDistances[layer].x;
     float distToNextSplit = nextSplitDistance - depthValue;
 
-    if (distToNextSplit < blendDistance && layer < uCascadeCount - 1)
+    if (distToNextSplit < blendDistance && layer < uCascades.Count - 1)
     {
         float blendFactor = (blendDistance - distToNextSplit) / blendDistance;
         float nextShadow = SampleShadowMap(layer + 1, fragPosWorld, normal, lightDir);
@@ -205,10 +188,55 @@ float ShadowCalculation(vec3 fragPosWorld, vec3 normal, vec3 lightDir)
     return shadow;
 }
 
+// shadow of a point or spot light from its atlas tile. point lights have six tiles in
+// +x, -x, +y, -y, +z, -z order, the major axis of the light to fragment vector picks one
+float LocalShadowVisibility(int firstTile, vec3 lightPos, vec3 worldPos, vec3 normal, bool pointLight)
+{
+    vec3 toFrag = worldPos - lightPos;
+    int tile = firstTile;
+    if (pointLight)
+    {
+        vec3 a = abs(toFrag);
+        if (a.x >= a.y && a.x >= a.z) tile += toFrag.x > 0.0 ? 0 : 1;
+        else if (a.y >= a.z)          tile += toFrag.y > 0.0 ? 2 : 3;
+        else                          tile += toFrag.z > 0.0 ? 4 : 5;
+    }
+
+    LocalShadow shadow = uLocalShadows[tile];
+    if (shadow.atlasRect.z <= 0.0) return 1.0;
+
+    // push along the normal by about a texel at this distance, tiles are small
+    vec2 atlasTexel = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+    float texelWorld = 2.0 * length(toFrag) * atlasTexel.x / shadow.atlasRect.z;
+    vec4 clip = shadow.viewProj * vec4(worldPos + normal * texelWorld * 1.5, 1.0);
+    vec3 proj = clip.xyz / clip.w * 0.5 + 0.5;
+    if (any(lessThan(proj, vec3(0.0))) || any(greaterThan(proj, vec3(1.0)))) return 1.0;
+
+    // stay half a texel inside the tile so filtering never reads the neighbour
+    vec2 uv = shadow.atlasRect.xy + clamp(proj.xy * shadow.atlasRect.zw, atlasTexel * 0.5, shadow.atlasRect.zw - atlasTexel * 0.5);
+    return texture(uShadowAtlas, vec3(uv, proj.z));
+}
+
+vec3 ReconstructViewPos(vec2 uv, float depth)
+{
+    vec4 pos = uFrame.InvProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return pos.xyz / pos.w;
+}
+
 void main()
 {
-    vec3 fragPosView = texture(gPosition, TexCoords).rgb;
-    vec3 normalView  = normalize(texture(gNormal, TexCoords).rgb);
+    vec3 fragPosView;
+    vec3 normalView;
+    if (uPackedGBuffer)
+    {
+        fragPosView = ReconstructViewPos(TexCoords, texture(gDepth, TexCoords).r);
+        normalView  = DecodeNormal(texture(gNormal, TexCoords).rg);
+    }
+    else
+    {
+        fragPosView = texture(gPosition, TexCoords).rgb;
+        normalView  = normalize(texture(gNormal, TexCoords).rgb);
+    }
     vec3 albedo      = pow(texture(gAlbedo, TexCoords).rgb, vec3(2.2));
     vec3 ARM         = texture(gARM, TexCoords).rgb;
     float SSAO       = texture(gSSAO, TexCoords).r;
@@ -217,12 +245,12 @@ void main()
     float metallic  = ARM.b;
     float ao        = ARM.r;
 
-    vec4 worldPosRaw = uInverseView * vec4(fragPosView, 1.0);
+    vec4 worldPosRaw = uFrame.InvView * vec4(fragPosView, 1.0);
     vec3 worldPos    = worldPosRaw.xyz;
     
-    vec3 N = normalize(vec3(uInverseView * vec4(normalView, 0.0))); 
+    vec3 N = normalize(vec3(uFrame.InvView * vec4(normalView, 0.0))); 
     
-    vec3 camPos = vec3(uInverseView[3]); 
+    vec3 camPos = vec3(uFrame.InvView[3]); 
     vec3 V = normalize(camPos - worldPos);
 
     vec3 F0 = vec3(0.04); 
@@ -232,32 +260,40 @@ void main()
 
     vec3 fragPosKM = (worldPos * 0.001) + vec3(0.0, RGround, 0.0);
 
-    vec3 sunL = normalize(-uSunDirection);
+    vec3 sunL = normalize(-uFrame.SunDirection.xyz);
     vec3 sunTransmittance = GetTransmittance(fragPosKM, sunL);
     float shadow = ShadowCalculation(worldPos, N, sunL);
-    vec3 sunRadiance = uSunColor * uSunIntensity * sunTransmittance;
+    vec3 sunRadiance = uFrame.SunColor.rgb * uFrame.SunColor.a * sunTransmittance;
     vec3 lightContribution = CalculatePBRLighting(sunL, V, N, sunRadiance, albedo, roughness, metallic, F0);
     Lo += (1.0 - shadow) * lightContribution;
 
-    for(int i = 0; i < uPointLightCount; ++i)
+    Cluster cluster = uClusters[GetClusterIndex(TexCoords, -fragPosView.z)];
+
+    for(uint i = 0; i < cluster.pointCount; ++i)
     {
-        vec3 L = normalize(uPointLights[i].position - worldPos);
-        float distance = length(uPointLights[i].position - worldPos);
-        float attenuation = 1.0 / (uPointLights[i].constant + uPointLights[i].linear * distance + uPointLights[i].quadratic * (distance * distance));
-        vec3 radiance = uPointLights[i].color * uPointLights[i].intensity * attenuation;
+        PointLight light = uPointLights[uLightIndices[cluster.offset + i]];
+        vec3 L = normalize(light.position.xyz - worldPos);
+        float distance = length(light.position.xyz - worldPos);
+        float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * (distance * distance));
+        attenuation *= RadiusWindow(distance, light.position.w);
+        if (light.attenuation.w >= 0.0) attenuation *= LocalShadowVisibility(int(light.attenuation.w), light.position.xyz, worldPos, N, true);
+        vec3 radiance = light.color.rgb * light.color.a * attenuation;
         Lo += CalculatePBRLighting(L, V, N, radiance, albedo, roughness, metallic, F0);
     }
 
-    for(int i = 0; i < uSpotLightCount; ++i)
+    for(uint i = 0; i < cluster.spotCount; ++i)
     {
-        vec3 L = normalize(uSpotLights[i].position - worldPos);
-        float distance = length(uSpotLights[i].position - worldPos);
+        SpotLight light = uSpotLights[uLightIndices[cluster.offset + cluster.pointCount + i]];
+        vec3 L = normalize(light.position.xyz - worldPos);
+        float distance = length(light.position.xyz - worldPos);
         
-        float attenuation = 1.0 / (uSpotLights[i].constant + 0.09 * distance + 0.032 * (distance * distance));
-        float theta = dot(L, normalize(-uSpotLights[i].direction)); 
-        float epsilon = uSpotLights[i].innerCutoff - uSpotLights[i].outerCutoff;
-        float intensity = clamp((theta - uSpotLights[i].outerCutoff) / epsilon, 0.0, 1.0); 
-        vec3 radiance = uSpotLights[i].color * uSpotLights[i].intensity * attenuation * intensity;
+        float attenuation = 1.0 / (light.cone.z + 0.09 * distance + 0.032 * (distance * distance));
+        attenuation *= RadiusWindow(distance, light.position.w);
+        float theta = dot(L, normalize(-light.direction.xyz)); 
+        float epsilon = light.cone.x - light.cone.y;
+        float intensity = clamp((theta - light.cone.y) / epsilon, 0.0, 1.0); 
+        if (light.cone.w >= 0.0 && intensity > 0.0) intensity *= LocalShadowVisibility(int(light.cone.w), light.position.xyz, worldPos, N, false);
+        vec3 radiance = light.color.rgb * light.color.a * attenuation * intensity;
         Lo += CalculatePBRLighting(L, V, N, radiance, albedo, roughness, metallic, F0);
     }
 
@@ -265,7 +301,7 @@ void main()
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;
     
-    vec3 worldNormal = normalize(vec3(uInverseView * vec4(N, 0.0)));
+    vec3 worldNormal = normalize(vec3(uFrame.InvView * vec4(N, 0.0)));
     vec3 irradiance = textureLod(uSkyProbe, N, 5.0).rgb;
     vec3 diffuse = irradiance * albedo;
 
@@ -274,6 +310,13 @@ void main()
 
     FragColor = vec4(color, 1.0);
 
+    if (uDebugClusters)
+    {
+        float count = float(cluster.pointCount + cluster.spotCount);
+        vec3 heat = mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), clamp(count / 32.0, 0.0, 1.0));
+        FragColor = vec4(mix(color, heat, count > 0.0 ? 0.6 : 0.0), 1.0);
+    }
+
     // vec3 R = reflect(normalize(worldPos - camPos), N);
     // vec3 envColor = textureLod(uSkyProbe, R, 0.0).rgb;
     // FragColor = vec4(envColor, 1.0);
@@ -283,15 +326,15 @@ void main()
     // float depthValueDebug = abs(fragPosViewDebug.z);
 
     // int debugLayer = -1;
-    // for (int i = 0; i < uCascadeCount; ++i)
+    // for (int i = 0; i < uCascades.Count; ++i)
     // {
-    //     if (depthValueDebug < uCascadePlaneDistances[i])
+    //     if (depthValueDebug < uCascades.PlaneDistances[i].x)
     //     {
     //         debugLayer = i;
     //         break;
     //     }
     // }
-    // if (debugLayer == -1) debugLayer = uCascadeCount - 1;
+    // if (debugLayer == -1) debugLayer = uCascades.Count - 1;
 
     // vec3 colors[5];
     // colors[0] = vec3(1.0, 0.2, 0.2); // Red
@@ -302,14 +345,13 @@ void main()
     
     // vec3 debugColor = colors[debugLayer];
     // float debugBlendDist = 20.0; 
-    // float distToNextSplit = uCascadePlaneDistances[debugLayer] - depthValueDebug;
+    // float distToNextSplit = uCascades.PlaneDistances[debugLayer].x - depthValueDebug;
 
-    // if (distToNextSplit < debugBlendDist && debugLayer < uCascadeCount - 1)
+    // if (distToNextSplit < debugBlendDist && debugLayer < uCascades.Count - 1)
     // {
     //     float blendFactor = (debugBlendDist - distToNextSplit) / debugBlendDist;
     //     debugColor = mix(colors[debugLayer], colors[debugLayer + 1], blendFactor);
     // }
 
-
     // if (TexCoords.x < 0.5) FragColor = vec4(debugColor * (1.0 - (shadow * 0.5)), 1.0); 
 }
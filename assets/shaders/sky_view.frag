@@ -0,0 +1,110 @@
+#version 460 core
+
+// sky-view LUT (Hillaire 2020): inscattered luminance around the camera, azimuth relative to
+// the sun on x and view zenith on y, with extra resolution packed around the horizon.
+// no shadows and no geometry, atmosphere.frag still raymarches pixels that hit the scene.
+
+out vec3 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D uTransmittanceLUT;
+uniform sampler2D uMultiScatteringLUT;
+
+#include "include/frame.glsl"
+#include "include/atmosphere.glsl"
+
+const vec2 LUTSize = vec2(SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT); // set by the renderer
+const int STEPS = 30;
+
+void main()
+{
+    // same camera convention as atmosphere.frag, metres to km on top of the ground sphere
+    vec3 camPosKM = uFrame.CameraPosition.xyz * 0.001;
+    camPosKM.y += RGround + 1.6;
+    float r = length(camPosKM);
+
+    // texel centres cover [0, 1] exactly so the lookup in atmosphere.frag doesn't clamp
+    vec2 uv = (TexCoords * LUTSize - 0.5) / (LUTSize - 1.0);
+
+    float vHorizon = sqrt(max(r * r - RGround * RGround, 0.0));
+    float beta = acos(clamp(vHorizon / r, -1.0, 1.0));
+    float zenithHorizonAngle = PI - beta;
+
+    float viewZenithAngle;
+    if (uv.y < 0.5)
+    {
+        float coord = 1.0 - 2.0 * uv.y;
+        viewZenithAngle = zenithHorizonAngle * (1.0 - coord * coord);
+    }
+    else
+    {
+        float coord = uv.y * 2.0 - 1.0;
+        viewZenithAngle = zenithHorizonAngle + beta * coord * coord;
+    }
+
+    float lightViewCosAngle = -(uv.x * uv.x * 2.0 - 1.0);
+
+    // local frame, camera on +y and the sun in the xy plane
+    vec3 up = normalize(camPosKM);
+    float sunZenithCos = dot(up, normalize(-uFrame.SunDirection.xyz));
+    vec3 sunDir = vec3(sqrt(max(0.0, 1.0 - sunZenithCos * sunZenithCos)), sunZenithCos, 0.0);
+
+    float sinZenith = sin(viewZenithAngle);
+    float sinAzimuth = sqrt(max(0.0, 1.0 - lightViewCosAngle * lightViewCosAngle));
+    vec3 rayDir = vec3(sinZenith * lightViewCosAngle, cos(viewZenithAngle), sinZenith * sinAzimuth);
+    vec3 origin = vec3(0.0, r, 0.0);
+
+    vec2 t_atmo = RaySphereIntersection(origin, rayDir, RTop);
+    if (t_atmo.y < 0.0)
+    {
+        FragColor = vec3(0.0);
+        return;
+    }
+
+    float tStart = max(0.0, t_atmo.x);
+    float tEnd = t_atmo.y;
+    vec2 t_ground = RaySphereIntersection(origin, rayDir, RGround);
+    if (t_ground.x > 0.0) tEnd = min(tEnd, t_ground.x);
+
+    vec3 L = vec3(0.0);
+    vec3 T_view = vec3(1.0);
+    float sunE = 20.0;
+
+    float mu     = dot(rayDir, sunDir);
+    float phaseR = RayLeighPhase(mu);
+    float phaseM = MiePhase(mu, 0.8);
+    float tPrev = tStart;
+
+    for (int i = 0; i < STEPS; ++i)
+    {
+        float p = (float(i) + 0.5) / float(STEPS);
+        float tCurrent = tStart + (tEnd - tStart) * (p * p);
+        float dt = max(tCurrent - tPrev, 0.00001);
+        vec3 currentPos = origin + rayDir * (tPrev + dt * 0.5);
+
+        float h = length(currentPos) - RGround;
+
+        float d_r = RayleighAltitudeDensityDistribution(h);
+        float d_m = MieAltitudeDensityDistribution(h);
+        float d_o = OzongAltitureDensityDistribution(h);
+
+        vec3 sigma_s_r = RayleighScattering * d_r;
+        vec3 sigma_s_m = vec3(MieScattering) * d_m;
+        vec3 sigma_t   = (RayleighExtinction * d_r) +
+                         (MieExtinction      * d_m) +
+                         (OzoneExtinction    * d_o);
+
+        vec3 T_sun = GetTransmittanceFromLUT(currentPos, sunDir);
+        vec3 singleScattering = (sigma_s_r * phaseR + sigma_s_m * phaseM) * T_sun;
+
+        vec3 ms = GetMultiScattering(currentPos, dot(normalize(currentPos), sunDir));
+        vec3 multiScattering = ms * (sigma_s_r + sigma_s_m);
+
+        L += (singleScattering + multiScattering) * sunE * T_view * dt;
+        T_view *= exp(-sigma_t * dt);
+
+        tPrev = tCurrent;
+    }
+
+    FragColor = L;
+}
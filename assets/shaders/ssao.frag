@@ -1,4 +1,4 @@
-#version 330 core
+#version 460 core
 out float FragColor;
 
 in vec2 TexCoords;
@@ -6,19 +6,33 @@ in vec2 TexCoords;
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D gNoiseTexture;
+uniform sampler2D gDepth;
+uniform bool uPackedGBuffer;
 
 uniform vec3 samples[64];
 int kernelSize = 64;
 float bias = 0.025;
 
-uniform vec2 uResolution;
-uniform mat4 uProjection;
+#include "include/frame.glsl"
+#include "include/octahedral.glsl"
+
+vec3 ReconstructViewPos(vec2 uv, float depth)
+{
+    vec4 pos = uFrame.InvProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return pos.xyz / pos.w;
+}
+
+vec3 GetViewPos(vec2 uv)
+{
+	if (uPackedGBuffer) return ReconstructViewPos(uv, texture(gDepth, uv).r);
+	return texture(gPosition, uv).rgb;
+}
 
 void main()
 {
-	vec2 noiseScale = uResolution / 4.0;
-	vec3 fragPos = texture(gPosition, TexCoords).rgb;
-	vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+	vec2 noiseScale = uFrame.ScreenSize.xy / 4.0;
+	vec3 fragPos = GetViewPos(TexCoords);
+	vec3 normal = uPackedGBuffer ? DecodeNormal(texture(gNormal, TexCoords).rg) : normalize(texture(gNormal, TexCoords).rgb);
 
 	vec3 randomVec = normalize(texture(gNoiseTexture, TexCoords * noiseScale).xyz);
 	float radius = mix(0.1, 0.5, clamp(fragPos.z / 10.0, 0.0, 1.0));
@@ -34,11 +48,11 @@ void main()
 		samplePos = fragPos + samplePos * radius;
 
 		vec4 offset = vec4(samplePos, 1.0);
-		offset = uProjection * offset;
+		offset = uFrame.Projection * offset;
 		offset.xyz /= offset.w;
 		offset.xyz = offset.xyz * 0.5 + 0.5;
 
-		float sampleDepth = texture(gPosition, offset.xy).z;
+		float sampleDepth = GetViewPos(offset.xy).z;
 		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
 	}
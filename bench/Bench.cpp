@@ -0,0 +1,92 @@
+#include "Bench.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using BenchClock = std::chrono::steady_clock;
+
+static double RunBenchIterations(const BenchCase& benchCase, uint64_t iterations)
+{
+    auto start = BenchClock::now();
+    for (uint64_t i = 0; i < iterations; ++i) benchCase.Run();
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+std::vector<BenchResult> BenchSuite::Run(const BenchOptions& options)
+{
+    std::vector<BenchResult> results;
+
+    std::printf("%-44s %10s %12s %12s %12s %12s %14s\n", "case", "iters", "min ns", "p50 ns", "p95 ns", "max ns", "items/s");
+    for (const BenchCase& benchCase : m_Cases)
+    {
+        if (!options.Filter.empty() && benchCase.Name.find(options.Filter) == std::string::npos) continue;
+
+        if (benchCase.Setup) benchCase.Setup();
+
+        // one untimed pass for caches and lazy allocations, then double until a sample is long enough
+        benchCase.Run();
+        uint64_t iterations = 1;
+        while (RunBenchIterations(benchCase, iterations) < options.MinSampleMs && iterations < (1ull << 30)) iterations *= 2;
+
+        std::vector<float> samples;
+        samples.reserve(options.Samples);
+        for (int s = 0; s < options.Samples; ++s)
+        {
+            double ms = RunBenchIterations(benchCase, iterations);
+            samples.push_back((float)(ms * 1e6 / iterations));
+        }
+
+        BenchResult& result = results.emplace_back();
+        result.Name = benchCase.Name;
+        result.Items = benchCase.Items;
+        result.Iterations = iterations;
+        result.Ns = ComputeBenchmarkStats(samples);
+
+        double itemsPerSecond = benchCase.Items && result.Ns.P50 > 0.0 ? benchCase.Items * 1e9 / result.Ns.P50 : 0.0;
+        std::printf("%-44s %10llu %12.1f %12.1f %12.1f %12.1f %14.4g\n", benchCase.Name.c_str(), (unsigned long long)iterations,
+                    result.Ns.Min, result.Ns.P50, result.Ns.P95, result.Ns.Max, itemsPerSecond);
+        std::fflush(stdout);
+    }
+
+    return results;
+}
+
+bool WriteBenchResults(const std::vector<BenchResult>& results, const std::string& path)
+{
+    std::ofstream json(path);
+    if (!json.is_open())
+    {
+        std::cout << "EchoBench: could not write " << path << std::endl;
+        return false;
+    }
+
+    // case names are plain ascii, no escaping needed
+    json << "{\n  \"cases\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        json << "    { \"name\": \"" << result.Name << "\""
+             << ", \"items\": " << result.Items
+             << ", \"iterations\": " << result.Iterations
+             << ", \"samples\": " << result.Ns.Count
+             << ", \"min_ns\": " << result.Ns.Min
+             << ", \"avg_ns\": " << result.Ns.Avg
+             << ", \"p50_ns\": " << result.Ns.P50
+             << ", \"p95_ns\": " << result.Ns.P95
+             << ", \"p99_ns\": " << result.Ns.P99
+             << ", \"max_ns\": " << result.Ns.Max << " }"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+
+    if (!json.good())
+    {
+        std::cout << "EchoBench: failed writing " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "EchoBench: wrote " << path << std::endl;
+    return true;
+}
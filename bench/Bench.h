@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Core/Benchmark.h"
+
+// small harness for the EchoBench micro benchmarks. every case is calibrated to a number of
+// iterations per sample that takes at least MinSampleMs, then timed for Samples samples. stats
+// are per iteration, in ns
+
+// keeps the compiler from dropping a result that is otherwise unused
+template<typename T>
+inline void BenchKeep(const T& value)
+{
+#if defined(_MSC_VER)
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct BenchCase
+{
+    std::string Name;
+    uint64_t Items = 0;                 // work items per iteration (vertices, pixels...) for the throughput column, 0 for none
+    std::function<void()> Setup;        // once, before calibrating. may be empty
+    std::function<void()> Run;          // one iteration
+};
+
+struct BenchResult
+{
+    std::string Name;
+    uint64_t Items = 0;
+    uint64_t Iterations = 0;            // per sample
+    BenchmarkStats Ns;                  // per iteration
+};
+
+struct BenchOptions
+{
+    std::string Filter;                 // substring of the case name
+    int Samples = 30;
+    double MinSampleMs = 10.0;
+    std::string OutputPath;             // JSON, nothing written when empty
+    bool List = false;
+    bool UseGL = true;                  // cases that need a context are skipped without one
+};
+
+class BenchSuite
+{
+
+public:
+    void Add(BenchCase benchCase) { m_Cases.push_back(std::move(benchCase)); }
+
+    // runs the cases matching the filter in the order they were added, prints a row per case
+    std::vector<BenchResult> Run(const BenchOptions& options);
+
+    const std::vector<BenchCase>& GetCases() const { return m_Cases; }
+
+private:
+    std::vector<BenchCase> m_Cases;
+};
+
+bool WriteBenchResults(const std::vector<BenchResult>& results, const std::string& path);
@@ -0,0 +1,316 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "Bench.h"
+#include "Generators.h"
+
+#include "Core/HeadlessContext.h"
+#include "Core/LaunchOptions.h"
+#include "Renderer/Renderer.h"
+#include "Renderer/RenderTexture.h"
+#include "Renderer/Shader.h"
+#include "Resources/OBJLoader.h"
+#include "Resources/TextureCache.h"
+#include "Resources/TextureMips.h"
+
+// micro benchmarks of the cpu hot paths, all inputs generated (see Generators.h). run from the
+// repository root, the shader cases compile assets/shaders. the GL cases need a context and are
+// skipped without one (or with --no-gl)
+
+static void PrintBenchUsage(const char* program)
+{
+    std::cout
+        << "usage: " << program << " [options]\n"
+        << "  --filter <text>     only cases with text in their name\n"
+        << "  --samples <n>       timed samples per case (30)\n"
+        << "  --min-time <ms>     shortest sample, iterations are doubled until reached (10)\n"
+        << "  --output <json>     write the results\n"
+        << "  --list              print the case names and exit\n"
+        << "  --no-gl             skip the cases that need a GL context" << std::endl;
+}
+
+// the loader reports every file it loads, that would be most of the output
+struct BenchMuteOutput
+{
+    std::ostringstream Sink;
+    std::streambuf* Previous = std::cout.rdbuf(Sink.rdbuf());
+    ~BenchMuteOutput() { std::cout.rdbuf(Previous); }
+};
+
+static void AddMeshCases(BenchSuite& suite)
+{
+    for (int grid : { 32, 128, 512 })
+    {
+        auto path = std::make_shared<std::string>();
+        suite.Add({ "OBJLoader::Load " + std::to_string(grid) + "^2 grid", (uint64_t)(grid + 1) * (grid + 1),
+            [path, grid] { *path = WriteGeneratedOBJ(grid, 4); },
+            [path] {
+                BenchMuteOutput mute;
+                LoadResult result = OBJLoader::Load(*path);
+                BenchKeep(result.mesh->Vertices.size());
+            } });
+    }
+
+    for (int grid : { 128, 512 })
+    {
+        auto mesh = std::make_shared<std::shared_ptr<Mesh>>();
+        const uint64_t triangles = (uint64_t)grid * grid * 2;
+        auto setup = [mesh, grid] { *mesh = GenerateGridMesh(grid, 4); };
+
+        suite.Add({ "Mesh::RecalculateNormals " + std::to_string(grid) + "^2", triangles, setup,
+            [mesh] { (*mesh)->RecalculateNormals(); BenchKeep((*mesh)->Vertices[0].Normal); } });
+        suite.Add({ "Mesh::RecalculateTangents " + std::to_string(grid) + "^2", triangles, setup,
+            [mesh] { (*mesh)->RecalculateTangents(); BenchKeep((*mesh)->Vertices[0].Tangent); } });
+        suite.Add({ "Mesh::CalculateSubMeshBounds " + std::to_string(grid) + "^2", triangles * 3, setup,
+            [mesh] {
+                Mesh& m = **mesh;
+                for (SubMesh& subMesh : m.SubMeshes) m.CalculateSubMeshBoundsAndCenter(subMesh, m);
+                BenchKeep(m.SubMeshes[0].LocalRadius);
+            } });
+    }
+}
+
+// BlitChannel is private, it is reached through SetRough. both setters take their texture by value
+static void AddMaterialCases(BenchSuite& suite)
+{
+    const int size = 1024;
+    auto ao = std::make_shared<Texture>();
+    auto rough = std::make_shared<Texture>();
+    auto metal = std::make_shared<Texture>();
+    auto material = std::make_shared<Material>();
+    auto setup = [=] {
+        if (ao->GetData()) return;
+        *ao = GenerateTexture(size, size, 1, 1);
+        *rough = GenerateTexture(size, size, 1, 2);
+        *metal = GenerateTexture(size, size, 3, 3);
+    };
+    const uint64_t pixels = (uint64_t)size * size;
+
+    suite.Add({ "Texture copy 1024^2 r8 (setter overhead)", pixels, setup,
+        [=] { Texture copy = CopyTexture(*rough); BenchKeep(copy.GetData()); } });
+    suite.Add({ "Material::SetRough 1024^2 (BlitChannel)", pixels, setup,
+        [=] { material->SetRough(CopyTexture(*rough)); BenchKeep(material->ARMTexture->GetData()); } });
+    suite.Add({ "Material::PackARM 1024^2", pixels, setup,
+        [=] {
+            material->PackARM(CopyTexture(*ao), CopyTexture(*rough), CopyTexture(*metal));
+            BenchKeep(material->ARMTexture->GetData());
+        } });
+}
+
+// 4K like the textures of the heavy scenes. each kind once with the vector paths and once without
+static void AddTextureCases(BenchSuite& suite)
+{
+    const int size = 4096;
+    auto rgba = std::make_shared<Texture>();
+    auto rgb = std::make_shared<Texture>();
+    auto setup = [=] {
+        if (rgba->GetData()) return;
+        *rgba = GenerateTexture(size, size, 4, 4);
+        *rgb = GenerateTexture(size, size, 3, 5);
+    };
+    const uint64_t pixels = (uint64_t)size * size;
+
+    const std::pair<const char*, MipSettings> kinds[] = {
+        { "albedo rgba", { TextureUsage::Albedo, false } },
+        { "albedo rgba, coverage", { TextureUsage::Albedo, true } },
+        { "normal rgba", { TextureUsage::Normal, false } },
+    };
+    for (bool simd : { false, true })
+    {
+        const std::string path = simd ? (IsMipAvx2Available() ? " (avx2)" : " (sse2)") : " (scalar)";
+        for (const auto& [name, settings] : kinds)
+        {
+            suite.Add({ std::string("BuildMipChain 4096^2 ") + name + path, pixels, setup,
+                [=, settings = settings] {
+                    SetMipSimd(simd);
+                    BenchKeep(BuildMipChain(rgba->GetData(), size, size, 4, settings).size());
+                    SetMipSimd(true);
+                } });
+        }
+        suite.Add({ "BuildMipChain 4096^2 data rgb" + path, pixels, setup,
+            [=] {
+                SetMipSimd(simd);
+                BenchKeep(BuildMipChain(rgb->GetData(), size, size, 3, MipSettings()).size());
+                SetMipSimd(true);
+            } });
+    }
+
+    // what a cache hit costs besides reading the file
+    suite.Add({ "TextureCache::GetKey 4096^2 rgba", pixels, setup,
+        [=] { BenchKeep(TextureCache::GetKey(rgba->GetData(), size, size, 4, MipSettings())); } });
+}
+
+// UpdateTransform is private, SetPosition is the thinnest public path to it
+static void AddSceneCases(BenchSuite& suite)
+{
+    const int entityCount = 10000;
+    auto entities = std::make_shared<std::vector<std::unique_ptr<Entity>>>();
+    auto queue = std::make_shared<std::vector<DrawCmd>>();
+    auto built = std::make_shared<std::vector<DrawCmd>>();
+    auto sorted = std::make_shared<std::vector<DrawCmd>>();
+    auto camera = std::make_shared<Camera>(glm::vec3(0.0f, 20.0f, -300.0f), 90.0f, -10.0f);
+
+    auto setup = [=] {
+        if (!entities->empty()) return;
+        *entities = GenerateEntities(entityCount, GenerateGridMesh(16, 8), 500.0f);
+        for (const auto& entity : *entities) Renderer::AppendDrawCmds(*entity, nullptr, camera->GetViewMatrix(), *queue);
+    };
+
+    suite.Add({ "Entity::UpdateTransform x10k", entityCount, setup,
+        [=] {
+            for (auto& entity : *entities) entity->SetPosition(entity->position);
+            BenchKeep(entities->back()->transform);
+        } });
+
+    suite.Add({ "Renderer::AppendDrawCmds 10k entities x8", entityCount * 8ull, setup,
+        [=] {
+            std::vector<DrawCmd>& cmds = *built;
+            cmds.clear();
+            glm::mat4 view = camera->GetViewMatrix();
+            for (const auto& entity : *entities) Renderer::AppendDrawCmds(*entity, nullptr, view, cmds);
+            BenchKeep(cmds.back().depth);
+        } });
+
+    suite.Add({ "DrawCmd copy 80k (sort overhead)", entityCount * 8ull, setup,
+        [=] { *sorted = *queue; BenchKeep(sorted->back().depth); } });
+    suite.Add({ "DrawCmd sort front to back 80k", entityCount * 8ull, setup,
+        [=] {
+            *sorted = *queue;
+            std::sort(sorted->begin(), sorted->end());
+            BenchKeep(sorted->front().depth);
+        } });
+    suite.Add({ "DrawCmd sort back to front 80k (forward)", entityCount * 8ull, setup,
+        [=] {
+            *sorted = *queue;
+            std::sort(sorted->begin(), sorted->end(), [](const DrawCmd& a, const DrawCmd& b) { return a.depth > b.depth; });
+            BenchKeep(sorted->front().depth);
+        } });
+}
+
+// everything here lives until exit, the context is never destroyed either
+static void AddGLCases(BenchSuite& suite)
+{
+    Shader* shader = new Shader("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag");
+    if (!shader->IsValid())
+    {
+        std::cout << "EchoBench: could not build the gbuffer shader, run from the repository root. GL cases skipped" << std::endl;
+        return;
+    }
+
+    const glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f));
+    const UniformHandle<glm::mat4> handle = shader->GetUniform<glm::mat4>("uModel");
+
+    suite.Add({ "Shader uniform by name x100", 100, [shader] { shader->Bind(); },
+        [shader, model] { for (int i = 0; i < 100; ++i) shader->SetUniformMat4f("uModel", model); } });
+    suite.Add({ "Shader uniform by handle x100", 100, [shader] { shader->Bind(); },
+        [shader, model, handle] { for (int i = 0; i < 100; ++i) shader->Set(handle, model); } });
+
+    // SubmitDrawCmd binds and uploads as well, the first (untimed) iteration creates the mesh resources
+    const int entityCount = 1000;
+    auto entities = std::make_shared<std::vector<std::unique_ptr<Entity>>>(GenerateEntities(entityCount, GenerateGridMesh(16, 8), 500.0f));
+    Camera* camera = new Camera(glm::vec3(0.0f, 20.0f, -300.0f), 90.0f, -10.0f);
+    SceneData* scene = new SceneData();
+    scene->activeCamera = camera;
+    Renderer* renderer = new Renderer();
+    renderer->SetScene(*scene);
+
+    suite.Add({ "Renderer::SubmitDrawCmd 1k entities x8", entityCount * 8ull, nullptr,
+        [=] {
+            renderer->BeginFrame();
+            for (const auto& entity : *entities) renderer->SubmitDrawCmd(*entity, *shader);
+            BenchKeep(renderer->GetDrawCmdCount());
+        } });
+
+    // the hitch of a new 4K material texture, glFinish included so the driver's share is counted.
+    // the first case is the old path, level 0 only and glGenerateMipmap
+    const int size = 4096;
+    auto texture = std::make_shared<Texture>();
+    auto setup = [=] {
+        if (texture->GetData()) return;
+        *texture = GenerateTexture(size, size, 4, 4);
+        texture->GenerateMips({ TextureUsage::Albedo, false });
+    };
+    const uint64_t pixels = (uint64_t)size * size;
+
+    suite.Add({ "Texture upload 4096^2 + glGenerateMipmap", pixels, setup,
+        [=] {
+            uint id = 0;
+            glGenTextures(1, &id);
+            glBindTexture(GL_TEXTURE_2D, id);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture->GetData());
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+            glDeleteTextures(1, &id);
+        } });
+    suite.Add({ "RenderTexture 4096^2, every level from the chain", pixels, setup,
+        [=] { RenderTexture gpuTexture(*texture, false); glFinish(); } });
+    suite.Add({ "RenderTexture 4096^2, streamed (tail only)", pixels, setup,
+        [=] { RenderTexture gpuTexture(*texture, true); glFinish(); } });
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintBenchUsage(argv[0]);
+            return (int)ExitCode::Ok;
+        }
+        else if (arg == "--filter" && hasValue)   options.Filter = argv[++i];
+        else if (arg == "--samples" && hasValue)  options.Samples = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--min-time" && hasValue) options.MinSampleMs = std::max(0.1, std::atof(argv[++i]));
+        else if (arg == "--output" && hasValue)   options.OutputPath = argv[++i];
+        else if (arg == "--list")                 options.List = true;
+        else if (arg == "--no-gl")                options.UseGL = false;
+        else
+        {
+            std::cout << "Unknown or incomplete argument '" << arg << "'" << std::endl;
+            PrintBenchUsage(argv[0]);
+            return (int)ExitCode::BadArguments;
+        }
+    }
+
+    // the generated textures mustn't fill a cache directory
+    TextureCache::SetDirectory("");
+
+    BenchSuite suite;
+    AddMeshCases(suite);
+    AddMaterialCases(suite);
+    AddTextureCases(suite);
+    AddSceneCases(suite);
+
+    if (options.UseGL && !options.List)
+    {
+        GLFWwindow* window = CreateHeadlessWindow(64, 64);
+        if (window)
+        {
+            glfwMakeContextCurrent(window);
+            if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) AddGLCases(suite);
+        }
+        if (!window) std::cout << "EchoBench: no GL context, GL cases skipped" << std::endl;
+    }
+
+    if (options.List)
+    {
+        for (const BenchCase& benchCase : suite.GetCases()) std::cout << benchCase.Name << "\n";
+        std::cout << "(plus the GL cases: shader uniforms, Renderer::SubmitDrawCmd, 4K texture uploads)" << std::endl;
+        return (int)ExitCode::Ok;
+    }
+
+    std::vector<BenchResult> results = suite.Run(options);
+    if (!options.OutputPath.empty() && !WriteBenchResults(results, options.OutputPath)) return (int)ExitCode::WriteFailed;
+
+    return (int)ExitCode::Ok;
+}
@@ -0,0 +1,203 @@
+#include "Generators.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+static float GeneratorHeight(int x, int z, float phase)
+{
+    return 2.0f * std::sin(x * 0.11f + phase) * std::cos(z * 0.07f - phase) + 0.5f * std::sin((x + z) * 0.31f);
+}
+
+std::string GenerateOBJ(int gridSize, int materials, uint seed)
+{
+    std::mt19937 rng(seed);
+    float phase = std::uniform_real_distribution<float>(0.0f, 6.28f)(rng);
+    materials = std::max(materials, 1);
+
+    std::ostringstream obj;
+    obj.setf(std::ios::fixed);
+    obj.precision(5);
+    obj << "# EchoBench heightfield " << gridSize << "x" << gridSize << "\n";
+
+    const int side = gridSize + 1;
+    for (int z = 0; z < side; ++z)
+        for (int x = 0; x < side; ++x)
+            obj << "v " << (float)x << " " << GeneratorHeight(x, z, phase) << " " << (float)z << "\n";
+
+    for (int z = 0; z < side; ++z)
+        for (int x = 0; x < side; ++x)
+            obj << "vt " << (float)x / gridSize << " " << (float)z / gridSize << "\n";
+
+    // normals from central differences, like a real export would have them
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            float dx = GeneratorHeight(x + 1, z, phase) - GeneratorHeight(x - 1, z, phase);
+            float dz = GeneratorHeight(x, z + 1, phase) - GeneratorHeight(x, z - 1, phase);
+            glm::vec3 n = glm::normalize(glm::vec3(-dx, 2.0f, -dz));
+            obj << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+        }
+    }
+
+    // rows are split into bands, one material each
+    obj << "g heightfield\n";
+    int band = -1;
+    for (int z = 0; z < gridSize; ++z)
+    {
+        int material = z * materials / gridSize;
+        if (material != band)
+        {
+            band = material;
+            obj << "usemtl bench_" << material << "\n";
+        }
+
+        for (int x = 0; x < gridSize; ++x)
+        {
+            int a = z * side + x + 1;
+            int b = a + 1;
+            int c = a + side;
+            int d = c + 1;
+            obj << "f " << a << "/" << a << "/" << a << " " << c << "/" << c << "/" << c << " "
+                << d << "/" << d << "/" << d << " " << b << "/" << b << "/" << b << "\n";
+        }
+    }
+
+    return obj.str();
+}
+
+std::string WriteGeneratedOBJ(int gridSize, int materials, uint seed)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("echobench_" + std::to_string(gridSize) + "_" + std::to_string(materials) + "_" + std::to_string(seed) + ".obj");
+
+    std::ofstream file(path, std::ios::binary);
+    file << GenerateOBJ(gridSize, materials, seed);
+    return path.string();
+}
+
+std::shared_ptr<Mesh> GenerateGridMesh(int gridSize, int subMeshes, uint seed)
+{
+    std::mt19937 rng(seed);
+    float phase = std::uniform_real_distribution<float>(0.0f, 6.28f)(rng);
+    subMeshes = std::clamp(subMeshes, 1, gridSize);
+
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+    mesh->Name = "bench_grid";
+
+    const int side = gridSize + 1;
+    mesh->Vertices.resize((size_t)side * side);
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            Vertex& v = mesh->Vertices[(size_t)z * side + x];
+            v.Position = glm::vec3((float)x, GeneratorHeight(x, z, phase), (float)z);
+            v.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            v.TexCoords = glm::vec2((float)x / gridSize, (float)z / gridSize);
+            v.Tangent = glm::vec3(0.0f);
+            v.Bitangent = glm::vec3(0.0f);
+        }
+    }
+
+    mesh->Indices.reserve((size_t)gridSize * gridSize * 6);
+    for (int s = 0; s < subMeshes; ++s)
+    {
+        SubMesh subMesh;
+        subMesh.BaseIndex = (uint)mesh->Indices.size();
+        subMesh.MaterialIndex = s;
+        subMesh.NodeName = "bench_" + std::to_string(s);
+
+        for (int z = s * gridSize / subMeshes; z < (s + 1) * gridSize / subMeshes; ++z)
+        {
+            for (int x = 0; x < gridSize; ++x)
+            {
+                uint a = z * side + x;
+                uint b = a + 1;
+                uint c = a + side;
+                uint d = c + 1;
+                mesh->Indices.insert(mesh->Indices.end(), { a, c, d, a, d, b });
+            }
+        }
+
+        subMesh.IndexCount = (uint)mesh->Indices.size() - subMesh.BaseIndex;
+        mesh->CalculateSubMeshBoundsAndCenter(subMesh, *mesh);
+        mesh->SubMeshes.push_back(subMesh);
+    }
+
+    return mesh;
+}
+
+Texture GenerateTexture(int width, int height, int channels, uint seed)
+{
+    Texture texture(width, height, channels);
+    uchar* data = texture.GetData();
+
+    // 16x16 lattice of random values, bilinearly interpolated
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(0, 255);
+    int lattice[17][17][4];
+    for (auto& row : lattice)
+        for (auto& cell : row)
+            for (int& c : cell) c = value(rng);
+
+    for (int y = 0; y < height; ++y)
+    {
+        float fy = (float)y / height * 16.0f;
+        int y0 = (int)fy;
+        float ty = fy - y0;
+        for (int x = 0; x < width; ++x)
+        {
+            float fx = (float)x / width * 16.0f;
+            int x0 = (int)fx;
+            float tx = fx - x0;
+            for (int c = 0; c < channels; ++c)
+            {
+                int k = c & 3;
+                float top = lattice[y0][x0][k] + (lattice[y0][x0 + 1][k] - lattice[y0][x0][k]) * tx;
+                float bottom = lattice[y0 + 1][x0][k] + (lattice[y0 + 1][x0 + 1][k] - lattice[y0 + 1][x0][k]) * tx;
+                data[((size_t)y * width + x) * channels + c] = (uchar)(top + (bottom - top) * ty);
+            }
+        }
+    }
+
+    return texture;
+}
+
+Texture CopyTexture(const Texture& texture)
+{
+    Texture copy(texture.GetWidth(), texture.GetHeight(), texture.GetChannels());
+    std::memcpy(copy.GetData(), texture.GetData(), (size_t)texture.GetWidth() * texture.GetHeight() * texture.GetChannels());
+    return copy;
+}
+
+std::vector<std::unique_ptr<Entity>> GenerateEntities(int count, const std::shared_ptr<Mesh>& mesh, float extent, uint seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-extent * 0.5f, extent * 0.5f);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    std::vector<std::shared_ptr<Material>> materials;
+    for (size_t i = 0; i < mesh->SubMeshes.size(); ++i) materials.push_back(std::make_shared<Material>());
+
+    std::vector<std::unique_ptr<Entity>> entities;
+    entities.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        std::unique_ptr<Entity> entity = std::make_unique<Entity>();
+        entity->meshAsset = mesh;
+        entity->materials = materials;
+        entity->isStatic = i % 4 != 0;
+        entity->SetScale(glm::vec3(scale(rng)));
+        entity->SetRotation(glm::vec3(0.0f, angle(rng), 0.0f));
+        entity->SetPosition(glm::vec3(position(rng), 0.0f, position(rng)));
+        entities.push_back(std::move(entity));
+    }
+
+    return entities;
+}
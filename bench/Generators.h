@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Resources/Entity.h"
+#include "Resources/Mesh.h"
+#include "Resources/Texture.h"
+
+// procedural inputs for EchoBench so the suite needs no assets. everything is seeded and the
+// same for every run
+
+// rolling heightfield of (gridSize + 1)^2 vertices with positions, uvs and normals, split into
+// `materials` usemtl groups (no mtllib, the loader makes a default material per group).
+// returns the obj text
+std::string GenerateOBJ(int gridSize, int materials, uint seed = 1);
+
+// writes GenerateOBJ to a file under the temp directory, returns its path
+std::string WriteGeneratedOBJ(int gridSize, int materials, uint seed = 1);
+
+// the same heightfield as a Mesh, indices only (normals and tangents are left to the caller)
+std::shared_ptr<Mesh> GenerateGridMesh(int gridSize, int subMeshes, uint seed = 1);
+
+// value noise, any channel count
+Texture GenerateTexture(int width, int height, int channels, uint seed = 1);
+
+// Texture can't be copied and the Material setters take theirs by value, benchmarks of those
+// pay for one of these per iteration (there is a case timing it alone)
+Texture CopyTexture(const Texture& texture);
+
+// count entities sharing mesh, scattered over a square of extent metres, with random rotation and
+// scale. every entity gets one material per submesh
+std::vector<std::unique_ptr<Entity>> GenerateEntities(int count, const std::shared_ptr<Mesh>& mesh, float extent, uint seed = 1);
@@ -0,0 +1,92 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<bool> s_Counting = false;
+    std::atomic<size_t> s_Allocations = 0;
+    std::atomic<size_t> s_Bytes = 0;
+
+    size_t s_LastAllocations = 0;
+    size_t s_LastBytes = 0;
+    size_t s_CleanStreak = 0;
+}
+
+void AllocationCounter::BeginFrame()
+{
+    s_Allocations = 0;
+    s_Bytes = 0;
+    s_Counting = true;
+}
+
+void AllocationCounter::EndFrame()
+{
+    s_Counting = false;
+    s_LastAllocations = s_Allocations;
+    s_LastBytes = s_Bytes;
+
+    s_CleanStreak = s_LastAllocations == 0 ? s_CleanStreak + 1 : 0;
+}
+
+size_t AllocationCounter::GetFrameAllocations() { return s_LastAllocations; }
+size_t AllocationCounter::GetFrameBytes() { return s_LastBytes; }
+size_t AllocationCounter::GetCleanFrameStreak() { return s_CleanStreak; }
+
+#ifdef ECHO_TRACK_ALLOCATIONS
+
+static void* CountedAlloc(size_t size, size_t alignment)
+{
+    if (s_Counting.load(std::memory_order_relaxed))
+    {
+        s_Allocations.fetch_add(1, std::memory_order_relaxed);
+        s_Bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    if (size == 0) size = 1;
+
+    void* p = nullptr;
+    if (alignment > alignof(std::max_align_t))
+    {
+        // aligned_alloc wants the size to be a multiple of the alignment
+        size = (size + alignment - 1) & ~(alignment - 1);
+#ifdef _WIN32
+        p = _aligned_malloc(size, alignment);
+#else
+        p = std::aligned_alloc(alignment, size);
+#endif
+    }
+    else
+    {
+        p = std::malloc(size);
+    }
+
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void CountedFree(void* p, size_t alignment)
+{
+#ifdef _WIN32
+    if (alignment > alignof(std::max_align_t)) { _aligned_free(p); return; }
+#endif
+    std::free(p);
+}
+
+void* operator new(size_t size) { return CountedAlloc(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return CountedAlloc(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t al) { return CountedAlloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return CountedAlloc(size, static_cast<size_t>(al)); }
+
+void operator delete(void* p) noexcept { CountedFree(p, alignof(std::max_align_t)); }
+void operator delete[](void* p) noexcept { CountedFree(p, alignof(std::max_align_t)); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p, alignof(std::max_align_t)); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p, alignof(std::max_align_t)); }
+void operator delete(void* p, std::align_val_t al) noexcept { CountedFree(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, std::align_val_t al) noexcept { CountedFree(p, static_cast<size_t>(al)); }
+void operator delete(void* p, size_t, std::align_val_t al) noexcept { CountedFree(p, static_cast<size_t>(al)); }
+void operator delete[](void* p, size_t, std::align_val_t al) noexcept { CountedFree(p, static_cast<size_t>(al)); }
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// counts global operator new calls between BeginFrame() and EndFrame().
+// only active when built with ECHO_TRACK_ALLOCATIONS, otherwise every query returns 0
+// and IsEnabled() is false so the UI can say so.
+class AllocationCounter
+{
+
+public:
+    static void BeginFrame();
+    static void EndFrame();
+
+    // numbers for the last finished frame
+    static size_t GetFrameAllocations();
+    static size_t GetFrameBytes();
+
+    // frames in a row that did not touch the heap
+    static size_t GetCleanFrameStreak();
+
+    static constexpr bool IsEnabled()
+    {
+#ifdef ECHO_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+};
@@ -14,33 +14,47 @@
 #include "Renderer/Shader.h"
 #include "Renderer/RenderTexture.h"
 #include "Renderer/MeshResource.h"
+#include "Renderer/ShaderCache.h"
+#include "Resources/TextureCache.h"
 
 #include "Resources/Texture.h"
 #include "Resources/Material.h"
 #include "Resources/Entity.h"
 #include "Resources/OBJLoader.h"
+#include "Core/Profiler.h"
+#include "Core/Benchmark.h"
+#include "Core/HeadlessContext.h"
 
-
-Application::Application()
+Application::Application(const LaunchOptions& options)
+    : m_Options(options)
 {
-    if (!glfwInit()) return;
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
     m_WPosX = 100;
     m_WPosY = 100;
-    m_WWidth = 1280;
-    m_WHeight = 720;
+    m_WWidth = m_Options.Width;
+    m_WHeight = m_Options.Height;
     m_WFullscreen = false;
-    glfwWindowHint(GLFW_POSITION_X, m_WPosX);
-    glfwWindowHint(GLFW_POSITION_Y, m_WPosY);
-    m_Window = glfwCreateWindow(m_WWidth, m_WHeight, "EchoEngine", nullptr, nullptr);
-    if (!m_Window)
+
+    if (m_Options.Benchmark)
     {
-        glfwTerminate();
-        return;
+        m_Window = CreateHeadlessWindow(m_WWidth, m_WHeight);
+        if (!m_Window) return;
+    }
+    else
+    {
+        if (!glfwInit()) return;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
+        glfwWindowHint(GLFW_POSITION_X, m_WPosX);
+        glfwWindowHint(GLFW_POSITION_Y, m_WPosY);
+        m_Window = glfwCreateWindow(m_WWidth, m_WHeight, "EchoEngine", nullptr, nullptr);
+        if (!m_Window)
+        {
+            glfwTerminate();
+            return;
+        }
     }
     
     glfwMakeContextCurrent(m_Window);
@@ -52,6 +66,9 @@ Application::Application()
         return;
     }
 
+    m_Initialized = true;
+    if (m_Options.Benchmark) return;
+
 	glfwSetWindowUserPointer(m_Window, this);
 	glfwSetWindowSizeCallback(m_Window, Application::OnWindowResized);
 
@@ -254,19 +271,137 @@ bool DirectionGizmo(const char* label, glm::vec3& direction) {
     return value_changed;
 }
 
+// flame view of one frame, a row per scope depth and a block of rows per thread. the frame shown
+// trails the newest one a little so its gpu scopes are already back
+static void DrawProfilerWindow()
+{
+    ImGui::Begin("Profiler");
+    if (!Profiler::IsCompiledIn())
+    {
+        ImGui::TextDisabled("Built without ECHO_PROFILER");
+        ImGui::End();
+        return;
+    }
+
+    static bool paused = false;
+    static uint64_t viewFrame = 0;
+    static int captureFrames = 60;
+
+    bool enabled = Profiler::IsEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled)) Profiler::SetEnabled(enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+
+    ImGui::DragInt("Frames", &captureFrames, 1.0f, 1, (int)Profiler::GetMaxCaptureFrames());
+    ImGui::SameLine();
+    if (Profiler::IsCapturing()) ImGui::TextDisabled("Capturing...");
+    else if (ImGui::Button("Capture trace")) Profiler::CaptureFrames((uint32_t)captureFrames);
+
+    uint64_t newest = Profiler::GetFrameIndex();
+    if (!paused && newest > GPU_TIMER_QUERY_COUNT) viewFrame = newest - GPU_TIMER_QUERY_COUNT - 1;
+
+    ProfileFrame frame;
+    if (!Profiler::GetFrame(viewFrame, frame))
+    {
+        ImGui::TextDisabled("No frame recorded yet");
+        ImGui::End();
+        return;
+    }
+
+    static std::vector<ProfileEvent> events;
+    events.clear();
+    Profiler::GetEvents(viewFrame, viewFrame, events);
+
+    // the gpu runs behind the cpu, stretch the range to whatever it finished last
+    uint64_t rangeStart = frame.StartNs;
+    uint64_t rangeEnd = frame.EndNs;
+    std::vector<uint32_t> threads;
+    std::vector<uint32_t> threadDepth;
+    for (const ProfileEvent& e : events)
+    {
+        rangeStart = std::min(rangeStart, e.StartNs);
+        rangeEnd = std::max(rangeEnd, e.EndNs);
+
+        auto it = std::find(threads.begin(), threads.end(), e.Thread);
+        if (it == threads.end())
+        {
+            threads.push_back(e.Thread);
+            threadDepth.push_back(0);
+            it = threads.end() - 1;
+        }
+        uint32_t& depth = threadDepth[it - threads.begin()];
+        depth = std::max(depth, e.Depth + 1);
+    }
+
+    ImGui::Text("Frame %llu: %.3f ms CPU", (unsigned long long)viewFrame, (frame.EndNs - frame.StartNs) / 1000000.0);
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float labelHeight = ImGui::GetTextLineHeight() + 2.0f;
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = ImGui::GetContentRegionAvail().x;
+    double nsToPixels = width / (double)std::max<uint64_t>(rangeEnd - rangeStart, 1);
+
+    float y = origin.y;
+    for (size_t t = 0; t < threads.size(); ++t)
+    {
+        dl->AddText(ImVec2(origin.x, y), ImGui::GetColorU32(ImGuiCol_TextDisabled), Profiler::GetThreadName(threads[t]).c_str());
+        y += labelHeight;
+
+        for (const ProfileEvent& e : events)
+        {
+            if (e.Thread != threads[t]) continue;
+
+            float x0 = origin.x + (float)((e.StartNs - rangeStart) * nsToPixels);
+            float x1 = origin.x + (float)((std::max(e.EndNs, e.StartNs) - rangeStart) * nsToPixels);
+            if (x1 - x0 < 1.0f) x1 = x0 + 1.0f;
+            ImVec2 min(x0, y + e.Depth * rowHeight);
+            ImVec2 max(x1, min.y + rowHeight - 1.0f);
+
+            // stable color per name
+            float hue = (float)(std::hash<std::string_view>()(e.Name) % 1000) / 1000.0f;
+            dl->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, e.Thread == Profiler::GpuThread ? 0.6f : 0.8f));
+
+            if (x1 - x0 > ImGui::CalcTextSize(e.Name).x + 4.0f)
+            {
+                dl->AddText(ImVec2(x0 + 2.0f, min.y + 2.0f), ImColor(0, 0, 0), e.Name);
+            }
+            if (ImGui::IsMouseHoveringRect(min, max))
+            {
+                ImGui::SetTooltip("%s\n%.3f ms", e.Name, (e.EndNs - e.StartNs) / 1000000.0);
+            }
+        }
+        y += threadDepth[t] * rowHeight + 4.0f;
+    }
+
+    ImGui::Dummy(ImVec2(width, y - origin.y));
+    ImGui::End();
+}
+
 Application::~Application()
 {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (ImGui::GetCurrentContext())
+    {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
-    glfwDestroyWindow(m_Window);
+    if (m_Window) glfwDestroyWindow(m_Window);
     glfwTerminate();
 }
 
-void Application::Run()
+int Application::Run()
 {
     std::cout << std::endl;
+    Profiler::SetThreadName("Main");
+
+    if (!m_Initialized) return (int)ExitCode::NoContext;
+
+    CameraPath cameraPath;
+    if (m_Options.Benchmark && !cameraPath.Load(m_Options.CameraPath)) return (int)ExitCode::LoadFailed;
+
+    TextureCache::SetDirectory(m_Options.TextureCacheDir);
 
     // Entity room;
     // room.LoadFromOBJ("assets/models/room.obj");
@@ -275,8 +410,14 @@ void Application::Run()
     // m_Scene.m_Entities.push_back(&room);
     
     Entity ground;
-    ground.LoadFromOBJ("assets/models/terrain.obj");
+    ground.LoadFromOBJ(m_Options.ScenePath);
+    if (m_Options.Benchmark && ground.meshAsset->Vertices.empty())
+    {
+        std::cout << "Benchmark: scene " << m_Options.ScenePath << " has no geometry" << std::endl;
+        return (int)ExitCode::LoadFailed;
+    }
     ground.Translate(glm::vec3(0.0, 0.0, 0.0));
+    ground.isStatic = true;
     m_Scene.m_Entities.push_back(&ground);
 
     // Entity BistroExt;
@@ -304,7 +445,14 @@ void Application::Run()
     m_Scene.activeCamera->SetProjectionMatrix((float)m_WWidth / (float)m_WHeight, m_Scene.activeCamera->GetNear(), m_Scene.activeCamera->GetFar());
 
     m_Renderer.SetScene(m_Scene);
+    m_Renderer.SetOffscreenOutput(m_Options.Benchmark);
+    m_Renderer.SetTextureStreaming(m_Options.TextureStreaming);
+    ShaderCache::SetDirectory(m_Options.ShaderCacheDir);
+    ShaderBatch::SetParallel(!m_Options.SerialShaders);
     m_Renderer.Init(m_WWidth, m_WHeight);
+    if (m_Options.Benchmark) return RunBenchmark(cameraPath);
+    if (m_Options.WatchShaders) m_Renderer.WatchShaders("assets/shaders");
+
     while (!glfwWindowShouldClose(m_Window))
     {
         float currentFrame = (float)glfwGetTime();
@@ -312,8 +460,12 @@ void Application::Run()
         m_LastFrameTime = currentFrame;
 
         glfwPollEvents();
-        Update();
+        {
+            PROFILE_SCOPE("Update");
+            Update();
+        }
 
+        PROFILE_BEGIN("ImGui Build");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         
@@ -342,8 +494,12 @@ void Application::Run()
         auto& timerMap = RenderProfiler::GetTimerMap();
         auto& frameOrder = RenderProfiler::GetFrameOrder();
 
+        // nested scopes are already inside their parent's time
         float totalMs = 0.0f;
-        for (const auto& name : frameOrder) totalMs += timerMap[name].TimeMs;
+        for (const auto& name : frameOrder)
+        {
+            if (timerMap[name].Depth == 0) totalMs += timerMap[name].TimeMs;
+        }
 
         ImGui::Text("Total Frame: %.3f ms", totalMs);
 
@@ -363,6 +519,7 @@ void Application::Run()
             for (const auto& name : frameOrder)
             {
                 auto& timer = timerMap[name];
+                if (timer.Depth != 0) continue;
                 float w = (timer.TimeMs / targetMs) * width;
                 if (w < 1.0f) continue;
 
@@ -376,15 +533,46 @@ void Application::Run()
             }
         }
 
-        for (const auto& name : frameOrder)
+        if (ImGui::BeginTable("GPU Timers", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
         {
-            auto& timer = timerMap[name];
-            ImGui::TextColored(timer.Color, "%-15s: %.3f ms", name.c_str(), timer.TimeMs);
+            ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Last");
+            ImGui::TableSetupColumn("Min");
+            ImGui::TableSetupColumn("Avg");
+            ImGui::TableSetupColumn("P95");
+            ImGui::TableSetupColumn("Max");
+            ImGui::TableHeadersRow();
+            for (const auto& name : frameOrder)
+            {
+                auto& timer = timerMap[name];
+                GpuTimerStats stats = timer.GetStats();
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                float indent = timer.Depth * 10.0f;
+                if (indent > 0.0f) ImGui::Indent(indent);
+                ImGui::TextColored(timer.Color, "%s", name.c_str());
+                if (indent > 0.0f) ImGui::Unindent(indent);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", timer.TimeMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.MinMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.AvgMs);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.P95Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.MaxMs);
+                if (timer.Dropped && ImGui::IsItemHovered()) ImGui::SetTooltip("%u samples dropped, GPU more than %d frames behind", timer.Dropped, GPU_TIMER_QUERY_COUNT);
+            }
+            ImGui::EndTable();
         }
+        ImGui::TextDisabled("over the last %d samples per scope", GPU_TIMER_HISTORY);
 
         frameOrder.clear(); 
         ImGui::End();
 
+        DrawProfilerWindow();
+
         ImGui::Begin("Scene Inspector");
         ImGui::Text("Sun parameters");
         ImGui::ColorEdit3("Color", &m_Scene.m_Sun.Color.x);
@@ -406,6 +594,7 @@ void Application::Run()
                         if (ImGui::DragFloat3("Position", &entity.position.x, 0.1f)) entity.SetPosition(entity.position); 
                         if (ImGui::DragFloat3("Rotation", &entity.rotation.x, 1.0f)) entity.SetRotation(entity.rotation);
                         if (ImGui::DragFloat3("Scale", &entity.scale.x, 0.1f))       entity.SetScale(entity.scale);
+                        ImGui::Checkbox("Static", &entity.isStatic);
                         
                         ImGui::Separator();
 
@@ -452,7 +641,26 @@ void Application::Run()
 
             if (ImGui::BeginTabItem("Lights"))
             {
-                for (size_t i = 0; i < m_Scene.m_Lights.size(); ++i)
+                static int spawnCount = 1024;
+                static float spawnExtent = 200.0f;
+                ImGui::DragInt("Light count", &spawnCount, 16.0f, 1, 8192);
+                ImGui::DragFloat("Spawn extent", &spawnExtent, 1.0f, 1.0f, 5000.0f);
+                if (ImGui::Button("Spawn point lights around camera"))
+                {
+                    glm::vec3 center = m_Scene.activeCamera->GetPosition();
+                    glm::vec3 extent = glm::vec3(spawnExtent, spawnExtent * 0.1f, spawnExtent);
+                    m_Scene.SpawnRandomPointLights(spawnCount, center - extent, center + extent);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Clear generated")) m_Scene.ClearGeneratedLights();
+                ImGui::Text("%zu lights (%zu generated)", m_Scene.m_Lights.size(), m_Scene.GetGeneratedLightCount());
+                const LocalShadowStats& shadowStats = m_Renderer.GetLocalShadowStats();
+                ImGui::Text("Shadow atlas: %.1f%% used, %u tiles for %u lights", shadowStats.Occupancy * 100.0f, shadowStats.AllocatedTiles, shadowStats.ShadowedLights);
+                ImGui::Separator();
+
+                // listing thousands of headers makes the UI the bottleneck
+                const size_t maxListed = 64;
+                for (size_t i = 0; i < std::min(m_Scene.m_Lights.size(), maxListed); ++i)
                 {
                     Light* light = m_Scene.m_Lights[i];
                     ImGui::PushID(static_cast<int>(i));
@@ -481,6 +689,7 @@ void Application::Run()
                             ImGui::ColorEdit3("Color", &pLight->Color.x);
                             ImGui::DragFloat("Intensity", &pLight->Intensity, 0.1f, 0.0f, 100.0f);
                             ImGui::DragFloat3("Position", &pLight->Position.x, 0.1f);
+                            ImGui::Checkbox("Cast shadows", &pLight->CastShadows);
                             
                             ImGui::Text("Attenuation");
                             ImGui::DragFloat("Linear", &pLight->Linear, 0.01f, 0.0f, 1.0f);
@@ -492,6 +701,7 @@ void Application::Run()
                             ImGui::DragFloat("Intensity", &sLight->Intensity, 0.1f, 0.0f, 100.0f);
                             ImGui::DragFloat3("Position", &sLight->Position.x, 0.1f);
                             if (ImGui::DragFloat3("Direction", &sLight->Direction.x, 0.05f)) sLight->Direction = glm::normalize(sLight->Direction);
+                            ImGui::Checkbox("Cast shadows", &sLight->CastShadows);
 
                             ImGui::DragFloat("Inner Cutoff", &sLight->InnerCutoff, 0.1f, 0.0f, 180.0f);
                             ImGui::DragFloat("Outer Cutoff", &sLight->OuterCutoff, 0.1f, 0.0f, 180.0f);
@@ -499,6 +709,7 @@ void Application::Run()
                     }
                     ImGui::PopID();
                 }
+                if (m_Scene.m_Lights.size() > maxListed) ImGui::TextDisabled("... %zu more", m_Scene.m_Lights.size() - maxListed);
                 ImGui::EndTabItem();
             }
             ImGui::EndTabBar();
@@ -509,12 +720,16 @@ void Application::Run()
         ImGui::End();
 
         ImGui::Render();
+        PROFILE_END();
         
         m_Renderer.BeginFrame();
 		m_Renderer.DrawScene();
 		m_Renderer.EndFrame();
 
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_SCOPE("ImGui Render");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
         
         if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
         {
@@ -525,8 +740,61 @@ void Application::Run()
         }
 
         InputManager::GetInstance().EndFrame();
-        glfwSwapBuffers(m_Window);
+        {
+            PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(m_Window);
+        }
+        Profiler::EndFrame();
     }
+
+    return (int)ExitCode::Ok;
+}
+
+// warmup frames sit at the start of the path, the measured ones are spread evenly over it so the
+// camera position of every frame is the same from run to run regardless of frame times
+int Application::RunBenchmark(const CameraPath& path)
+{
+    Camera& camera = *m_Scene.activeCamera;
+    const int warmup = m_Options.WarmupFrames;
+    const int measured = m_Options.MeasuredFrames;
+
+    BenchmarkReport report;
+    report.Scene = m_Options.ScenePath;
+    report.CameraPath = m_Options.CameraPath;
+    report.GLRenderer = (const char*)glGetString(GL_RENDERER);
+    report.GLVersion = (const char*)glGetString(GL_VERSION);
+    report.Width = m_WWidth;
+    report.Height = m_WHeight;
+
+    std::cout << "Benchmark: " << report.GLRenderer << ", " << m_WWidth << "x" << m_WHeight << ", "
+              << warmup << " warmup + " << measured << " measured frames over " << path.GetDuration() << "s of camera path" << std::endl;
+
+    BenchmarkRecorder recorder(warmup, measured);
+    while (!recorder.IsDone())
+    {
+        const int index = recorder.GetMeasuredIndex();
+        float t = index > 0 && measured > 1 ? path.GetDuration() * index / (measured - 1) : 0.0f;
+        path.Apply(camera, t);
+
+        recorder.BeginFrame();
+        m_Renderer.BeginFrame();
+        m_Renderer.DrawScene();
+        m_Renderer.EndFrame();
+        recorder.EndFrame();
+    }
+    recorder.Finish(report);
+
+    BenchmarkStats frameStats = ComputeBenchmarkStats(report.FrameMs);
+    std::cout << "Benchmark: frame avg " << frameStats.Avg << " ms, p95 " << frameStats.P95 << " ms, p99 " << frameStats.P99 << " ms" << std::endl;
+
+    if (!WriteBenchmarkReport(report, m_Options.OutputPath)) return (int)ExitCode::WriteFailed;
+    if (report.GLErrors > 0)
+    {
+        std::cout << "Benchmark: " << report.GLErrors << " GL errors" << std::endl;
+        return (int)ExitCode::GLErrors;
+    }
+
+    return (int)ExitCode::Ok;
 }
 
 void Application::Update()
@@ -9,15 +9,18 @@
 #include "Camera.h"
 #include "Scene.h"
 #include "Renderer/Renderer.h"
+#include "LaunchOptions.h"
+#include "CameraPath.h"
 
 class Application
 {
 
 public:
-    Application();
+    Application(const LaunchOptions& options = {});
     ~Application();
 
-    void Run();
+    // exit status for main, see ExitCode
+    int Run();
     void Update();
 
     void MouseMoved(float x, float y);
@@ -33,7 +36,13 @@ public:
     static void OnKeyboard(GLFWwindow* window, int key, int scancode, int action, int modifiers);
 
 private:
-    GLFWwindow* m_Window; // TODO: abstract this probably
+    // fixed camera path, no window or ImGui, results written to m_Options.OutputPath
+    int RunBenchmark(const CameraPath& path);
+
+    LaunchOptions m_Options;
+    bool m_Initialized = false;
+
+    GLFWwindow* m_Window = nullptr; // TODO: abstract this probably
     int m_WPosX, m_WPosY, m_WWidth, m_WHeight;
     bool m_WFullscreen;
 
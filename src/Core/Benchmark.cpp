@@ -0,0 +1,251 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "Core/Profiler.h"
+#include "Renderer/GPUTimer.h"
+
+BenchmarkRecorder::BenchmarkRecorder(int warmupFrames, int measuredFrames)
+    : m_WarmupFrames(warmupFrames), m_MeasuredFrames(measuredFrames)
+{
+    m_FrameMs.reserve(measuredFrames);
+    m_CpuMs.reserve(measuredFrames);
+
+    // errors from init are not the frames' fault
+    while (glGetError() != GL_NO_ERROR) {}
+}
+
+BenchmarkRecorder::~BenchmarkRecorder()
+{
+    for (GLsync fence : m_Fences) if (fence) glDeleteSync(fence);
+    RenderProfiler::GetRecording() = false;
+}
+
+void BenchmarkRecorder::BeginFrame()
+{
+    if (GetMeasuredIndex() == 0)
+    {
+        m_FirstMeasuredFrame = Profiler::GetFrameIndex();
+        RenderProfiler::GetRecording() = true;
+    }
+
+    m_FrameStart = std::chrono::steady_clock::now();
+}
+
+void BenchmarkRecorder::EndFrame()
+{
+    glFlush();
+    auto recorded = std::chrono::steady_clock::now();
+
+    GLsync& fence = m_Fences[m_Frame % 2];
+    if (fence)
+    {
+        PROFILE_SCOPE("Wait GPU");
+        GLenum status;
+        do status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while (status == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
+    {
+        if (m_GLErrors++ == 0) std::cout << "Benchmark: GL error 0x" << std::hex << error << std::dec << " in frame " << m_Frame << std::endl;
+    }
+
+    Profiler::EndFrame();
+
+    if (GetMeasuredIndex() >= 0)
+    {
+        m_FrameMs.push_back(std::chrono::duration<float, std::milli>(end - m_FrameStart).count());
+        m_CpuMs.push_back(std::chrono::duration<float, std::milli>(recorded - m_FrameStart).count());
+    }
+    m_Frame++;
+}
+
+void BenchmarkRecorder::Finish(BenchmarkReport& report)
+{
+    // everything is back after this, collect the tail of every query ring
+    glFinish();
+
+    report.WarmupFrames = m_WarmupFrames;
+    report.FrameMs = m_FrameMs;
+    report.CpuMs = m_CpuMs;
+    report.GLErrors = m_GLErrors;
+    report.GpuScopes.clear();
+
+    const int measured = (int)m_FrameMs.size();
+    auto& timerMap = RenderProfiler::GetTimerMap();
+    for (const std::string& name : RenderProfiler::GetFrameOrder())
+    {
+        GpuTimer& timer = timerMap[name];
+        timer.Collect();
+
+        BenchmarkScope& scope = report.GpuScopes.emplace_back();
+        scope.Name = name;
+        scope.Ms.assign(measured, -1.0f);
+        scope.Dropped = timer.Dropped;
+        for (const GpuTimerSample& sample : timer.Recorded)
+        {
+            if (sample.Frame < m_FirstMeasuredFrame || sample.Frame >= m_FirstMeasuredFrame + measured) continue;
+            float& ms = scope.Ms[sample.Frame - m_FirstMeasuredFrame];
+            ms = ms < 0.0f ? sample.Ms : ms + sample.Ms;   // a scope may run more than once per frame
+        }
+        timer.Recorded.clear();
+    }
+    RenderProfiler::GetRecording() = false;
+}
+
+BenchmarkStats ComputeBenchmarkStats(const std::vector<float>& samples)
+{
+    std::vector<float> sorted;
+    sorted.reserve(samples.size());
+    for (float s : samples) if (s >= 0.0f) sorted.push_back(s);
+
+    BenchmarkStats stats;
+    stats.Count = sorted.size();
+    if (sorted.empty()) return stats;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    // nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p * sorted.size());
+        return (double)sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    };
+
+    double sum = 0.0;
+    for (float s : sorted) sum += s;
+
+    stats.Min = sorted.front();
+    stats.Max = sorted.back();
+    stats.Avg = sum / sorted.size();
+    stats.P50 = percentile(0.50);
+    stats.P95 = percentile(0.95);
+    stats.P99 = percentile(0.99);
+    return stats;
+}
+
+static std::string EscapeBenchmarkJson(const std::string& text)
+{
+    std::string out;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    return out;
+}
+
+static void WriteBenchmarkStats(std::ofstream& out, const BenchmarkStats& stats)
+{
+    out << "{ \"count\": " << stats.Count
+        << ", \"min\": " << stats.Min
+        << ", \"avg\": " << stats.Avg
+        << ", \"p50\": " << stats.P50
+        << ", \"p95\": " << stats.P95
+        << ", \"p99\": " << stats.P99
+        << ", \"max\": " << stats.Max << " }";
+}
+
+static void WriteBenchmarkArray(std::ofstream& out, const std::vector<float>& samples)
+{
+    out << "[";
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        if (i) out << ", ";
+        if (samples[i] >= 0.0f) out << samples[i];
+        else out << "null";
+    }
+    out << "]";
+}
+
+bool WriteBenchmarkReport(const BenchmarkReport& report, const std::string& path)
+{
+    std::ofstream json(path);
+    if (!json.is_open())
+    {
+        std::cout << "Benchmark: could not write " << path << std::endl;
+        return false;
+    }
+
+    json << "{\n";
+    json << "  \"scene\": \"" << EscapeBenchmarkJson(report.Scene) << "\",\n";
+    json << "  \"camera_path\": \"" << EscapeBenchmarkJson(report.CameraPath) << "\",\n";
+    json << "  \"gl_renderer\": \"" << EscapeBenchmarkJson(report.GLRenderer) << "\",\n";
+    json << "  \"gl_version\": \"" << EscapeBenchmarkJson(report.GLVersion) << "\",\n";
+    json << "  \"width\": " << report.Width << ",\n";
+    json << "  \"height\": " << report.Height << ",\n";
+    json << "  \"warmup_frames\": " << report.WarmupFrames << ",\n";
+    json << "  \"measured_frames\": " << report.FrameMs.size() << ",\n";
+    json << "  \"gl_errors\": " << report.GLErrors << ",\n";
+    json << "  \"frame_ms\": "; WriteBenchmarkStats(json, ComputeBenchmarkStats(report.FrameMs)); json << ",\n";
+    json << "  \"cpu_ms\": "; WriteBenchmarkStats(json, ComputeBenchmarkStats(report.CpuMs)); json << ",\n";
+    json << "  \"gpu_ms\": {\n";
+    for (size_t i = 0; i < report.GpuScopes.size(); ++i)
+    {
+        const BenchmarkScope& scope = report.GpuScopes[i];
+        json << "    \"" << EscapeBenchmarkJson(scope.Name) << "\": ";
+        WriteBenchmarkStats(json, ComputeBenchmarkStats(scope.Ms));
+        json << (i + 1 < report.GpuScopes.size() ? ",\n" : "\n");
+    }
+    json << "  },\n";
+    json << "  \"frames\": {\n";
+    json << "    \"frame_ms\": "; WriteBenchmarkArray(json, report.FrameMs); json << ",\n";
+    json << "    \"cpu_ms\": "; WriteBenchmarkArray(json, report.CpuMs);
+    for (const BenchmarkScope& scope : report.GpuScopes)
+    {
+        json << ",\n    \"gpu " << EscapeBenchmarkJson(scope.Name) << "\": ";
+        WriteBenchmarkArray(json, scope.Ms);
+    }
+    json << "\n  }\n}\n";
+
+    if (!json.good())
+    {
+        std::cout << "Benchmark: failed writing " << path << std::endl;
+        return false;
+    }
+
+    std::string csvPath = path;
+    size_t dot = csvPath.find_last_of('.');
+    size_t slash = csvPath.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) csvPath.resize(dot);
+    csvPath += ".csv";
+
+    std::ofstream csv(csvPath);
+    if (!csv.is_open())
+    {
+        std::cout << "Benchmark: could not write " << csvPath << std::endl;
+        return false;
+    }
+
+    // scope names are pass names, no commas in there
+    csv << "frame,frame_ms,cpu_ms";
+    for (const BenchmarkScope& scope : report.GpuScopes) csv << ",gpu " << scope.Name;
+    csv << "\n";
+    for (size_t i = 0; i < report.FrameMs.size(); ++i)
+    {
+        csv << i << "," << report.FrameMs[i] << "," << report.CpuMs[i];
+        for (const BenchmarkScope& scope : report.GpuScopes)
+        {
+            csv << ",";
+            if (i < scope.Ms.size() && scope.Ms[i] >= 0.0f) csv << scope.Ms[i];
+        }
+        csv << "\n";
+    }
+
+    if (!csv.good())
+    {
+        std::cout << "Benchmark: failed writing " << csvPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Benchmark: wrote " << path << " and " << csvPath << std::endl;
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct BenchmarkStats
+{
+    double Min = 0.0, Avg = 0.0, P50 = 0.0, P95 = 0.0, P99 = 0.0, Max = 0.0;
+    size_t Count = 0;
+};
+
+struct BenchmarkScope
+{
+    std::string Name;
+    std::vector<float> Ms;      // per measured frame, negative when no sample came back for it
+    uint32_t Dropped = 0;
+};
+
+// everything one --benchmark run measured, times in ms
+struct BenchmarkReport
+{
+    std::string Scene;
+    std::string CameraPath;
+    std::string GLRenderer;
+    std::string GLVersion;
+    int Width = 0;
+    int Height = 0;
+    int WarmupFrames = 0;
+    uint32_t GLErrors = 0;
+
+    std::vector<float> FrameMs;     // wall time of the whole frame, including the wait on the gpu
+    std::vector<float> CpuMs;       // time spent recording the frame
+    std::vector<BenchmarkScope> GpuScopes;
+};
+
+// frame loop bookkeeping shared by --benchmark and EchoReplay. wrap each frame in BeginFrame /
+// EndFrame, EndFrame also ends the Profiler frame. instead of a present at most two frames are
+// kept in flight with fences, otherwise nothing stops the driver from queueing frames until the
+// timer query rings overflow
+class BenchmarkRecorder
+{
+
+public:
+    BenchmarkRecorder(int warmupFrames, int measuredFrames);
+    ~BenchmarkRecorder();
+
+    bool IsDone() const { return m_Frame >= m_WarmupFrames + m_MeasuredFrames; }
+    // negative during warmup
+    int GetMeasuredIndex() const { return m_Frame - m_WarmupFrames; }
+
+    void BeginFrame();
+    void EndFrame();
+
+    // waits for the gpu and fills in the times, GPU scopes and GL error count
+    void Finish(BenchmarkReport& report);
+
+private:
+    int m_WarmupFrames;
+    int m_MeasuredFrames;
+    int m_Frame = 0;
+    uint64_t m_FirstMeasuredFrame = 0;
+
+    GLsync m_Fences[2] = { nullptr, nullptr };
+    std::chrono::steady_clock::time_point m_FrameStart;
+
+    std::vector<float> m_FrameMs;
+    std::vector<float> m_CpuMs;
+    uint32_t m_GLErrors = 0;
+};
+
+// skips negative samples
+BenchmarkStats ComputeBenchmarkStats(const std::vector<float>& samples);
+
+// writes the summary and per frame arrays as JSON to path, and the per frame table as CSV
+// next to it (same name, .csv)
+bool WriteBenchmarkReport(const BenchmarkReport& report, const std::string& path);
@@ -0,0 +1,105 @@
+#include "CameraPath.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+bool CameraPath::Load(const std::string& path)
+{
+    m_Keyframes.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "CameraPath: could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.resize(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        std::istringstream stream(line);
+        CameraKeyframe key;
+        if (!(stream >> key.Time >> key.Position.x >> key.Position.y >> key.Position.z >> key.Yaw >> key.Pitch))
+        {
+            std::cout << "CameraPath: " << path << ":" << lineNumber << " expected 'time x y z yaw pitch'" << std::endl;
+            return false;
+        }
+
+        if (!m_Keyframes.empty() && key.Time <= m_Keyframes.back().Time)
+        {
+            std::cout << "CameraPath: " << path << ":" << lineNumber << " keyframe times must increase" << std::endl;
+            return false;
+        }
+
+        m_Keyframes.push_back(key);
+    }
+
+    if (m_Keyframes.empty())
+    {
+        std::cout << "CameraPath: " << path << " has no keyframes" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) +
+                   (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::Apply(Camera& camera, float time) const
+{
+    if (m_Keyframes.empty()) return;
+
+    const CameraKeyframe& first = m_Keyframes.front();
+    const CameraKeyframe& last = m_Keyframes.back();
+    if (m_Keyframes.size() == 1 || time <= first.Time)
+    {
+        camera.SetPosition(first.Position);
+        camera.SetYaw(first.Yaw);
+        camera.SetPitch(first.Pitch);
+        return;
+    }
+    if (time >= last.Time)
+    {
+        camera.SetPosition(last.Position);
+        camera.SetYaw(last.Yaw);
+        camera.SetPitch(last.Pitch);
+        return;
+    }
+
+    // segment [i, i + 1] containing time, the end points are repeated for the outer tangents
+    auto next = std::upper_bound(m_Keyframes.begin(), m_Keyframes.end(), time,
+        [](float t, const CameraKeyframe& key) { return t < key.Time; });
+    size_t i = (size_t)(next - m_Keyframes.begin()) - 1;
+
+    const CameraKeyframe& k1 = m_Keyframes[i];
+    const CameraKeyframe& k2 = m_Keyframes[i + 1];
+    const CameraKeyframe& k0 = m_Keyframes[i > 0 ? i - 1 : i];
+    const CameraKeyframe& k3 = m_Keyframes[std::min(i + 2, m_Keyframes.size() - 1)];
+
+    float t = (time - k1.Time) / (k2.Time - k1.Time);
+
+    float yawDelta = std::fmod(k2.Yaw - k1.Yaw, 360.0f);
+    if (yawDelta > 180.0f) yawDelta -= 360.0f;
+    if (yawDelta < -180.0f) yawDelta += 360.0f;
+
+    camera.SetPosition(CatmullRom(k0.Position, k1.Position, k2.Position, k3.Position, t));
+    camera.SetYaw(k1.Yaw + yawDelta * t);
+    camera.SetPitch(glm::mix(k1.Pitch, k2.Pitch, t));
+}
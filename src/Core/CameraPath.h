@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+struct CameraKeyframe
+{
+    float Time;         // seconds
+    glm::vec3 Position;
+    float Yaw;          // degrees, like Camera
+    float Pitch;
+};
+
+// keyframed camera flight for benchmarks. text file, one keyframe per line:
+//   time x y z yaw pitch
+// '#' starts a comment, keyframes must be in increasing time. positions follow a catmull-rom
+// spline through the keys, yaw and pitch are interpolated linearly (yaw the short way around)
+class CameraPath
+{
+
+public:
+    bool Load(const std::string& path);
+
+    void Apply(Camera& camera, float time) const;
+
+    float GetDuration() const { return m_Keyframes.empty() ? 0.0f : m_Keyframes.back().Time; }
+    const std::vector<CameraKeyframe>& GetKeyframes() const { return m_Keyframes; }
+
+private:
+    std::vector<CameraKeyframe> m_Keyframes;
+};
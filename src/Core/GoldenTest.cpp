@@ -0,0 +1,129 @@
+#include "GoldenTest.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool GoldenManifest::Load(const std::string& path)
+{
+    Views.clear();
+    Thresholds.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Golden: could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.resize(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        std::istringstream stream(line);
+        std::string directive;
+        stream >> directive;
+
+        bool ok = false;
+        if (directive == "resolution") ok = (bool)(stream >> Width >> Height) && Width > 0 && Height > 0;
+        else if (directive == "frames") ok = (bool)(stream >> WarmupFrames >> MeasuredFrames) && WarmupFrames >= 0 && MeasuredFrames > 0;
+        else if (directive == "sun")
+        {
+            glm::vec3 direction;
+            ok = (bool)(stream >> direction.x >> direction.y >> direction.z >> SunIntensity) && glm::length(direction) > 0.0f;
+            if (ok) SunDirection = glm::normalize(direction);
+        }
+        else if (directive == "view")
+        {
+            GoldenView view;
+            ok = (bool)(stream >> view.Name >> view.Scene >> view.Position.x >> view.Position.y >> view.Position.z >> view.Yaw >> view.Pitch);
+            if (ok) Views.push_back(view);
+        }
+        else if (directive == "threshold")
+        {
+            GoldenThreshold threshold;
+            ok = (bool)(stream >> threshold.Target >> threshold.MinPSNR >> threshold.MinSSIM >> threshold.MaxError);
+            if (ok) Thresholds.push_back(threshold);
+        }
+
+        if (!ok)
+        {
+            std::cout << "Golden: " << path << ":" << lineNumber << " can't read '" << line << "'" << std::endl;
+            return false;
+        }
+    }
+
+    if (Views.empty())
+    {
+        std::cout << "Golden: " << path << " has no views" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+GoldenThreshold GoldenManifest::GetThreshold(const std::string& target) const
+{
+    GoldenThreshold result;
+    for (const GoldenThreshold& threshold : Thresholds)
+    {
+        if (threshold.Target == "*" || threshold.Target == target) result = threshold;
+    }
+    return result;
+}
+
+// identical images have an infinite PSNR, JSON has no literal for that
+static void WriteGoldenNumber(std::ofstream& out, double value)
+{
+    if (std::isfinite(value)) out << value;
+    else out << "null";
+}
+
+bool WriteGoldenSummary(const std::vector<GoldenViewSummary>& views, const std::vector<GoldenResult>& results, const std::string& path)
+{
+    std::ofstream json(path);
+    if (!json.is_open())
+    {
+        std::cout << "Golden: could not write " << path << std::endl;
+        return false;
+    }
+
+    json << "{\n  \"views\": [\n";
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        const GoldenViewSummary& view = views[i];
+        json << "    { \"name\": \"" << view.View << "\", \"skipped\": " << (view.Skipped ? "true" : "false")
+             << ", \"frame_ms\": " << view.FrameMs << ", \"gpu_ms\": " << view.GpuMs << " }"
+             << (i + 1 < views.size() ? ",\n" : "\n");
+    }
+    json << "  ],\n  \"images\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const GoldenResult& result = results[i];
+        json << "    { \"view\": \"" << result.View << "\", \"target\": \"" << result.Target << "\""
+             << ", \"reference\": " << (result.HasReference ? "true" : "false")
+             << ", \"passed\": " << (result.Passed ? "true" : "false")
+             << ", \"psnr\": "; WriteGoldenNumber(json, result.Diff.PSNR);
+        json << ", \"ssim\": " << result.Diff.SSIM
+             << ", \"mean_error\": " << result.Diff.MeanError
+             << ", \"max_error\": " << result.Diff.MaxError
+             << ", \"min_psnr\": " << result.Threshold.MinPSNR
+             << ", \"min_ssim\": " << result.Threshold.MinSSIM
+             << ", \"max_error_allowed\": " << result.Threshold.MaxError << " }"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+
+    if (!json.good())
+    {
+        std::cout << "Golden: failed writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.h"
+#include "Renderer/ImageDiff.h"
+
+// fixed views rendered by EchoGolden and compared against stored reference images. the manifest
+// is a text file, one directive per line, # comments:
+//   resolution <width> <height>
+//   frames <warmup> <measured>          per view, the readback happens after the measured frames
+//   sun <x> <y> <z> <intensity>
+//   view <name> <obj> <x> <y> <z> <yaw> <pitch>
+//   threshold <target|*> <min psnr> <min ssim> <max error>
+// targets are the names from Renderer::ReadbackTargets, the last matching threshold wins
+
+struct GoldenView
+{
+    std::string Name;
+    std::string Scene;
+    glm::vec3 Position = glm::vec3(0.0f);
+    float Yaw = 0.0f, Pitch = 0.0f;
+};
+
+struct GoldenThreshold
+{
+    std::string Target = "*";
+    double MinPSNR = 40.0;
+    double MinSSIM = 0.98;
+    uint MaxError = 16;
+};
+
+struct GoldenManifest
+{
+    int Width = 480;
+    int Height = 270;
+    int WarmupFrames = 32;
+    int MeasuredFrames = 16;
+    glm::vec3 SunDirection = glm::normalize(glm::vec3(-0.26f, -0.56f, -0.78f));
+    float SunIntensity = 20.0f;
+    std::vector<GoldenView> Views;
+    std::vector<GoldenThreshold> Thresholds;
+
+    bool Load(const std::string& path);
+    GoldenThreshold GetThreshold(const std::string& target) const;
+};
+
+// one target of one view
+struct GoldenResult
+{
+    std::string View;
+    std::string Target;
+    ImageDiffResult Diff;
+    GoldenThreshold Threshold;
+    bool HasReference = false;
+    bool Passed = false;
+};
+
+// one per view, frame times are the averages of its measured frames
+struct GoldenViewSummary
+{
+    std::string View;
+    bool Skipped = false;   // scene not found
+    double FrameMs = 0.0;
+    double GpuMs = 0.0;     // top level GPU scopes summed
+};
+
+bool WriteGoldenSummary(const std::vector<GoldenViewSummary>& views, const std::vector<GoldenResult>& results, const std::string& path);
@@ -0,0 +1,40 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+
+// GLFW's null platform gets its context from EGL (surfaceless on mesa) or OSMesa and needs no
+// display server, a hidden window on the native platform is the fallback. nothing is presented
+// either way, the renderer draws into its own output framebuffer
+GLFWwindow* CreateHeadlessWindow(int width, int height)
+{
+    struct Attempt { int Platform; int ContextAPI; const char* Name; };
+    const Attempt attempts[] = {
+        { GLFW_PLATFORM_NULL, GLFW_EGL_CONTEXT_API,    "null platform, EGL" },
+        { GLFW_PLATFORM_NULL, GLFW_OSMESA_CONTEXT_API, "null platform, OSMesa" },
+        { GLFW_ANY_PLATFORM,  GLFW_NATIVE_CONTEXT_API, "hidden window" },
+    };
+
+    for (const Attempt& attempt : attempts)
+    {
+        glfwInitHint(GLFW_PLATFORM, attempt.Platform);
+        if (!glfwInit()) continue;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, attempt.ContextAPI);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(width, height, "EchoEngine", nullptr, nullptr);
+        if (window)
+        {
+            std::cout << "Headless: GL context from " << attempt.Name << std::endl;
+            return window;
+        }
+
+        std::cout << "Headless: no GL 4.6 context from " << attempt.Name << std::endl;
+        glfwTerminate();
+    }
+
+    return nullptr;
+}
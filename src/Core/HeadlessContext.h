@@ -0,0 +1,8 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// invisible 4.6 core context for --benchmark and the tools, made current by the caller.
+// glfwInit() is done here, nullptr (and glfw terminated) when no context could be created
+GLFWwindow* CreateHeadlessWindow(int width, int height);
@@ -0,0 +1,137 @@
+#include "LaunchOptions.h"
+
+#include <iostream>
+#include <charconv>
+#include <cstring>
+
+static bool ParseIntArgument(const char* flag, const char* value, int minimum, int& out)
+{
+    const char* end = value + std::strlen(value);
+    auto [ptr, ec] = std::from_chars(value, end, out);
+    if (ec != std::errc() || ptr != end || out < minimum)
+    {
+        std::cout << flag << " expects an integer >= " << minimum << ", got '" << value << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ParseLaunchOptions(int argc, char** argv, LaunchOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        auto needsValue = [&]() {
+            if (value) return true;
+            std::cout << arg << " expects a value" << std::endl;
+            return false;
+        };
+
+        if (arg == "--help" || arg == "-h")
+        {
+            options.ShowUsage = true;
+        }
+        else if (arg == "--benchmark")
+        {
+            options.Benchmark = true;
+        }
+        else if (arg == "--warmup")
+        {
+            if (!needsValue() || !ParseIntArgument("--warmup", value, 0, options.WarmupFrames)) return false;
+            ++i;
+        }
+        else if (arg == "--frames")
+        {
+            if (!needsValue() || !ParseIntArgument("--frames", value, 1, options.MeasuredFrames)) return false;
+            ++i;
+        }
+        else if (arg == "--width")
+        {
+            if (!needsValue() || !ParseIntArgument("--width", value, 1, options.Width)) return false;
+            ++i;
+        }
+        else if (arg == "--height")
+        {
+            if (!needsValue() || !ParseIntArgument("--height", value, 1, options.Height)) return false;
+            ++i;
+        }
+        else if (arg == "--scene")
+        {
+            if (!needsValue()) return false;
+            options.ScenePath = argv[++i];
+        }
+        else if (arg == "--camera-path")
+        {
+            if (!needsValue()) return false;
+            options.CameraPath = argv[++i];
+        }
+        else if (arg == "--output")
+        {
+            if (!needsValue()) return false;
+            options.OutputPath = argv[++i];
+        }
+        else if (arg == "--shader-cache")
+        {
+            if (!needsValue()) return false;
+            options.ShaderCacheDir = argv[++i];
+        }
+        else if (arg == "--no-shader-cache")
+        {
+            options.ShaderCacheDir.clear();
+        }
+        else if (arg == "--texture-cache")
+        {
+            if (!needsValue()) return false;
+            options.TextureCacheDir = argv[++i];
+        }
+        else if (arg == "--no-texture-cache")
+        {
+            options.TextureCacheDir.clear();
+        }
+        else if (arg == "--serial-shaders")
+        {
+            options.SerialShaders = true;
+        }
+        else if (arg == "--no-shader-watch")
+        {
+            options.WatchShaders = false;
+        }
+        else if (arg == "--no-texture-streaming")
+        {
+            options.TextureStreaming = false;
+        }
+        else
+        {
+            std::cout << "Unknown argument '" << arg << "'" << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PrintUsage(const char* program)
+{
+    std::cout
+        << "usage: " << program << " [options]\n"
+        << "  --benchmark           render offscreen along a camera path and write timings, then exit\n"
+        << "  --warmup <n>          frames rendered before measuring (60)\n"
+        << "  --frames <n>          measured frames (600)\n"
+        << "  --width <px>          render width (1280)\n"
+        << "  --height <px>         render height (720)\n"
+        << "  --scene <obj>         model to load (assets/models/terrain.obj)\n"
+        << "  --camera-path <file>  keyframes, see assets/benchmarks (terrain_flyover.campath)\n"
+        << "  --output <json>       results, a .csv with the per frame table is written next to it (benchmark.json)\n"
+        << "  --shader-cache <dir>  program binaries from earlier runs (shader_cache)\n"
+        << "  --no-shader-cache     always compile the shaders\n"
+        << "  --texture-cache <dir> mip chains built by earlier loads (texture_cache)\n"
+        << "  --no-texture-cache    always build the mip chains\n"
+        << "  --serial-shaders      compile and check one program at a time instead of all at once\n"
+        << "  --no-shader-watch     don't reload shaders when their files change (R still reloads all)\n"
+        << "  --no-texture-streaming  upload material textures whole the first time they are drawn\n"
+        << "exit codes: 0 ok, 1 bad arguments, 2 no GL context, 3 scene or camera path failed to load,\n"
+        << "            4 GL errors while rendering, 5 results could not be written" << std::endl;
+}
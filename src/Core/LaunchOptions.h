@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+// everything that can be set from the command line, see PrintUsage() for the flags
+enum class ExitCode : int
+{
+    Ok = 0,
+    BadArguments = 1,
+    NoContext = 2,
+    LoadFailed = 3,     // scene or camera path
+    GLErrors = 4,
+    WriteFailed = 5,
+    ReplayMismatch = 6, // EchoReplay only
+    GoldenMismatch = 7  // EchoGolden only, an image is off or has no reference
+};
+
+struct LaunchOptions
+{
+    bool ShowUsage = false;
+    bool Benchmark = false;
+    int WarmupFrames = 60;
+    int MeasuredFrames = 600;
+    int Width = 1280;
+    int Height = 720;
+    std::string ScenePath = "assets/models/terrain.obj";
+    std::string CameraPath = "assets/benchmarks/terrain_flyover.campath";
+    std::string OutputPath = "benchmark.json";   // the CSV goes next to it
+    std::string ShaderCacheDir = "shader_cache"; // empty disables it
+    std::string TextureCacheDir = "texture_cache"; // mip chains, empty disables it
+    bool SerialShaders = false;                  // compile one shader at a time, for comparing startup
+    bool WatchShaders = true;                    // reload shaders as assets/shaders changes, not in benchmark mode
+    bool TextureStreaming = true;                // upload material mips as draws need them
+};
+
+// false on unknown or malformed arguments, after printing why
+bool ParseLaunchOptions(int argc, char** argv, LaunchOptions& options);
+void PrintUsage(const char* program);
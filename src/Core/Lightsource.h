@@ -20,6 +20,9 @@ public:
     glm::vec3 Color { 1.0f };
     float Intensity { 1.0f };
 
+    // point and spot lights only, the sun always uses the cascades
+    bool CastShadows { false };
+
 };
 
 class DirectionalLight : public Light
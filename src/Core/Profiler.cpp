@@ -0,0 +1,376 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ECHO_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ECHO_PROFILER_RDTSC 1
+#endif
+
+namespace
+{
+    constexpr uint32_t PROFILER_THREAD_EVENTS = 1 << 16;   // per thread, power of two
+    constexpr uint32_t PROFILER_MAX_DEPTH = 64;
+    constexpr uint32_t PROFILER_FRAME_HISTORY = 256;
+    constexpr uint32_t PROFILER_GPU_EVENTS = 1 << 14;
+    // gpu scopes come back a few frames late, see GPU_TIMER_QUERY_COUNT
+    constexpr uint32_t PROFILER_GPU_LAG = 8;
+
+    struct RawCpuEvent
+    {
+        const char* Name;
+        uint64_t Start;
+        uint64_t End;
+        uint32_t Depth;
+    };
+
+    struct OpenScope
+    {
+        const char* Name;
+        uint64_t Start;     // 0 when the profiler was disabled at BeginScope
+    };
+
+    // one writer (the owning thread), readers only look at entries below Written
+    struct ThreadEvents
+    {
+        uint32_t Id = 0;
+        std::string Name;
+        std::unique_ptr<RawCpuEvent[]> Events = std::make_unique<RawCpuEvent[]>(PROFILER_THREAD_EVENTS);
+        std::atomic<uint64_t> Written = 0;
+
+        OpenScope Stack[PROFILER_MAX_DEPTH];
+        uint32_t Depth = 0;
+    };
+
+    struct RawGpuEvent
+    {
+        const char* Name;
+        uint64_t Frame;
+        uint64_t StartNs;
+        uint64_t EndNs;
+        uint32_t Depth;
+    };
+
+    std::mutex s_ProfilerMutex;
+    // never freed, a thread that exited can still have events in the history
+    std::vector<std::unique_ptr<ThreadEvents>> s_ProfilerThreads;
+    std::unordered_set<std::string> s_ProfilerNames;
+    thread_local ThreadEvents* t_ProfilerThread = nullptr;
+
+    std::atomic<bool> s_ProfilerEnabled = true;
+
+    uint64_t s_EpochTicks = 0;
+    std::chrono::steady_clock::time_point s_EpochTime;
+    double s_NsPerTick = 1.0;
+    int64_t s_GpuToCpuNs = 0;
+
+    // in ticks, converted on the way out like the events so recalibrating keeps them lined up
+    struct RawFrame
+    {
+        uint64_t Start;
+        uint64_t End;
+    };
+
+    RawFrame s_ProfilerFrames[PROFILER_FRAME_HISTORY];
+    uint64_t s_ProfilerFrameIndex = 0;
+    uint64_t s_ProfilerFrameStart = 0;
+
+    RawGpuEvent s_ProfilerGpuEvents[PROFILER_GPU_EVENTS];
+    uint64_t s_ProfilerGpuWritten = 0;
+
+    uint64_t s_CaptureFirst = 0;
+    uint64_t s_CaptureLast = 0;
+    bool s_Capturing = false;
+}
+
+static inline uint64_t ReadProfilerTicks()
+{
+#ifdef ECHO_PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static uint64_t TicksToNs(uint64_t ticks)
+{
+    return ticks > s_EpochTicks ? (uint64_t)((ticks - s_EpochTicks) * s_NsPerTick) : 0;
+}
+
+static uint64_t SteadyNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_EpochTime).count();
+}
+
+// tick rate against steady_clock, rough on the first call, refined every frame as the baseline grows
+static void CalibrateTicks()
+{
+    uint64_t elapsedNs = SteadyNow();
+    uint64_t elapsedTicks = ReadProfilerTicks() - s_EpochTicks;
+    if (elapsedNs > 0 && elapsedTicks > 0) s_NsPerTick = (double)elapsedNs / (double)elapsedTicks;
+}
+
+static ThreadEvents& GetProfilerThread()
+{
+    if (t_ProfilerThread) return *t_ProfilerThread;
+
+    std::lock_guard lock(s_ProfilerMutex);
+    if (s_ProfilerThreads.empty())
+    {
+        s_EpochTime = std::chrono::steady_clock::now();
+        s_EpochTicks = ReadProfilerTicks();
+
+        // a millisecond of spinning gives a usable rate before the first frame ends
+        while (SteadyNow() < 1000000) {}
+        CalibrateTicks();
+    }
+
+    auto thread = std::make_unique<ThreadEvents>();
+    thread->Id = (uint32_t)s_ProfilerThreads.size();
+    thread->Name = thread->Id == 0 ? "Main" : "Thread " + std::to_string(thread->Id);
+    t_ProfilerThread = thread.get();
+    s_ProfilerThreads.push_back(std::move(thread));
+    return *t_ProfilerThread;
+}
+
+void Profiler::BeginScope(const char* name)
+{
+    ThreadEvents& thread = GetProfilerThread();
+    if (thread.Depth >= PROFILER_MAX_DEPTH) { thread.Depth++; return; }
+
+    OpenScope& scope = thread.Stack[thread.Depth++];
+    scope.Name = name;
+    scope.Start = s_ProfilerEnabled.load(std::memory_order_relaxed) ? ReadProfilerTicks() : 0;
+}
+
+void Profiler::EndScope()
+{
+    ThreadEvents& thread = *t_ProfilerThread;
+    uint32_t depth = --thread.Depth;
+    if (depth >= PROFILER_MAX_DEPTH) return;
+
+    const OpenScope& scope = thread.Stack[depth];
+    if (scope.Start == 0) return;
+
+    uint64_t written = thread.Written.load(std::memory_order_relaxed);
+    thread.Events[written & (PROFILER_THREAD_EVENTS - 1)] = { scope.Name, scope.Start, ReadProfilerTicks(), depth };
+    thread.Written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::AddGpuEvent(const char* name, uint32_t depth, uint64_t frame, uint64_t gpuBeginNs, uint64_t gpuEndNs)
+{
+    if (!s_ProfilerEnabled.load(std::memory_order_relaxed)) return;
+
+    RawGpuEvent& event = s_ProfilerGpuEvents[s_ProfilerGpuWritten++ & (PROFILER_GPU_EVENTS - 1)];
+    event.Name = name;
+    event.Frame = frame;
+    event.StartNs = (uint64_t)std::max<int64_t>((int64_t)gpuBeginNs + s_GpuToCpuNs, 0);
+    event.EndNs = (uint64_t)std::max<int64_t>((int64_t)gpuEndNs + s_GpuToCpuNs, 0);
+    event.Depth = depth;
+}
+
+void Profiler::CalibrateGpuClock(uint64_t gpuNowNs)
+{
+    GetProfilerThread();
+    s_GpuToCpuNs = (int64_t)TicksToNs(ReadProfilerTicks()) - (int64_t)gpuNowNs;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadEvents& thread = GetProfilerThread();
+    std::lock_guard lock(s_ProfilerMutex);
+    thread.Name = name;
+}
+
+std::string Profiler::GetThreadName(uint32_t thread)
+{
+    if (thread == GpuThread) return "GPU";
+
+    std::lock_guard lock(s_ProfilerMutex);
+    return thread < s_ProfilerThreads.size() ? s_ProfilerThreads[thread]->Name : "Unknown";
+}
+
+const char* Profiler::Intern(const std::string& name)
+{
+    std::lock_guard lock(s_ProfilerMutex);
+    return s_ProfilerNames.insert(name).first->c_str();
+}
+
+void Profiler::EndFrame()
+{
+    GetProfilerThread();
+    CalibrateTicks();
+
+    uint64_t now = ReadProfilerTicks();
+    if (s_ProfilerFrameStart == 0) s_ProfilerFrameStart = s_EpochTicks;
+    s_ProfilerFrames[s_ProfilerFrameIndex % PROFILER_FRAME_HISTORY] = { s_ProfilerFrameStart, now };
+    s_ProfilerFrameIndex++;
+    s_ProfilerFrameStart = now;
+
+    if (s_Capturing && s_ProfilerFrameIndex > s_CaptureLast + PROFILER_GPU_LAG)
+    {
+        s_Capturing = false;
+        std::string path = "echo_trace_" + std::to_string(s_CaptureFirst) + "-" + std::to_string(s_CaptureLast) + ".json";
+        if (WriteChromeTrace(path, s_CaptureFirst, s_CaptureLast)) std::cout << "Profiler: wrote " << path << std::endl;
+    }
+}
+
+uint64_t Profiler::GetFrameIndex()
+{
+    return s_ProfilerFrameIndex;
+}
+
+bool Profiler::GetFrame(uint64_t index, ProfileFrame& frame)
+{
+    if (index >= s_ProfilerFrameIndex || s_ProfilerFrameIndex - index > PROFILER_FRAME_HISTORY) return false;
+    const RawFrame& raw = s_ProfilerFrames[index % PROFILER_FRAME_HISTORY];
+    frame = { index, TicksToNs(raw.Start), TicksToNs(raw.End) };
+    return true;
+}
+
+void Profiler::GetEvents(uint64_t firstFrame, uint64_t lastFrame, std::vector<ProfileEvent>& events)
+{
+    ProfileFrame first, last;
+    if (!GetFrame(firstFrame, first) || !GetFrame(lastFrame, last)) return;
+
+    {
+        std::lock_guard lock(s_ProfilerMutex);
+        for (const auto& thread : s_ProfilerThreads)
+        {
+            uint64_t written = thread->Written.load(std::memory_order_acquire);
+            uint64_t oldest = written > PROFILER_THREAD_EVENTS ? written - PROFILER_THREAD_EVENTS : 0;
+            for (uint64_t i = oldest; i < written; ++i)
+            {
+                const RawCpuEvent& raw = thread->Events[i & (PROFILER_THREAD_EVENTS - 1)];
+                uint64_t start = TicksToNs(raw.Start);
+                if (start < first.StartNs || start >= last.EndNs) continue;
+                events.push_back({ raw.Name, start, TicksToNs(raw.End), thread->Id, raw.Depth });
+            }
+        }
+    }
+
+    uint64_t oldest = s_ProfilerGpuWritten > PROFILER_GPU_EVENTS ? s_ProfilerGpuWritten - PROFILER_GPU_EVENTS : 0;
+    for (uint64_t i = oldest; i < s_ProfilerGpuWritten; ++i)
+    {
+        const RawGpuEvent& raw = s_ProfilerGpuEvents[i & (PROFILER_GPU_EVENTS - 1)];
+        if (raw.Frame < firstFrame || raw.Frame > lastFrame) continue;
+        events.push_back({ raw.Name, raw.StartNs, raw.EndNs, GpuThread, raw.Depth });
+    }
+
+    std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+        return a.StartNs != b.StartNs ? a.StartNs < b.StartNs : a.Depth < b.Depth;
+    });
+}
+
+static void WriteJsonString(std::ofstream& out, const char* s)
+{
+    out << '"';
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\') out << '\\';
+        if ((unsigned char)*s < 0x20) continue;
+        out << *s;
+    }
+    out << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path, uint64_t firstFrame, uint64_t lastFrame)
+{
+    std::vector<ProfileEvent> events;
+    GetEvents(firstFrame, lastFrame, events);
+
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        std::cout << "Profiler: could not write " << path << std::endl;
+        return false;
+    }
+
+    // the gpu gets its own tid, frames go on a separate track above everything else
+    const uint32_t gpuTid = 1000;
+    const uint32_t frameTid = 1001;
+    auto tid = [&](uint32_t thread) { return thread == GpuThread ? gpuTid : thread; };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    std::vector<uint32_t> threads;
+    for (const ProfileEvent& e : events)
+    {
+        if (std::find(threads.begin(), threads.end(), e.Thread) == threads.end()) threads.push_back(e.Thread);
+    }
+
+    bool firstEntry = true;
+    auto separator = [&] { if (!firstEntry) out << ",\n"; firstEntry = false; };
+
+    for (uint32_t thread : threads)
+    {
+        separator();
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid(thread) << ",\"args\":{\"name\":";
+        WriteJsonString(out, GetThreadName(thread).c_str());
+        out << "}}";
+    }
+    separator();
+    out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << frameTid << ",\"args\":{\"name\":\"Frames\"}}";
+
+    for (uint64_t f = firstFrame; f <= lastFrame; ++f)
+    {
+        ProfileFrame frame;
+        if (!GetFrame(f, frame)) continue;
+        separator();
+        out << "{\"ph\":\"X\",\"cat\":\"frame\",\"name\":\"Frame " << f << "\",\"pid\":1,\"tid\":" << frameTid
+            << ",\"ts\":" << frame.StartNs / 1000.0 << ",\"dur\":" << (frame.EndNs - frame.StartNs) / 1000.0 << "}";
+    }
+
+    for (const ProfileEvent& e : events)
+    {
+        separator();
+        out << "{\"ph\":\"X\",\"cat\":\"" << (e.Thread == GpuThread ? "gpu" : "cpu") << "\",\"name\":";
+        WriteJsonString(out, e.Name);
+        out << ",\"pid\":1,\"tid\":" << tid(e.Thread) << ",\"ts\":" << e.StartNs / 1000.0
+            << ",\"dur\":" << (e.EndNs > e.StartNs ? e.EndNs - e.StartNs : 0) / 1000.0 << "}";
+    }
+
+    out << "\n]}\n";
+    return out.good();
+}
+
+void Profiler::CaptureFrames(uint32_t count)
+{
+    if (count == 0) return;
+    count = std::min(count, GetMaxCaptureFrames());
+    s_CaptureFirst = s_ProfilerFrameIndex;
+    s_CaptureLast = s_ProfilerFrameIndex + count - 1;
+    s_Capturing = true;
+}
+
+bool Profiler::IsCapturing()
+{
+    return s_Capturing;
+}
+
+uint32_t Profiler::GetMaxCaptureFrames()
+{
+    return PROFILER_FRAME_HISTORY - PROFILER_GPU_LAG - 1;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    s_ProfilerEnabled = enabled;
+}
+
+bool Profiler::IsEnabled()
+{
+    return s_ProfilerEnabled;
+}
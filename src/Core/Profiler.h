@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// hierarchical CPU scopes per thread plus the GPU timestamp scopes from RenderProfiler on one timeline.
+// a scope costs a tick read and a few stores into a thread local ring, nothing is locked after the
+// first event of a thread. names are stored by pointer and must outlive the profiler: literals or
+// Profiler::Intern(). PROFILE_SCOPE compiles to nothing unless built with ECHO_PROFILER
+
+struct ProfileEvent
+{
+    const char* Name;
+    uint64_t StartNs;   // since the profiler started
+    uint64_t EndNs;
+    uint32_t Thread;    // Profiler::GpuThread for GPU scopes
+    uint32_t Depth;
+};
+
+struct ProfileFrame
+{
+    uint64_t Index;
+    uint64_t StartNs;
+    uint64_t EndNs;
+};
+
+class Profiler
+{
+
+public:
+    static constexpr uint32_t GpuThread = 0xFFFFFFFF;
+
+    static void BeginScope(const char* name);
+    static void EndScope();
+
+    // from GpuTimer once a result is read back, gpu clock in ns
+    static void AddGpuEvent(const char* name, uint32_t depth, uint64_t frame, uint64_t gpuBeginNs, uint64_t gpuEndNs);
+    // gpu clock right now (GL_TIMESTAMP), maps the gpu events onto the cpu timeline
+    static void CalibrateGpuClock(uint64_t gpuNowNs);
+
+    static void SetThreadName(const char* name);
+    static std::string GetThreadName(uint32_t thread);
+    static const char* Intern(const std::string& name);
+
+    // main thread, once per frame
+    static void EndFrame();
+    static uint64_t GetFrameIndex();
+
+    // only the last few hundred frames are kept
+    static bool GetFrame(uint64_t index, ProfileFrame& frame);
+    static void GetEvents(uint64_t firstFrame, uint64_t lastFrame, std::vector<ProfileEvent>& events);
+
+    // Chrome trace event JSON, open with chrome://tracing or ui.perfetto.dev
+    static bool WriteChromeTrace(const std::string& path, uint64_t firstFrame, uint64_t lastFrame);
+
+    // records the next count frames and writes them out once their gpu scopes came back
+    static void CaptureFrames(uint32_t count);
+    static bool IsCapturing();
+    static uint32_t GetMaxCaptureFrames();
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    static constexpr bool IsCompiledIn()
+    {
+#ifdef ECHO_PROFILER
+        return true;
+#else
+        return false;
+#endif
+    }
+
+};
+
+struct CpuProfileScope
+{
+    CpuProfileScope(const char* name) { Profiler::BeginScope(name); }
+    ~CpuProfileScope() { Profiler::EndScope(); }
+};
+
+#ifdef ECHO_PROFILER
+#define ECHO_PROFILE_CONCAT_INNER(a, b) a##b
+#define ECHO_PROFILE_CONCAT(a, b) ECHO_PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope ECHO_PROFILE_CONCAT(cpu_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+// for spans that don't fit a block, must pair up on the same thread
+#define PROFILE_BEGIN(name) Profiler::BeginScope(name)
+#define PROFILE_END() Profiler::EndScope()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#endif
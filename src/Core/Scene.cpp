@@ -0,0 +1,51 @@
+#include "Scene.h"
+
+#include <random>
+#include <algorithm>
+#include <unordered_set>
+
+void SceneData::SpawnRandomPointLights(int count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint seed)
+{
+    std::mt19937 rng(seed + (uint)m_GeneratedLights.size());
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    m_GeneratedLights.reserve(m_GeneratedLights.size() + count);
+    m_Lights.reserve(m_Lights.size() + count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto light = std::make_unique<PointLight>();
+        light->Position = glm::mix(boundsMin, boundsMax, glm::vec3(unit(rng), unit(rng), unit(rng)));
+
+        // saturated colors so overlapping lights are easy to tell apart
+        float hue = unit(rng) * 6.0f;
+        glm::vec3 color = glm::clamp(glm::vec3(
+            std::abs(hue - 3.0f) - 1.0f,
+            2.0f - std::abs(hue - 2.0f),
+            2.0f - std::abs(hue - 4.0f)
+        ), 0.0f, 1.0f);
+
+        light->Color = color;
+        light->Intensity = 2.0f + unit(rng) * 6.0f;
+
+        // short range, 10-20 units of influence with the culling cutoff
+        light->Constant = 1.0f;
+        light->Linear = 0.7f;
+        light->Quadratic = 1.8f;
+
+        m_Lights.push_back(light.get());
+        m_GeneratedLights.push_back(std::move(light));
+    }
+}
+
+void SceneData::ClearGeneratedLights()
+{
+    std::unordered_set<const Light*> generated;
+    for (const auto& light : m_GeneratedLights) generated.insert(light.get());
+
+    m_Lights.erase(std::remove_if(m_Lights.begin(), m_Lights.end(), [&](Light* light) {
+        return generated.count(light) > 0;
+    }), m_Lights.end());
+
+    m_GeneratedLights.clear();
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "Types.h"
 #include "Camera.h"
 #include "Lightsource.h"
@@ -15,4 +17,12 @@ public:
 	std::vector<Entity*> m_Entities;
 	std::vector<Light*> m_Lights;
 	DirectionalLight m_Sun;
-};
\ No newline at end of file
+
+    // benchmark helpers, spawned lights are owned by the scene and also listed in m_Lights
+    void SpawnRandomPointLights(int count, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint seed = 1337);
+    void ClearGeneratedLights();
+    size_t GetGeneratedLightCount() const { return m_GeneratedLights.size(); }
+
+private:
+    std::vector<std::unique_ptr<Light>> m_GeneratedLights;
+};
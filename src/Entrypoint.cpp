@@ -1,10 +1,17 @@
 #include "Core/Application.h"
+#include "Core/LaunchOptions.h"
 
-int main()
+int main(int argc, char** argv)
 {
-    auto* app = new Application();
+    LaunchOptions options;
+    if (!ParseLaunchOptions(argc, argv, options)) return (int)ExitCode::BadArguments;
+    if (options.ShowUsage)
+    {
+        PrintUsage(argv[0]);
+        return (int)ExitCode::Ok;
+    }
 
-    app->Run();
-    
-    return 0;
+    auto* app = new Application(options);
+
+    return app->Run();
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "BlueNoise.h"
+
+#include <cmath>
+#include <random>
+
+// energy of every pixel is the sum of a gaussian around each set pixel, wrapped around the edges.
+// the tightest cluster is the set pixel with the highest energy, the largest void the empty
+// pixel with the lowest. the kernel is cut off at 4 sigma, which keeps every update local
+namespace
+{
+    struct VoidAndCluster
+    {
+        uint Size;
+        int Radius;
+        std::vector<float> Kernel;
+        std::vector<float> Energy;
+        std::vector<uint8_t> Pattern;
+
+        VoidAndCluster(uint size, float sigma) : Size(size)
+        {
+            Radius = std::min((int)std::ceil(4.0f * sigma), (int)size / 2);
+            int width = Radius * 2 + 1;
+            Kernel.resize(width * width);
+            for (int y = -Radius; y <= Radius; ++y)
+                for (int x = -Radius; x <= Radius; ++x)
+                    Kernel[(y + Radius) * width + (x + Radius)] = std::exp(-(x * x + y * y) / (2.0f * sigma * sigma));
+
+            Energy.assign(size * size, 0.0f);
+            Pattern.assign(size * size, 0);
+        }
+
+        void Toggle(uint index, bool set)
+        {
+            Pattern[index] = set ? 1 : 0;
+
+            int px = index % Size, py = index / Size;
+            int width = Radius * 2 + 1;
+            float sign = set ? 1.0f : -1.0f;
+            for (int y = -Radius; y <= Radius; ++y)
+            {
+                uint wy = (py + y + Size) % Size;
+                for (int x = -Radius; x <= Radius; ++x)
+                {
+                    uint wx = (px + x + Size) % Size;
+                    Energy[wy * Size + wx] += sign * Kernel[(y + Radius) * width + (x + Radius)];
+                }
+            }
+        }
+
+        uint TightestCluster() const
+        {
+            uint best = 0;
+            float bestEnergy = -1e30f;
+            for (uint i = 0; i < Energy.size(); ++i)
+                if (Pattern[i] && Energy[i] > bestEnergy) { bestEnergy = Energy[i]; best = i; }
+            return best;
+        }
+
+        uint LargestVoid() const
+        {
+            uint best = 0;
+            float bestEnergy = 1e30f;
+            for (uint i = 0; i < Energy.size(); ++i)
+                if (!Pattern[i] && Energy[i] < bestEnergy) { bestEnergy = Energy[i]; best = i; }
+            return best;
+        }
+    };
+}
+
+std::vector<uint8_t> BlueNoise::Generate(uint size, float sigma, uint seed)
+{
+    const uint count = size * size;
+    VoidAndCluster state(size, sigma);
+
+    // random initial pattern with about 10% of the pixels set
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint> pick(0, count - 1);
+    uint initialCount = std::max(count / 10, 1u);
+    for (uint placed = 0; placed < initialCount; )
+    {
+        uint index = pick(rng);
+        if (state.Pattern[index]) continue;
+        state.Toggle(index, true);
+        placed++;
+    }
+
+    // move points from the tightest cluster into the largest void until that stops changing anything
+    for (;;)
+    {
+        uint cluster = state.TightestCluster();
+        state.Toggle(cluster, false);
+        uint hole = state.LargestVoid();
+        state.Toggle(hole, true);
+        if (hole == cluster) break;
+    }
+
+    std::vector<uint> rank(count, 0);
+
+    // ranks below the initial pattern, removing clusters from a copy
+    VoidAndCluster removal = state;
+    for (uint ones = initialCount; ones > 0; --ones)
+    {
+        uint cluster = removal.TightestCluster();
+        removal.Toggle(cluster, false);
+        rank[cluster] = ones - 1;
+    }
+
+    // everything above it, filling voids until the pattern is full
+    for (uint ones = initialCount; ones < count; ++ones)
+    {
+        uint hole = state.LargestVoid();
+        state.Toggle(hole, true);
+        rank[hole] = ones;
+    }
+
+    std::vector<uint8_t> result(count);
+    for (uint i = 0; i < count; ++i)
+        result[i] = (uint8_t)((uint64_t)rank[i] * 256 / count);
+    return result;
+}
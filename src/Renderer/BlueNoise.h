@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../Types.h"
+
+// tileable blue noise through void-and-cluster (Ulichney 1993). returns size*size values,
+// every rank spread evenly over 0..255. cheap enough to generate at startup for 64x64
+class BlueNoise
+{
+
+public:
+    static std::vector<uint8_t> Generate(uint size, float sigma = 1.5f, uint seed = 1);
+
+};
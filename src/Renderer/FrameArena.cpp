@@ -0,0 +1,117 @@
+#include "FrameArena.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+FrameArena::FrameArena(size_t capacity) : m_Capacity(capacity)
+{
+    m_Buffer = static_cast<std::byte*>(std::malloc(m_Capacity));
+}
+
+FrameArena::~FrameArena()
+{
+    std::free(m_Buffer);
+    std::free(m_PreviousBuffer);
+}
+
+void FrameArena::Reset()
+{
+#ifndef NDEBUG
+    assert(m_LiveAllocations == 0 && "frame arena memory outlived the frame");
+#endif
+
+    std::free(m_PreviousBuffer);
+    m_PreviousBuffer = nullptr;
+    m_PreviousCapacity = 0;
+
+    // overflowed last frame, grow so the next frames fit into the block again
+    if (m_OverflowCount > 0)
+    {
+        size_t newCapacity = m_Capacity * 2;
+        while (newCapacity < m_Peak + m_OverflowBytes) newCapacity *= 2;
+
+        m_PreviousBuffer = m_Buffer;
+        m_PreviousCapacity = m_Capacity;
+        m_Buffer = static_cast<std::byte*>(std::malloc(newCapacity));
+        m_Capacity = newCapacity;
+        m_GrowCount++;
+
+        m_OverflowCount = 0;
+        m_OverflowBytes = 0;
+    }
+
+    m_Offset = 0;
+}
+
+std::string_view FrameArena::Format(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int length = std::vsnprintf(nullptr, 0, fmt, argsCopy);
+    va_end(argsCopy);
+
+    if (length < 0)
+    {
+        va_end(args);
+        return {};
+    }
+
+    char* dest = static_cast<char*>(Bump(length + 1, alignof(char)));
+    std::vsnprintf(dest, length + 1, fmt, args);
+    va_end(args);
+
+    return std::string_view(dest, length);
+}
+
+void* FrameArena::Bump(size_t bytes, size_t alignment)
+{
+    size_t aligned = (m_Offset + alignment - 1) & ~(alignment - 1);
+
+    if (aligned + bytes > m_Capacity)
+    {
+        m_OverflowCount++;
+        m_OverflowBytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    m_Offset = aligned + bytes;
+    if (m_Offset > m_Peak) m_Peak = m_Offset;
+
+    return m_Buffer + aligned;
+}
+
+bool FrameArena::Owns(const void* p) const
+{
+    const std::byte* ptr = static_cast<const std::byte*>(p);
+    if (ptr >= m_Buffer && ptr < m_Buffer + m_Capacity) return true;
+    return ptr >= m_PreviousBuffer && ptr < m_PreviousBuffer + m_PreviousCapacity;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+#ifndef NDEBUG
+    m_LiveAllocations++;
+#endif
+    return Bump(bytes, alignment);
+}
+
+void FrameArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+#ifndef NDEBUG
+    assert(m_LiveAllocations > 0);
+    m_LiveAllocations--;
+#endif
+
+    // memory from the block is released by Reset(), only overflow allocations go back upstream
+    if (Owns(p)) return;
+
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
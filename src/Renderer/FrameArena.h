@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdarg>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include <string>
+
+#include "Types.h"
+
+// linear bump allocator for data that only lives for one frame.
+// everything handed out is released at once by Reset() (called in Renderer::BeginFrame),
+// deallocate() is a no-op. when the block runs out we fall back to the upstream resource
+// and count it, the block is grown on the next Reset() so steady state stays heap free.
+// nothing allocated from the arena may outlive the frame: containers are locals of the pass that
+// fills them. the block replaced by a grow is kept until the Reset() after, and debug builds
+// assert that every container was destroyed by the time Reset() runs.
+class FrameArena : public std::pmr::memory_resource
+{
+
+public:
+    FrameArena(size_t capacity = 256 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void Reset();
+
+    // printf style formatting into arena memory, valid until the next Reset()
+    std::string_view Format(const char* fmt, ...);
+
+    size_t GetUsed() const { return m_Offset; }
+    size_t GetPeak() const { return m_Peak; }
+    size_t GetCapacity() const { return m_Capacity; }
+    uint GetOverflowCount() const { return m_OverflowCount; }
+    uint GetGrowCount() const { return m_GrowCount; }
+
+private:
+    std::byte* m_Buffer = nullptr;
+    size_t m_Capacity = 0;
+    std::byte* m_PreviousBuffer = nullptr;  // replaced by the last grow
+    size_t m_PreviousCapacity = 0;
+    size_t m_Offset = 0;
+    size_t m_Peak = 0;
+
+    uint m_OverflowCount = 0;
+    size_t m_OverflowBytes = 0;
+    uint m_GrowCount = 0;
+
+#ifndef NDEBUG
+    size_t m_LiveAllocations = 0;   // container allocations, Format() strings aren't counted
+#endif
+
+    void* Bump(size_t bytes, size_t alignment);
+    bool Owns(const void* p) const;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+};
+
+template<typename T>
+using FrameVector = std::pmr::vector<T>;
+using FrameString = std::pmr::string;
@@ -0,0 +1,397 @@
+#include "FrameCapture.h"
+
+#include <iostream>
+
+#include "Core/Profiler.h"
+
+template<typename T>
+static void WriteCapture(std::ofstream& file, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool ReadCapture(std::ifstream& file, T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+// field by field, the structs have padding
+static void WriteCapturedLight(std::ofstream& file, const CapturedLight& light)
+{
+    WriteCapture(file, light.Type);
+    WriteCapture(file, light.CastShadows);
+    WriteCapture(file, light.Color);
+    WriteCapture(file, light.Intensity);
+    WriteCapture(file, light.Position);
+    WriteCapture(file, light.Direction);
+    WriteCapture(file, light.Constant);
+    WriteCapture(file, light.Linear);
+    WriteCapture(file, light.Quadratic);
+    WriteCapture(file, light.InnerCutoff);
+    WriteCapture(file, light.OuterCutoff);
+}
+
+static bool ReadCapturedLight(std::ifstream& file, CapturedLight& light)
+{
+    return ReadCapture(file, light.Type) && ReadCapture(file, light.CastShadows) && ReadCapture(file, light.Color) &&
+           ReadCapture(file, light.Intensity) && ReadCapture(file, light.Position) && ReadCapture(file, light.Direction) &&
+           ReadCapture(file, light.Constant) && ReadCapture(file, light.Linear) && ReadCapture(file, light.Quadratic) &&
+           ReadCapture(file, light.InnerCutoff) && ReadCapture(file, light.OuterCutoff);
+}
+
+static void WriteRenderSettings(std::ofstream& file, const RenderSettings& settings)
+{
+    WriteCapture(file, settings.Exposure);
+    WriteCapture(file, settings.CascadeSplits);
+    WriteCapture(file, settings.GBufferLayout);
+    WriteCapture(file, settings.SSAOMode);
+    WriteCapture(file, settings.SSAOSamples);
+    WriteCapture(file, settings.VolumetricMode);
+    WriteCapture(file, settings.FroxelLocalLights);
+    WriteCapture(file, settings.FogDensity);
+    WriteCapture(file, settings.ShadowCaching);
+    WriteCapture(file, settings.ShadowTileBudget);
+}
+
+static bool ReadRenderSettings(std::ifstream& file, RenderSettings& settings)
+{
+    return ReadCapture(file, settings.Exposure) && ReadCapture(file, settings.CascadeSplits) &&
+           ReadCapture(file, settings.GBufferLayout) && ReadCapture(file, settings.SSAOMode) &&
+           ReadCapture(file, settings.SSAOSamples) && ReadCapture(file, settings.VolumetricMode) &&
+           ReadCapture(file, settings.FroxelLocalLights) && ReadCapture(file, settings.FogDensity) &&
+           ReadCapture(file, settings.ShadowCaching) && ReadCapture(file, settings.ShadowTileBudget);
+}
+
+bool FrameCaptureWriter::Open(const std::string& path)
+{
+    Close();
+
+    m_File.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_File.is_open())
+    {
+        std::cout << "FrameCapture: could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    m_Path = path;
+    m_MeshIds.clear();
+    m_FrameCount = 0;
+
+    m_File.write("ECAP", 4);
+    WriteCapture(m_File, FRAME_CAPTURE_VERSION);
+    return true;
+}
+
+void FrameCaptureWriter::WriteFrame(const SceneData& scene, const RenderSettings& settings, u32 width, u32 height, u32 drawCount)
+{
+    if (!m_File.is_open()) return;
+    PROFILE_FUNCTION();
+
+    // mesh records first, the frame refers to them by id
+    for (const Entity* entity : scene.m_Entities)
+    {
+        if (!entity->meshAsset || entity->meshAsset->Filepath.empty()) continue;
+
+        const std::string& path = entity->meshAsset->Filepath;
+        if (m_MeshIds.count(path)) continue;
+
+        u32 id = (u32)m_MeshIds.size();
+        m_MeshIds[path] = id;
+
+        m_File.put('M');
+        WriteCapture(m_File, id);
+        WriteCapture(m_File, (u32)path.size());
+        m_File.write(path.data(), path.size());
+    }
+
+    m_File.put('F');
+
+    const Camera& camera = *scene.activeCamera;
+    glm::mat4 projection = camera.GetProjectionMatrix();
+    WriteCapture(m_File, camera.GetPosition());
+    WriteCapture(m_File, camera.GetYaw());
+    WriteCapture(m_File, camera.GetPitch());
+    WriteCapture(m_File, camera.GetFOV());
+    WriteCapture(m_File, camera.GetNear());
+    WriteCapture(m_File, camera.GetFar());
+    WriteCapture(m_File, projection[1][1] / projection[0][0]);
+
+    WriteCapture(m_File, scene.m_Sun.Direction);
+    WriteCapture(m_File, scene.m_Sun.Color);
+    WriteCapture(m_File, scene.m_Sun.Intensity);
+
+    WriteRenderSettings(m_File, settings);
+
+    WriteCapture(m_File, (u32)scene.m_Lights.size());
+    for (const Light* light : scene.m_Lights)
+    {
+        CapturedLight captured = {};
+        captured.Type = (u8)light->GetType();
+        captured.CastShadows = light->CastShadows;
+        captured.Color = light->Color;
+        captured.Intensity = light->Intensity;
+
+        if (auto* d = dynamic_cast<const DirectionalLight*>(light))
+        {
+            captured.Direction = d->Direction;
+        }
+        else if (auto* p = dynamic_cast<const PointLight*>(light))
+        {
+            captured.Position = p->Position;
+            captured.Constant = p->Constant;
+            captured.Linear = p->Linear;
+            captured.Quadratic = p->Quadratic;
+        }
+        else if (auto* s = dynamic_cast<const SpotLight*>(light))
+        {
+            captured.Position = s->Position;
+            captured.Direction = s->Direction;
+            captured.Constant = s->Constant;
+            captured.InnerCutoff = s->InnerCutoff;
+            captured.OuterCutoff = s->OuterCutoff;
+        }
+
+        WriteCapturedLight(m_File, captured);
+    }
+
+    u32 entityCount = 0;
+    for (const Entity* entity : scene.m_Entities)
+    {
+        if (entity->meshAsset && !entity->meshAsset->Filepath.empty()) entityCount++;
+    }
+
+    WriteCapture(m_File, entityCount);
+    for (const Entity* entity : scene.m_Entities)
+    {
+        if (!entity->meshAsset || entity->meshAsset->Filepath.empty()) continue;
+
+        WriteCapture(m_File, m_MeshIds[entity->meshAsset->Filepath]);
+        WriteCapture(m_File, (u8)entity->isStatic);
+        WriteCapture(m_File, (u32)entity->transformVersion);
+        WriteCapture(m_File, entity->transform);
+    }
+
+    WriteCapture(m_File, width);
+    WriteCapture(m_File, height);
+    WriteCapture(m_File, drawCount);
+    m_FrameCount++;
+}
+
+void FrameCaptureWriter::Close()
+{
+    if (!m_File.is_open()) return;
+
+    m_File.close();
+    if (m_File.fail()) std::cout << "FrameCapture: failed writing " << m_Path << std::endl;
+    else std::cout << "FrameCapture: wrote " << m_FrameCount << " frames to " << m_Path << std::endl;
+}
+
+static bool ReadCapturedFrame(std::ifstream& file, CapturedFrame& frame)
+{
+    CapturedCamera& camera = frame.Camera;
+    if (!(ReadCapture(file, camera.Position) && ReadCapture(file, camera.Yaw) && ReadCapture(file, camera.Pitch) &&
+          ReadCapture(file, camera.FOV) && ReadCapture(file, camera.Near) && ReadCapture(file, camera.Far) &&
+          ReadCapture(file, camera.Aspect)))
+        return false;
+
+    if (!(ReadCapture(file, frame.SunDirection) && ReadCapture(file, frame.SunColor) && ReadCapture(file, frame.SunIntensity)))
+        return false;
+
+    if (!ReadRenderSettings(file, frame.Settings)) return false;
+
+    u32 lightCount = 0;
+    if (!ReadCapture(file, lightCount)) return false;
+    frame.Lights.resize(lightCount);
+    for (CapturedLight& light : frame.Lights)
+    {
+        if (!ReadCapturedLight(file, light)) return false;
+    }
+
+    u32 entityCount = 0;
+    if (!ReadCapture(file, entityCount)) return false;
+    frame.Entities.resize(entityCount);
+    for (CapturedEntity& entity : frame.Entities)
+    {
+        if (!(ReadCapture(file, entity.Mesh) && ReadCapture(file, entity.IsStatic) &&
+              ReadCapture(file, entity.TransformVersion) && ReadCapture(file, entity.Transform)))
+            return false;
+    }
+
+    return ReadCapture(file, frame.Width) && ReadCapture(file, frame.Height) && ReadCapture(file, frame.DrawCount);
+}
+
+bool FrameReplay::Load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "FrameReplay: could not open " << path << std::endl;
+        return false;
+    }
+
+    char magic[4];
+    u32 version = 0;
+    if (!file.read(magic, 4) || std::string(magic, 4) != "ECAP" || !ReadCapture(file, version))
+    {
+        std::cout << "FrameReplay: " << path << " is not a frame capture" << std::endl;
+        return false;
+    }
+    if (version != FRAME_CAPTURE_VERSION)
+    {
+        std::cout << "FrameReplay: " << path << " is version " << version << ", expected " << FRAME_CAPTURE_VERSION << std::endl;
+        return false;
+    }
+
+    m_Frames.clear();
+    m_MeshPaths.clear();
+
+    char tag;
+    while (file.get(tag))
+    {
+        if (tag == 'M')
+        {
+            u32 id, length;
+            if (!ReadCapture(file, id) || !ReadCapture(file, length)) break;
+            std::string meshPath(length, '\0');
+            if (!file.read(meshPath.data(), length)) break;
+
+            if (id >= m_MeshPaths.size()) m_MeshPaths.resize(id + 1);
+            m_MeshPaths[id] = meshPath;
+        }
+        else if (tag == 'F')
+        {
+            CapturedFrame frame;
+            if (!ReadCapturedFrame(file, frame)) break;
+            m_Frames.push_back(std::move(frame));
+        }
+        else
+        {
+            std::cout << "FrameReplay: unknown record '" << tag << "' in " << path << std::endl;
+            return false;
+        }
+    }
+
+    // a capture cut short (crash mid write) still replays up to its last complete frame
+    if (!file.eof()) std::cout << "FrameReplay: " << path << " is truncated after " << m_Frames.size() << " frames" << std::endl;
+
+    if (m_Frames.empty())
+    {
+        std::cout << "FrameReplay: " << path << " has no frames" << std::endl;
+        return false;
+    }
+
+    m_Meshes.clear();
+    for (const std::string& meshPath : m_MeshPaths)
+    {
+        LoadResult mesh = OBJLoader::Load(meshPath);
+        if (mesh.mesh->Vertices.empty())
+        {
+            std::cout << "FrameReplay: mesh " << meshPath << " failed to load" << std::endl;
+            return false;
+        }
+        m_Meshes.push_back(std::move(mesh));
+    }
+
+    for (const CapturedFrame& frame : m_Frames)
+    {
+        for (const CapturedEntity& entity : frame.Entities)
+        {
+            if (entity.Mesh >= m_Meshes.size())
+            {
+                std::cout << "FrameReplay: " << path << " refers to mesh " << entity.Mesh << " that was never recorded" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    m_Scene.activeCamera = &m_Camera;
+    return true;
+}
+
+const RenderSettings& FrameReplay::Apply(size_t index)
+{
+    const CapturedFrame& frame = m_Frames[index];
+
+    const CapturedCamera& camera = frame.Camera;
+    m_Camera.SetPosition(camera.Position);
+    m_Camera.SetYaw(camera.Yaw);
+    m_Camera.SetPitch(camera.Pitch);
+    m_Camera.SetFOV(camera.FOV);
+    m_Camera.SetNear(camera.Near);
+    m_Camera.SetFar(camera.Far);
+    m_Camera.SetProjectionMatrix(camera.Aspect, camera.Near, camera.Far);
+
+    m_Scene.m_Sun.Direction = frame.SunDirection;
+    m_Scene.m_Sun.Color = frame.SunColor;
+    m_Scene.m_Sun.Intensity = frame.SunIntensity;
+
+    // a slot keeps its object as long as the light type stays the same
+    m_Lights.resize(std::max(m_Lights.size(), frame.Lights.size()));
+    m_Scene.m_Lights.clear();
+    for (size_t i = 0; i < frame.Lights.size(); ++i)
+    {
+        const CapturedLight& captured = frame.Lights[i];
+        auto type = (Light::LightType)captured.Type;
+
+        std::unique_ptr<Light>& light = m_Lights[i];
+        if (!light || light->GetType() != type)
+        {
+            if (type == Light::LightType::Directional) light = std::make_unique<DirectionalLight>();
+            else if (type == Light::LightType::Point) light = std::make_unique<PointLight>();
+            else light = std::make_unique<SpotLight>();
+        }
+
+        light->Color = captured.Color;
+        light->Intensity = captured.Intensity;
+        light->CastShadows = captured.CastShadows;
+
+        if (auto* d = dynamic_cast<DirectionalLight*>(light.get()))
+        {
+            d->Direction = captured.Direction;
+        }
+        else if (auto* p = dynamic_cast<PointLight*>(light.get()))
+        {
+            p->Position = captured.Position;
+            p->Constant = captured.Constant;
+            p->Linear = captured.Linear;
+            p->Quadratic = captured.Quadratic;
+        }
+        else if (auto* s = dynamic_cast<SpotLight*>(light.get()))
+        {
+            s->Position = captured.Position;
+            s->Direction = captured.Direction;
+            s->Constant = captured.Constant;
+            s->InnerCutoff = captured.InnerCutoff;
+            s->OuterCutoff = captured.OuterCutoff;
+        }
+
+        m_Scene.m_Lights.push_back(light.get());
+    }
+
+    m_Entities.resize(std::max(m_Entities.size(), frame.Entities.size()));
+    m_Scene.m_Entities.clear();
+    for (size_t i = 0; i < frame.Entities.size(); ++i)
+    {
+        const CapturedEntity& captured = frame.Entities[i];
+        const LoadResult& mesh = m_Meshes[captured.Mesh];
+
+        std::unique_ptr<Entity>& entity = m_Entities[i];
+        if (!entity) entity = std::make_unique<Entity>();
+        if (entity->meshAsset != mesh.mesh)
+        {
+            entity->meshAsset = mesh.mesh;
+            entity->materials = mesh.materials;
+        }
+
+        entity->transform = captured.Transform;
+        entity->transformVersion = captured.TransformVersion;
+        entity->isStatic = captured.IsStatic;
+
+        m_Scene.m_Entities.push_back(entity.get());
+    }
+
+    return frame.Settings;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Types.h"
+#include "Core/Scene.h"
+
+// a .ecap file holds everything Renderer::DrawScene reads for a run of frames, so the same
+// workload can be fed to the renderer again without the application around it (EchoReplay).
+// little endian PODs, a stream of tagged records:
+//   header  "ECAP" u32 version
+//   'M'     u32 id, u32 length, path          mesh (obj) first referenced by the next frame
+//   'F'     frame, see CapturedFrame and WriteFrame()
+// entities are captured rather than draw commands, SubmitDrawCmd builds those from the entity and
+// camera the same way on replay and the draw count of each frame is stored to check that.
+// entities without an obj path are skipped
+
+constexpr uint32_t FRAME_CAPTURE_VERSION = 1;
+
+struct CapturedCamera
+{
+    glm::vec3 Position;
+    float Yaw, Pitch;
+    float FOV, Near, Far;
+    float Aspect;
+};
+
+struct CapturedLight
+{
+    u8 Type;            // Light::LightType
+    u8 CastShadows;
+    glm::vec3 Color;
+    float Intensity;
+    glm::vec3 Position;
+    glm::vec3 Direction;
+    float Constant, Linear, Quadratic;
+    float InnerCutoff, OuterCutoff;
+};
+
+struct CapturedEntity
+{
+    u32 Mesh;           // id from the 'M' records
+    u8 IsStatic;
+    u32 TransformVersion;
+    glm::mat4 Transform;
+};
+
+// what the debug UI can change, stored per frame so toggling a mode mid capture replays too
+struct RenderSettings
+{
+    float Exposure = 1.0f;
+    std::array<float, 4> CascadeSplits = { 50.0f, 200.0f, 1000.0f, 2500.0f };
+    u8 GBufferLayout = 0;
+    u8 SSAOMode = 0;
+    int SSAOSamples = 16;
+    u8 VolumetricMode = 0;
+    u8 FroxelLocalLights = 1;
+    float FogDensity = 0.0f;
+    u8 ShadowCaching = 1;
+    int ShadowTileBudget = 8;
+};
+
+struct CapturedFrame
+{
+    CapturedCamera Camera;
+    glm::vec3 SunDirection;
+    glm::vec3 SunColor;
+    float SunIntensity;
+    RenderSettings Settings;
+    std::vector<CapturedLight> Lights;
+    std::vector<CapturedEntity> Entities;
+    u32 Width, Height;  // render resolution
+    u32 DrawCount;      // draw commands the renderer built from this frame
+};
+
+class FrameCaptureWriter
+{
+
+public:
+    bool Open(const std::string& path);
+    void WriteFrame(const SceneData& scene, const RenderSettings& settings, u32 width, u32 height, u32 drawCount);
+    void Close();
+
+    const std::string& GetPath() const { return m_Path; }
+    u32 GetFrameCount() const { return m_FrameCount; }
+
+private:
+    std::ofstream m_File;
+    std::string m_Path;
+    std::unordered_map<std::string, u32> m_MeshIds;   // by obj path, entities loading the same file share it
+    u32 m_FrameCount = 0;
+};
+
+// loads a capture and turns its frames back into a SceneData the renderer can draw.
+// meshes are loaded once, light and entity objects are reused between frames so per light
+// and per entity renderer state (shadow tiles, static caster cache) behaves like it did live
+class FrameReplay
+{
+
+public:
+    bool Load(const std::string& path);
+
+    // updates the scene to frame index, the returned settings go to Renderer::ApplySettings
+    const RenderSettings& Apply(size_t index);
+
+    SceneData& GetScene() { return m_Scene; }
+    size_t GetFrameCount() const { return m_Frames.size(); }
+    const CapturedFrame& GetFrame(size_t index) const { return m_Frames[index]; }
+
+private:
+    std::vector<CapturedFrame> m_Frames;
+    std::vector<std::string> m_MeshPaths;
+    std::vector<LoadResult> m_Meshes;
+
+    SceneData m_Scene;
+    Camera m_Camera;
+    std::vector<std::unique_ptr<Entity>> m_Entities;
+    std::vector<std::unique_ptr<Light>> m_Lights;
+};
@@ -0,0 +1,88 @@
+#include "GPUTimer.h"
+
+#include <algorithm>
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries((GLsizei)Queries.size(), Queries.data());
+    Color = ImColor::HSV(static_cast<float>(rand()) / static_cast<float>(RAND_MAX), 0.6f, 0.8f);
+}
+
+void GpuTimer::Collect()
+{
+    while (PendingCount > 0)
+    {
+        int slot = (Head - PendingCount + GPU_TIMER_QUERY_COUNT) % GPU_TIMER_QUERY_COUNT;
+
+        // the end timestamp is issued last, once it is there the begin one is too
+        GLint available = 0;
+        glGetQueryObjectiv(Queries[slot * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(Queries[slot * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(Queries[slot * 2 + 1], GL_QUERY_RESULT, &end);
+        PendingCount--;
+#ifdef ECHO_PROFILER
+        Profiler::AddGpuEvent(Name, (uint32_t)Depth, Frames[slot], begin, end);
+#endif
+
+        TimeMs = end > begin ? (end - begin) / 1000000.0f : 0.0f;
+        History[HistoryIndex] = TimeMs;
+        HistoryIndex = (HistoryIndex + 1) % GPU_TIMER_HISTORY;
+        HistoryCount = std::min(HistoryCount + 1, GPU_TIMER_HISTORY);
+        if (RenderProfiler::GetRecording()) Recorded.push_back({ Frames[slot], TimeMs });
+    }
+}
+
+bool GpuTimer::Begin()
+{
+    if (PendingCount == GPU_TIMER_QUERY_COUNT)
+    {
+        Dropped++;
+        return false;
+    }
+
+    glQueryCounter(Queries[Head * 2], GL_TIMESTAMP);
+    Frames[Head] = Profiler::GetFrameIndex();
+    return true;
+}
+
+void GpuTimer::End()
+{
+    glQueryCounter(Queries[Head * 2 + 1], GL_TIMESTAMP);
+    Head = (Head + 1) % GPU_TIMER_QUERY_COUNT;
+    PendingCount++;
+}
+
+void RenderProfiler::EndFrame()
+{
+#ifdef ECHO_PROFILER
+    static uint32_t frame = 0;
+    if (frame++ % 60 != 0) return;
+
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    Profiler::CalibrateGpuClock((uint64_t)gpuNow);
+#endif
+}
+
+GpuTimerStats GpuTimer::GetStats() const
+{
+    GpuTimerStats stats;
+    stats.SampleCount = HistoryCount;
+    if (HistoryCount == 0) return stats;
+
+    std::array<float, GPU_TIMER_HISTORY> sorted;
+    std::copy_n(History.begin(), HistoryCount, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + HistoryCount);
+
+    float sum = 0.0f;
+    for (int i = 0; i < HistoryCount; ++i) sum += sorted[i];
+
+    stats.MinMs = sorted[0];
+    stats.MaxMs = sorted[HistoryCount - 1];
+    stats.AvgMs = sum / HistoryCount;
+    stats.P95Ms = sorted[std::min(HistoryCount - 1, (int)(HistoryCount * 0.95f))];
+    return stats;
+}
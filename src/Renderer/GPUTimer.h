@@ -1,24 +1,66 @@
+#pragma once
+
 #include <glad/glad.h>
 #include <string>
 #include <map>
 #include <vector>
+#include <array>
+#include <algorithm>
+#include <cstdint>
 #include <imgui.h>
 
+#include "Core/Profiler.h"
+
+// a result is read back only once the GPU reports it available, so a timer may lag this many
+// uses behind. if the ring is still full the sample is dropped instead of waiting on the GPU
+constexpr int GPU_TIMER_QUERY_COUNT = 8;
+constexpr int GPU_TIMER_HISTORY = 240;
+
+struct GpuTimerStats
+{
+    float MinMs = 0.0f;
+    float AvgMs = 0.0f;
+    float P95Ms = 0.0f;
+    float MaxMs = 0.0f;
+    int SampleCount = 0;
+};
+
+struct GpuTimerSample
+{
+    uint64_t Frame;     // Profiler frame the scope ran in
+    float Ms;
+};
+
 struct GpuTimer
 {
-    GLuint Queries[2] = {0, 0};
-    int QueryIndex = 0;
-    float TimeMs = 0.0f;
+    // GL_TIMESTAMP pairs (begin, end), nested scopes can't use GL_TIME_ELAPSED
+    std::array<GLuint, GPU_TIMER_QUERY_COUNT * 2> Queries = {};
+    std::array<uint64_t, GPU_TIMER_QUERY_COUNT> Frames = {};    // Profiler frame each slot was issued in
+    int Head = 0;           // next slot to issue
+    int PendingCount = 0;   // issued but not read back, oldest at Head - PendingCount
+    uint32_t Dropped = 0;
+
+    float TimeMs = 0.0f;    // latest resolved sample
+    std::array<float, GPU_TIMER_HISTORY> History = {};
+    int HistoryIndex = 0;
+    int HistoryCount = 0;
+    std::vector<GpuTimerSample> Recorded;  // every resolved sample while RenderProfiler recording is on
+
+    int Depth = 0;          // nesting depth the scope was last opened at
+    const char* Name = nullptr;
     ImColor Color;
 
-    GpuTimer()
-    {
-        glGenQueries(2, Queries);
-        Color = ImColor::HSV(static_cast<float>(rand()) / static_cast<float>(RAND_MAX), 0.6f, 0.8f);
-    }
+    GpuTimer();
+
+    // reads back whatever finished without stalling
+    void Collect();
+    bool Begin();
+    void End();
+
+    GpuTimerStats GetStats() const;
 };
 
-class RenderProfiler 
+class RenderProfiler
 {
 
 public:
@@ -34,37 +76,57 @@ public:
         return order;
     }
 
+    static int& GetScopeDepth()
+    {
+        static int depth = 0;
+        return depth;
+    }
+
+    // keep every sample in GpuTimer::Recorded instead of only the rolling history, for benchmarks
+    static bool& GetRecording()
+    {
+        static bool recording = false;
+        return recording;
+    }
+
+    // lines the GPU clock up with the CPU profiler now and then
+    static void EndFrame();
+
 };
 
-struct ProfileScope 
+struct ProfileScope
 {
-    std::string name;
-    ProfileScope(const std::string& n) : name(n)
+    GpuTimer* timer = nullptr;
+    bool active = false;
+
+    ProfileScope(const std::string& name)
     {
-        auto& timer = RenderProfiler::GetTimerMap()[name];
-        
+        auto it = RenderProfiler::GetTimerMap().try_emplace(name).first;
+        timer = &it->second;
+        timer->Name = it->first.c_str();
+#ifdef ECHO_PROFILER
+        Profiler::BeginScope(timer->Name);
+#endif
+
         auto& order = RenderProfiler::GetFrameOrder();
         if (std::find(order.begin(), order.end(), name) == order.end())
         {
             order.push_back(name);
         }
 
-        glBeginQuery(GL_TIME_ELAPSED, timer.Queries[timer.QueryIndex]);
+        timer->Depth = RenderProfiler::GetScopeDepth()++;
+        timer->Collect();
+        active = timer->Begin();
     }
 
     ~ProfileScope()
     {
-        auto& timer = RenderProfiler::GetTimerMap()[name];
-        glEndQuery(GL_TIME_ELAPSED);
-
-        // fetch previous buffer
-        int prevIndex = 1 - timer.QueryIndex;
-        GLuint64 timeNs;
-        glGetQueryObjectui64v(timer.Queries[prevIndex], GL_QUERY_RESULT, &timeNs);
-        timer.TimeMs = timeNs / 1000000.0f;
-        
-        timer.QueryIndex = prevIndex;
+        if (active) timer->End();
+        RenderProfiler::GetScopeDepth()--;
+#ifdef ECHO_PROFILER
+        Profiler::EndScope();
+#endif
     }
 };
 
-#define PROFILE_GPU(name) ProfileScope gpu_scope_##__LINE__(name)
\ No newline at end of file
+#define PROFILE_GPU(name) ProfileScope gpu_scope_##__LINE__(name)
@@ -0,0 +1,156 @@
+#include "ImageDiff.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+// 8x8 windows every 4 pixels over the luma, the usual constants for 8 bit data
+static double ComputeImageSSIM(const std::vector<uint8_t>& reference, const std::vector<uint8_t>& image, uint width, uint height)
+{
+    const int window = 8;
+    const int step = 4;
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    auto luma = [](const std::vector<uint8_t>& rgba, size_t i) {
+        return 0.299 * rgba[i * 4] + 0.587 * rgba[i * 4 + 1] + 0.114 * rgba[i * 4 + 2];
+    };
+
+    // smaller than one window, compare the whole image as one
+    const int windowX = std::min(window, (int)width);
+    const int windowY = std::min(window, (int)height);
+    const double count = windowX * windowY;
+
+    double sum = 0.0;
+    int windows = 0;
+    for (int y = 0; y + windowY <= (int)height; y += step)
+    {
+        for (int x = 0; x + windowX <= (int)width; x += step)
+        {
+            double meanA = 0.0, meanB = 0.0, sqA = 0.0, sqB = 0.0, cross = 0.0;
+            for (int wy = 0; wy < windowY; ++wy)
+            {
+                for (int wx = 0; wx < windowX; ++wx)
+                {
+                    size_t i = (size_t)(y + wy) * width + (x + wx);
+                    double a = luma(reference, i);
+                    double b = luma(image, i);
+                    meanA += a;
+                    meanB += b;
+                    sqA += a * a;
+                    sqB += b * b;
+                    cross += a * b;
+                }
+            }
+
+            meanA /= count;
+            meanB /= count;
+            double varA = sqA / count - meanA * meanA;
+            double varB = sqB / count - meanB * meanB;
+            double covariance = cross / count - meanA * meanB;
+
+            sum += ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) /
+                   ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+            windows++;
+        }
+    }
+
+    return windows ? sum / windows : 1.0;
+}
+
+ImageDiffResult ImageDiff::Compare(const std::vector<uint8_t>& reference, const std::vector<uint8_t>& image, uint width, uint height, float heatmapScale)
+{
+    ImageDiffResult result;
+    const size_t pixels = (size_t)width * height;
+    if (pixels == 0 || reference.size() < pixels * 4 || image.size() < pixels * 4) return result;
+
+    result.Heatmap.resize(pixels * 4);
+
+    double squaredSum = 0.0;
+    double absoluteSum = 0.0;
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            int diff = std::abs((int)reference[i * 4 + c] - (int)image[i * 4 + c]);
+            squaredSum += (double)diff * diff;
+            absoluteSum += diff;
+            result.MaxError = std::max(result.MaxError, (uint)diff);
+            result.Heatmap[i * 4 + c] = (uint8_t)std::min(diff * heatmapScale, 255.0f);
+        }
+        result.Heatmap[i * 4 + 3] = 255;
+    }
+
+    double mse = squaredSum / (pixels * 3.0);
+    result.MeanError = absoluteSum / (pixels * 3.0);
+    result.PSNR = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+    result.SSIM = ComputeImageSSIM(reference, image, width, height);
+    return result;
+}
+
+bool ImageDiff::WritePPM(const std::string& path, const std::vector<uint8_t>& rgba, uint width, uint height)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        rgb[i * 3 + 0] = rgba[i * 4 + 0];
+        rgb[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    return file.good();
+}
+
+bool ImageDiff::ReadPPM(const std::string& path, std::vector<uint8_t>& rgba, uint& width, uint& height)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    // header tokens may be separated by any whitespace and '#' comments
+    auto token = [&file]() {
+        std::string value;
+        char c;
+        while (file.get(c))
+        {
+            if (c == '#')
+            {
+                std::string comment;
+                std::getline(file, comment);
+            }
+            else if (std::isspace((unsigned char)c))
+            {
+                if (!value.empty()) break;
+            }
+            else value += c;
+        }
+        return value;
+    };
+
+    if (token() != "P6") return false;
+    std::string w = token(), h = token(), maxValue = token();
+    if (w.empty() || h.empty() || maxValue != "255") return false;
+
+    width = (uint)std::strtoul(w.c_str(), nullptr, 10);
+    height = (uint)std::strtoul(h.c_str(), nullptr, 10);
+    if (width == 0 || height == 0) return false;
+
+    std::vector<uint8_t> rgb((size_t)width * height * 3);
+    if (!file.read(reinterpret_cast<char*>(rgb.data()), rgb.size())) return false;
+
+    rgba.resize((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+    return true;
+}
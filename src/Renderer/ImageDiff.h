@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Types.h"
+
+struct ImageDiffResult
+{
+    double PSNR = 0.0;              // dB over rgb, infinite for identical images
+    double MeanError = 0.0;         // 0..255
+    uint MaxError = 0;              // 0..255, largest channel difference
+    double SSIM = 0.0;              // mean structural similarity of the luma, 1 for identical images
+    std::vector<uint8_t> Heatmap;   // rgba8, absolute difference scaled up to be visible
+};
+
+// compares two tightly packed rgba8 images of the same size, alpha is ignored
+class ImageDiff
+{
+
+public:
+    static ImageDiffResult Compare(const std::vector<uint8_t>& reference, const std::vector<uint8_t>& image, uint width, uint height, float heatmapScale = 8.0f);
+
+    // binary PPM (P6), rgb only. no stb here: its vertical flip is global state the renderer sets
+    static bool WritePPM(const std::string& path, const std::vector<uint8_t>& rgba, uint width, uint height);
+    static bool ReadPPM(const std::string& path, std::vector<uint8_t>& rgba, uint& width, uint& height);
+
+};
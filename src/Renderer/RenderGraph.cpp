@@ -0,0 +1,450 @@
+#include "RenderGraph.h"
+#include "GPUTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "imgui.h"
+
+void RenderGraphBuilder::Read(RenderGraphResource resource)
+{
+    if (!resource.IsValid()) return;
+    m_Graph.m_Passes[m_Pass].Reads.push_back(resource.Index);
+    m_Graph.m_Resources[resource.Index].Readers.push_back(m_Pass);
+}
+
+void RenderGraphBuilder::Write(RenderGraphResource resource)
+{
+    if (!resource.IsValid()) return;
+    m_Graph.m_Passes[m_Pass].Writes.push_back(resource.Index);
+    m_Graph.m_Resources[resource.Index].Writers.push_back(m_Pass);
+}
+
+void RenderGraphBuilder::WriteColor(RenderGraphResource resource, uint slot)
+{
+    if (!resource.IsValid()) return;
+    Write(resource);
+    m_Graph.m_Passes[m_Pass].ColorAttachments.push_back({ (uint)resource.Index, slot });
+}
+
+void RenderGraphBuilder::WriteDepth(RenderGraphResource resource)
+{
+    if (!resource.IsValid()) return;
+    Write(resource);
+    m_Graph.m_Passes[m_Pass].DepthAttachment = resource.Index;
+}
+
+void RenderGraphBuilder::SetSideEffect()
+{
+    m_Graph.m_Passes[m_Pass].SideEffect = true;
+}
+
+RenderGraph::~RenderGraph()
+{
+    DestroyGPUResources();
+}
+
+void RenderGraph::Reset()
+{
+    DestroyGPUResources();
+    m_Resources.clear();
+    m_Passes.clear();
+    m_Order.clear();
+    m_Physical.clear();
+    m_Stats = {};
+    m_Compiled = false;
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc)
+{
+    Resource& resource = m_Resources.emplace_back();
+    resource.Name = name;
+    resource.Desc = desc;
+    return { (int)m_Resources.size() - 1 };
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const std::string& name, uint texture)
+{
+    Resource& resource = m_Resources.emplace_back();
+    resource.Name = name;
+    resource.Imported = true;
+    resource.Texture = texture;
+    return { (int)m_Resources.size() - 1 };
+}
+
+void RenderGraph::MarkOutput(RenderGraphResource resource)
+{
+    if (resource.IsValid()) m_Resources[resource.Index].Output = true;
+}
+
+void RenderGraph::AddPass(const std::string& name, const std::function<void(RenderGraphBuilder&)>& setup, std::function<void()> execute)
+{
+    Pass& pass = m_Passes.emplace_back();
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+
+    RenderGraphBuilder builder(*this, (uint)m_Passes.size() - 1);
+    setup(builder);
+}
+
+void RenderGraph::Compile(uint width, uint height)
+{
+    DestroyGPUResources();
+    m_Width = width;
+    m_Height = height;
+
+    SortPasses();
+    CullPasses();
+    AssignPhysicalTextures();
+    CreateTextures();
+    CreateFramebuffers();
+
+    m_Compiled = true;
+}
+
+void RenderGraph::Resize(uint width, uint height)
+{
+    if (!m_Compiled || (width == m_Width && height == m_Height)) return;
+
+    DestroyGPUResources();
+    m_Width = width;
+    m_Height = height;
+
+    CreateTextures();
+    CreateFramebuffers();
+}
+
+void RenderGraph::Execute()
+{
+    for (uint index : m_Order)
+    {
+        Pass& pass = m_Passes[index];
+        if (pass.Culled) continue;
+
+        ProfileScope p(pass.Name);
+
+        if (pass.FBO)
+        {
+            // every attachment of a pass has the same size, the first one sets the viewport
+            int attachment = pass.ColorAttachments.empty() ? pass.DepthAttachment : (int)pass.ColorAttachments[0].first;
+            const PhysicalTexture& target = m_Physical[m_Resources[attachment].Physical];
+
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.FBO);
+            glViewport(0, 0, target.Width, target.Height);
+        }
+
+        pass.Execute();
+    }
+}
+
+uint RenderGraph::GetTexture(RenderGraphResource resource) const
+{
+    if (!resource.IsValid()) return 0;
+
+    const Resource& r = m_Resources[resource.Index];
+    if (r.Imported) return r.Texture;
+    if (r.Physical < 0) return 0;
+    return m_Physical[r.Physical].Texture;
+}
+
+// kahn's algorithm, readers after every writer and writers of one resource in declaration order.
+// ties go to the pass declared first so a graph declared in a valid order runs as declared
+void RenderGraph::SortPasses()
+{
+    const uint count = (uint)m_Passes.size();
+    std::vector<std::vector<uint>> edges(count);
+    std::vector<uint> inDegree(count, 0);
+
+    auto addEdge = [&](uint from, uint to) {
+        if (from == to) return;
+        if (std::find(edges[from].begin(), edges[from].end(), to) != edges[from].end()) return;
+        edges[from].push_back(to);
+        inDegree[to]++;
+    };
+
+    for (const Resource& resource : m_Resources)
+    {
+        for (size_t i = 1; i < resource.Writers.size(); ++i) addEdge(resource.Writers[i - 1], resource.Writers[i]);
+        for (uint writer : resource.Writers)
+            for (uint reader : resource.Readers)
+                addEdge(writer, reader);
+    }
+
+    m_Order.clear();
+    std::vector<bool> done(count, false);
+    while (m_Order.size() < count)
+    {
+        uint next = count;
+        for (uint i = 0; i < count; ++i)
+        {
+            if (!done[i] && inDegree[i] == 0) { next = i; break; }
+        }
+
+        if (next == count)
+        {
+            std::cerr << "RenderGraph: dependency cycle, falling back to declaration order" << std::endl;
+            m_Order.clear();
+            for (uint i = 0; i < count; ++i) m_Order.push_back(i);
+            return;
+        }
+
+        done[next] = true;
+        m_Order.push_back(next);
+        for (uint to : edges[next]) inDegree[to]--;
+    }
+}
+
+// a pass survives if it has side effects, writes an output, or writes something a surviving pass reads
+void RenderGraph::CullPasses()
+{
+    std::vector<uint> stack;
+    for (uint i = 0; i < m_Passes.size(); ++i)
+    {
+        Pass& pass = m_Passes[i];
+        pass.Culled = true;
+
+        bool root = pass.SideEffect;
+        for (uint w : pass.Writes) root |= m_Resources[w].Output;
+        if (root)
+        {
+            pass.Culled = false;
+            stack.push_back(i);
+        }
+    }
+
+    while (!stack.empty())
+    {
+        uint index = stack.back();
+        stack.pop_back();
+
+        for (uint r : m_Passes[index].Reads)
+        {
+            for (uint writer : m_Resources[r].Writers)
+            {
+                if (!m_Passes[writer].Culled) continue;
+                m_Passes[writer].Culled = false;
+                stack.push_back(writer);
+            }
+        }
+    }
+}
+
+void RenderGraph::AssignPhysicalTextures()
+{
+    m_Physical.clear();
+    for (Resource& resource : m_Resources)
+    {
+        resource.FirstPass = -1;
+        resource.LastPass = -1;
+        resource.Physical = -1;
+    }
+
+    // lifetimes in terms of position in the execution order, culled passes don't count
+    int position = 0;
+    for (uint index : m_Order)
+    {
+        const Pass& pass = m_Passes[index];
+        if (pass.Culled) continue;
+
+        auto touch = [&](uint r) {
+            Resource& resource = m_Resources[r];
+            if (resource.FirstPass < 0) resource.FirstPass = position;
+            resource.LastPass = position;
+        };
+        for (uint r : pass.Reads) touch(r);
+        for (uint r : pass.Writes) touch(r);
+        position++;
+    }
+
+    // walk the passes, hand each transient the first free physical texture with the same desc
+    for (int p = 0; p < position; ++p)
+    {
+        for (size_t r = 0; r < m_Resources.size(); ++r)
+        {
+            Resource& resource = m_Resources[r];
+            if (resource.Imported || resource.FirstPass != p) continue;
+
+            int physical = -1;
+            for (size_t i = 0; i < m_Physical.size(); ++i)
+            {
+                if (m_Physical[i].FreeAfter < p && m_Physical[i].Desc == resource.Desc)
+                {
+                    physical = (int)i;
+                    break;
+                }
+            }
+
+            if (physical < 0)
+            {
+                PhysicalTexture& texture = m_Physical.emplace_back();
+                texture.Desc = resource.Desc;
+                physical = (int)m_Physical.size() - 1;
+            }
+
+            m_Physical[physical].FreeAfter = resource.LastPass;
+            resource.Physical = physical;
+        }
+    }
+}
+
+void RenderGraph::CreateTextures()
+{
+    m_Stats = {};
+
+    for (PhysicalTexture& texture : m_Physical)
+    {
+        const RenderGraphTextureDesc& desc = texture.Desc;
+        texture.Width = std::max((uint)std::ceil(m_Width * desc.Scale), 1u);
+        texture.Height = std::max((uint)std::ceil(m_Height * desc.Scale), 1u);
+
+        glGenTextures(1, &texture.Texture);
+        glBindTexture(GL_TEXTURE_2D, texture.Texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, desc.Format, texture.Width, texture.Height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.Filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.Filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, desc.Wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, desc.Wrap);
+        if (desc.Wrap == GL_CLAMP_TO_BORDER)
+        {
+            float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+        }
+
+        m_Stats.AllocatedBytes += (size_t)texture.Width * texture.Height * GetBytesPerPixel(desc.Format);
+        m_Stats.PhysicalTextureCount++;
+    }
+
+    // what keeping every declared target resident would cost, like the hand allocated targets did
+    for (const Resource& resource : m_Resources)
+    {
+        if (resource.Imported) continue;
+        size_t width = std::max((uint)std::ceil(m_Width * resource.Desc.Scale), 1u);
+        size_t height = std::max((uint)std::ceil(m_Height * resource.Desc.Scale), 1u);
+        m_Stats.TransientBytes += width * height * GetBytesPerPixel(resource.Desc.Format);
+        m_Stats.TextureCount++;
+    }
+
+    for (const Pass& pass : m_Passes)
+    {
+        m_Stats.PassCount++;
+        if (pass.Culled) m_Stats.CulledPassCount++;
+    }
+}
+
+void RenderGraph::CreateFramebuffers()
+{
+    for (Pass& pass : m_Passes)
+    {
+        if (pass.Culled || (pass.ColorAttachments.empty() && pass.DepthAttachment < 0)) continue;
+
+        glGenFramebuffers(1, &pass.FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, pass.FBO);
+
+        uint drawBuffers[8] = { GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE };
+        uint drawBufferCount = 0;
+        for (const auto& [resource, slot] : pass.ColorAttachments)
+        {
+            if (slot >= 8) continue;
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + slot, GL_TEXTURE_2D, GetTexture({ (int)resource }), 0);
+            drawBuffers[slot] = GL_COLOR_ATTACHMENT0 + slot;
+            drawBufferCount = std::max(drawBufferCount, slot + 1);
+        }
+        glDrawBuffers(drawBufferCount, drawBuffers);
+
+        if (pass.DepthAttachment >= 0)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, GetTexture({ pass.DepthAttachment }), 0);
+        }
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "RenderGraph: framebuffer of pass " << pass.Name << " not complete!" << std::endl;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::DestroyGPUResources()
+{
+    for (Pass& pass : m_Passes)
+    {
+        if (pass.FBO) glDeleteFramebuffers(1, &pass.FBO);
+        pass.FBO = 0;
+    }
+
+    for (PhysicalTexture& texture : m_Physical)
+    {
+        if (texture.Texture) glDeleteTextures(1, &texture.Texture);
+        texture.Texture = 0;
+    }
+}
+
+size_t RenderGraph::GetBytesPerPixel(GLenum format)
+{
+    switch (format)
+    {
+        case GL_R8:                 return 1;
+        case GL_R16F:
+        case GL_RG8:                return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_RGBA16:             return 8;
+        case GL_RGBA32F:            return 16;
+        case GL_DEPTH32F_STENCIL8:  return 8;
+        // rgba8, rg16, r32f, r11g11b10f, rgb10a2, depth24 (padded)...
+        default:                    return 4;
+    }
+}
+
+void RenderGraph::OnImGuiRender()
+{
+    ImGui::Text("%u passes, %u culled", m_Stats.PassCount, m_Stats.CulledPassCount);
+    ImGui::Text("%u transient textures in %u allocations", m_Stats.TextureCount, m_Stats.PhysicalTextureCount);
+    ImGui::Text("VRAM %.1f MB declared, %.1f MB allocated after culling and aliasing",
+        m_Stats.TransientBytes / (1024.0 * 1024.0), m_Stats.AllocatedBytes / (1024.0 * 1024.0));
+
+    if (ImGui::TreeNode("Passes"))
+    {
+        int position = 0;
+        for (uint index : m_Order)
+        {
+            const Pass& pass = m_Passes[index];
+            if (pass.Culled) ImGui::TextDisabled("   %s (culled)", pass.Name.c_str());
+            else             ImGui::Text("%2d %s", position++, pass.Name.c_str());
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Resources"))
+    {
+        if (!ImGui::BeginTable("RenderGraphResources", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TreePop();
+            return;
+        }
+
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Lifetime");
+        ImGui::TableSetupColumn("Texture");
+        ImGui::TableHeadersRow();
+
+        for (const Resource& resource : m_Resources)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", resource.Name.c_str());
+            ImGui::TableNextColumn();
+            if (resource.FirstPass < 0) ImGui::TextDisabled("unused");
+            else ImGui::Text("%d - %d", resource.FirstPass, resource.LastPass);
+            ImGui::TableNextColumn();
+            if (resource.Imported) ImGui::TextDisabled("imported");
+            else if (resource.Physical >= 0) ImGui::Text("#%d (id %u)", resource.Physical, m_Physical[resource.Physical].Texture);
+            else ImGui::TextDisabled("-");
+        }
+
+        ImGui::EndTable();
+        ImGui::TreePop();
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../Types.h"
+
+struct RenderGraphResource
+{
+    int Index = -1;
+    bool IsValid() const { return Index >= 0; }
+};
+
+// transient 2d render target, sized relative to the backbuffer
+struct RenderGraphTextureDesc
+{
+    GLenum Format = GL_RGBA8;
+    float Scale = 1.0f;
+    GLenum Filter = GL_NEAREST;
+    GLenum Wrap = GL_CLAMP_TO_EDGE; // GL_CLAMP_TO_BORDER gets a white border, for depth
+
+    bool operator==(const RenderGraphTextureDesc& other) const
+    {
+        return Format == other.Format && Scale == other.Scale && Filter == other.Filter && Wrap == other.Wrap;
+    }
+};
+
+struct RenderGraphStats
+{
+    size_t TransientBytes = 0;  // every declared transient texture on its own
+    size_t AllocatedBytes = 0;  // after aliasing
+    uint TextureCount = 0;
+    uint PhysicalTextureCount = 0;
+    uint PassCount = 0;
+    uint CulledPassCount = 0;
+};
+
+class RenderGraph;
+
+// handed to the setup callback of AddPass, records what the pass touches
+class RenderGraphBuilder
+{
+
+public:
+    void Read(RenderGraphResource resource);
+    void Write(RenderGraphResource resource);
+
+    // writes through the pass framebuffer, bound by the graph before the pass runs
+    void WriteColor(RenderGraphResource resource, uint slot);
+    void WriteDepth(RenderGraphResource resource);
+
+    // never culled, for passes that only write persistent state
+    void SetSideEffect();
+
+private:
+    friend class RenderGraph;
+    RenderGraphBuilder(RenderGraph& graph, uint pass) : m_Graph(graph), m_Pass(pass) {}
+
+    RenderGraph& m_Graph;
+    uint m_Pass;
+};
+
+// declarative frame setup. passes declare their reads and writes, Compile() orders them,
+// culls passes nothing depends on and assigns transient textures to physical ones, reusing
+// a texture once the previous user's lifetime ended (same desc only, GL has no memory aliasing).
+// the graph owns transient textures and pass framebuffers and recreates them on Resize().
+// rebuild (Reset + declare + Compile) whenever the set of passes changes.
+class RenderGraph
+{
+
+public:
+    RenderGraph() = default;
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    void Reset();
+
+    RenderGraphResource CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc);
+    // persistent resource owned elsewhere, only used for ordering and culling
+    RenderGraphResource ImportTexture(const std::string& name, uint texture);
+    // imported resource that has to be produced every frame (backbuffer), its writers are never culled
+    void MarkOutput(RenderGraphResource resource);
+
+    void AddPass(const std::string& name, const std::function<void(RenderGraphBuilder&)>& setup, std::function<void()> execute);
+
+    void Compile(uint width, uint height);
+    void Resize(uint width, uint height);
+    void Execute();
+
+    uint GetTexture(RenderGraphResource resource) const;
+    const RenderGraphStats& GetStats() const { return m_Stats; }
+    bool IsCompiled() const { return m_Compiled; }
+
+    void OnImGuiRender();
+
+private:
+    friend class RenderGraphBuilder;
+
+    struct Resource
+    {
+        std::string Name;
+        RenderGraphTextureDesc Desc;
+        bool Imported = false;
+        bool Output = false;
+        uint Texture = 0;           // imported id, or the physical texture after Compile
+        int Physical = -1;
+        int FirstPass = -1, LastPass = -1;  // positions in m_Order
+        std::vector<uint> Writers;
+        std::vector<uint> Readers;
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        std::function<void()> Execute;
+        std::vector<uint> Reads;
+        std::vector<uint> Writes;
+        std::vector<std::pair<uint, uint>> ColorAttachments; // resource, slot
+        int DepthAttachment = -1;
+        bool SideEffect = false;
+        bool Culled = false;
+        uint FBO = 0;
+    };
+
+    struct PhysicalTexture
+    {
+        RenderGraphTextureDesc Desc;
+        uint Texture = 0;
+        uint Width = 0, Height = 0;
+        int FreeAfter = -1; // last pass position of the current user
+    };
+
+    std::vector<Resource> m_Resources;
+    std::vector<Pass> m_Passes;
+    std::vector<uint> m_Order;
+    std::vector<PhysicalTexture> m_Physical;
+
+    RenderGraphStats m_Stats;
+    bool m_Compiled = false;
+    uint m_Width = 0, m_Height = 0;
+
+    void SortPasses();
+    void CullPasses();
+    void AssignPhysicalTextures();
+    void CreateTextures();
+    void CreateFramebuffers();
+    void DestroyGPUResources();
+
+    static size_t GetBytesPerPixel(GLenum format);
+
+};
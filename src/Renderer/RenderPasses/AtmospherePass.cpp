@@ -2,32 +2,16 @@
 
 void Renderer::AtmospherePass()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFBO);
+    glViewport(0, 0, m_Width, m_Height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     m_AtmosphereShader->Bind();
 
-    glm::mat4 proj = m_Scene->activeCamera->GetProjectionMatrix();
-    glm::mat4 view = m_Scene->activeCamera->GetViewMatrix();
-    glm::mat4 invViewProj = glm::inverse(proj * view);
-    glm::vec3 skyLightColor = m_Scene->m_Sun.Color * m_Scene->m_Sun.Intensity;
-    glm::vec3 camPos = m_Scene->activeCamera->GetPosition();
-
-    m_AtmosphereShader->SetUniform1f("exposure", m_Exposure);
-    m_AtmosphereShader->SetUniform3f("viewPos", camPos.x, camPos.y, camPos.z);
-    m_AtmosphereShader->SetUniform3f("uLightDir", -m_Scene->m_Sun.Direction.x, -m_Scene->m_Sun.Direction.y, -m_Scene->m_Sun.Direction.z);
-    m_AtmosphereShader->SetUniformMat4f("uInvViewProj", invViewProj);
-    m_AtmosphereShader->SetUniform1i("uCascadeCount", m_ShadowCascadeLevels.size());
-    for (size_t i = 0; i < m_ShadowCascadeMatrices.size(); ++i)
-    {
-        std::string name = "uCascadeMatrices[" + std::to_string(i) + "]";
-        m_AtmosphereShader->SetUniformMat4f(name, m_ShadowCascadeMatrices[i]);
-    }
-
-    m_AtmosphereShader->SetUniform1i("uIsIBLPass", 0);
+    m_AtmosphereShader->Set(m_AtmosphereUniforms.VolumetricMode, (int)m_VolumetricMode);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Depth);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Depth));
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, m_TransmittanceLUT);
     glActiveTexture(GL_TEXTURE2);
@@ -35,11 +19,106 @@ void Renderer::AtmospherePass()
     glActiveTexture(GL_TEXTURE3);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_ShadowMapTexture);
     glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, m_LightingResult);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_LightingResult));
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, m_SkyViewLUT);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_3D, m_FroxelIntegratedScattering);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_3D, m_FroxelIntegratedTransmittance);
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_2D, m_VolumetricHistory[m_VolumetricHistoryIndex]);
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D, m_VolumetricHistoryTransmittance[m_VolumetricHistoryIndex]);
 
     glDisable(GL_BLEND); 
     glDisable(GL_DEPTH_TEST);
     glDepthMask(GL_FALSE);
 
     m_GBuffer.quad.Draw();
+
+    if (m_VolumetricCompareRequested) CompareVolumetricsWithReference();
+}
+
+static std::vector<uint8_t> ReadBackbuffer(uint width, uint height)
+{
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return pixels;
+}
+
+// the forward pass keeps drawing into whatever this leaves bound, so the output needs its own depth
+void Renderer::CreateOutputTarget()
+{
+    if (!m_OffscreenOutput) return;
+
+    if (m_OutputFBO)
+    {
+        glDeleteFramebuffers(1, &m_OutputFBO);
+        glDeleteTextures(1, &m_OutputColor);
+        glDeleteRenderbuffers(1, &m_OutputDepth);
+    }
+
+    glGenTextures(1, &m_OutputColor);
+    glBindTexture(GL_TEXTURE_2D, m_OutputColor);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_Width, m_Height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenRenderbuffers(1, &m_OutputDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_OutputDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+
+    glGenFramebuffers(1, &m_OutputFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_OutputColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_OutputDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen output framebuffer not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the graph imported the old texture
+    m_RenderGraphDirty = true;
+}
+
+std::vector<uint8_t> Renderer::ReadOutputPixels() const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_OutputFBO);
+    std::vector<uint8_t> pixels = ReadBackbuffer(m_Width, m_Height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return pixels;
+}
+
+// debug only: draws the per pixel raymarch on top of this frame, reads both back and draws the
+// selected mode again so the frame on screen is unchanged. expects the atmosphere state from above
+void Renderer::CompareVolumetricsWithReference()
+{
+    m_VolumetricCompareRequested = false;
+
+    std::vector<uint8_t> current = ReadBackbuffer(m_Width, m_Height);
+
+    m_AtmosphereShader->Set(m_AtmosphereUniforms.VolumetricMode, (int)VolumetricMode::FullResolution);
+    m_GBuffer.quad.Draw();
+    std::vector<uint8_t> reference = ReadBackbuffer(m_Width, m_Height);
+
+    m_AtmosphereShader->Set(m_AtmosphereUniforms.VolumetricMode, (int)m_VolumetricMode);
+    m_GBuffer.quad.Draw();
+
+    m_VolumetricDiff = ImageDiff::Compare(reference, current, m_Width, m_Height);
+
+    if (!m_VolumetricDiffTexture)
+    {
+        glGenTextures(1, &m_VolumetricDiffTexture);
+        glBindTexture(GL_TEXTURE_2D, m_VolumetricDiffTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_VolumetricDiffTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_VolumetricDiff.Heatmap.data());
+
+    std::cout << "Volumetrics vs full resolution: PSNR " << m_VolumetricDiff.PSNR << " dB, max error " << m_VolumetricDiff.MaxError << std::endl;
 }
\ No newline at end of file
@@ -7,8 +7,6 @@ void Renderer::ForwardPass()
     glDepthFunc(GL_LESS);
 
     m_ForwardShader->Bind();
-    m_ForwardShader->SetUniformMat4f("uView", m_Scene->activeCamera->GetViewMatrix());
-    m_ForwardShader->SetUniformMat4f("uProjection", m_Scene->activeCamera->GetProjectionMatrix());
 
     glEnable(GL_BLEND);
     glDisable(GL_CULL_FACE);
@@ -20,10 +18,10 @@ void Renderer::ForwardPass()
 
     for (const DrawCmd& cmd : m_ForwardQueue)
     {
-        m_ForwardShader->SetUniformMat4f("uModel", cmd.Model);
+        m_ForwardShader->Set(m_ForwardUniforms.Model, cmd.Model);
         
         float opacity = cmd.Material ? cmd.Material->Dissolve : 1.0f;
-        m_ForwardShader->SetUniform1f("uOpacity", opacity);
+        m_ForwardShader->Set(m_ForwardUniforms.Opacity, opacity);
 
         BindMaterial(cmd.Material);
         cmd.Mesh->Bind();
@@ -0,0 +1,35 @@
+#include "../Renderer.h"
+
+// builds the froxel volume the atmosphere pass reads for pixels that hit geometry. cost only
+// depends on FROXEL_X * FROXEL_Y * FROXEL_Z, the per pixel work is a single 3d lookup
+void Renderer::FroxelPass()
+{
+    const uint groupsX = (FROXEL_X + 7) / 8;
+    const uint groupsY = (FROXEL_Y + 7) / 8;
+
+    // medium + sun (shadowed by the cascades) + clustered lights at every froxel centre
+    Shader* inject = m_FroxelInjectShaders->Get({ { "LOCAL_LIGHTS", m_FroxelLocalLights ? "1" : "0" } });
+    inject->Bind();
+    inject->Set(m_FroxelFogDensity, m_FogDensity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_TransmittanceLUT);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_MultiScatteringLUT);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_ShadowMapTexture);
+    glBindImageTexture(0, m_FroxelScattering, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(1, m_FroxelExtinction, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+    glDispatchCompute(groupsX, groupsY, FROXEL_Z);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // front to back along each column
+    m_FroxelIntegrateShader->Bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, m_FroxelScattering);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_FroxelExtinction);
+    glBindImageTexture(0, m_FroxelIntegratedScattering, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(1, m_FroxelIntegratedTransmittance, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+    glDispatchCompute(groupsX, groupsY, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
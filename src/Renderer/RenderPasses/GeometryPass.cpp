@@ -1,23 +1,45 @@
 #include "../Renderer.h"
 
+void Renderer::SetGBufferLayout(GBufferLayout layout)
+{
+    m_GBufferLayout = layout;
+    m_RenderGraphDirty = true;
+
+    int packed = layout == GBufferLayout::Slim ? 1 : 0;
+    m_GBufferShader->Set(m_GBufferPacked, packed);
+    m_LightingShader->Set(m_LightingPacked, packed);
+    m_SSAOShader->Set(m_SSAOPacked, packed);
+    m_SSAOComputeShader->Set(m_SSAOComputePacked, packed);
+}
+
+// gbuffer + depth + lighting target
+uint Renderer::GetGBufferBytesPerPixel() const
+{
+    // depth24 is stored padded to 32 bits
+    if (m_GBufferLayout == GBufferLayout::Slim) return 4 + 4 + 4 + 4 + 4;
+    return 8 + 8 + 4 + 4 + 4 + 8;
+}
+
 void Renderer::GeometryPass()
 {
     glDisable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
+    glDepthMask(GL_TRUE);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     m_GBufferShader->Bind();
-    m_GBufferShader->SetUniformMat4f("uView", m_Scene->activeCamera->GetViewMatrix());
-    m_GBufferShader->SetUniformMat4f("uProjection", m_Scene->activeCamera->GetProjectionMatrix());
 
     for (const DrawCmd& cmd : m_DeferredQueue)
     {
-        m_GBufferShader->SetUniformMat4f("uModel", cmd.Model);
+        m_GBufferShader->Set(m_GBufferUniforms.Model, cmd.Model);
         BindMaterial(cmd.Material);
         cmd.Mesh->Bind();
         cmd.Mesh->DrawSubMesh(cmd.SubMeshIndex);
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
\ No newline at end of file
+}
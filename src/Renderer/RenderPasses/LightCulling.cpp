@@ -0,0 +1,224 @@
+#include "../Renderer.h"
+
+#include <chrono>
+
+// distance at which a light falls below LIGHT_CUTOFF, lighting.frag windows the
+// attenuation to zero at this radius so the cutoff does not show up as a hard edge
+static constexpr float LIGHT_CUTOFF = 0.01f;
+
+static float GetLightRadius(const glm::vec3& color, float intensity, float constant, float linear, float quadratic)
+{
+    float brightness = std::max(std::max(color.r, color.g), color.b) * intensity;
+    float c = constant - brightness / LIGHT_CUTOFF;
+
+    if (quadratic <= 0.0f)
+    {
+        if (linear <= 0.0f) return 0.0f;
+        return std::max(-c / linear, 0.0f);
+    }
+
+    float discriminant = linear * linear - 4.0f * quadratic * c;
+    if (discriminant <= 0.0f) return 0.0f;
+    return (-linear + std::sqrt(discriminant)) / (2.0f * quadratic);
+}
+
+struct ClusterRange
+{
+    uint16_t MinX, MaxX, MinY, MaxY, MinZ, MaxZ;
+};
+
+// conservative cluster bounds of a view space sphere, false if it is outside the frustum
+static bool GetClusterRange(const glm::vec3& center, float radius, const glm::mat4& proj, float nearPlane, float farPlane, ClusterRange& range)
+{
+    float minDepth = -center.z - radius;
+    float maxDepth = -center.z + radius;
+    if (maxDepth < nearPlane || minDepth > farPlane) return false;
+
+    float logScale = CLUSTER_Z / std::log(farPlane / nearPlane);
+    auto slice = [&](float depth) {
+        depth = glm::clamp(depth, nearPlane, farPlane);
+        return glm::clamp((int)(std::log(depth / nearPlane) * logScale), 0, CLUSTER_Z - 1);
+    };
+
+    range.MinZ = (uint16_t)slice(minDepth);
+    range.MaxZ = (uint16_t)slice(maxDepth);
+
+    // sphere crosses the near plane, projecting it would flip, just take the whole screen
+    if (minDepth <= nearPlane)
+    {
+        range.MinX = 0; range.MaxX = CLUSTER_X - 1;
+        range.MinY = 0; range.MaxY = CLUSTER_Y - 1;
+        return true;
+    }
+
+    glm::vec2 ndcMin( 1.0f);
+    glm::vec2 ndcMax(-1.0f);
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner = center + glm::vec3(
+            (i & 1) ? radius : -radius,
+            (i & 2) ? radius : -radius,
+            (i & 4) ? radius : -radius
+        );
+
+        glm::vec4 clip = proj * glm::vec4(corner, 1.0f);
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) return false;
+
+    auto tile = [](float ndc, int count) {
+        return glm::clamp((int)((ndc * 0.5f + 0.5f) * count), 0, count - 1);
+    };
+
+    range.MinX = (uint16_t)tile(ndcMin.x, CLUSTER_X);
+    range.MaxX = (uint16_t)tile(ndcMax.x, CLUSTER_X);
+    range.MinY = (uint16_t)tile(ndcMin.y, CLUSTER_Y);
+    range.MaxY = (uint16_t)tile(ndcMax.y, CLUSTER_Y);
+    return true;
+}
+
+template<typename F>
+static void ForEachCluster(const ClusterRange& range, F&& func)
+{
+    for (int z = range.MinZ; z <= range.MaxZ; ++z)
+        for (int y = range.MinY; y <= range.MaxY; ++y)
+            for (int x = range.MinX; x <= range.MaxX; ++x)
+                func(x + y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y);
+}
+
+void Renderer::LightCullingPass()
+{
+    PROFILE_FUNCTION();
+    auto startTime = std::chrono::steady_clock::now();
+
+    const Camera* camera = m_Scene->activeCamera;
+    const glm::mat4 view = camera->GetViewMatrix();
+    const glm::mat4 proj = camera->GetProjectionMatrix();
+    const float nearPlane = camera->GetNear();
+    const float farPlane = camera->GetFar();
+
+    PointLightData* pointLights = static_cast<PointLightData*>(m_PointLightSSBO->Map());
+    SpotLightData* spotLights = static_cast<SpotLightData*>(m_SpotLightSSBO->Map());
+    ClusterData* clusters = static_cast<ClusterData*>(m_ClusterSSBO->Map());
+    uint* indices = static_cast<uint*>(m_LightIndexSSBO->Map());
+    LocalShadowData* shadows = static_cast<LocalShadowData*>(m_LocalShadowSSBO->Map());
+    if (!pointLights || !spotLights || !clusters || !indices || !shadows) return;
+
+    // light lists go straight into the mapped buffers, the cluster ranges live in the frame arena
+    FrameVector<ClusterRange> pointRanges(&m_FrameArena);
+    FrameVector<ClusterRange> spotRanges(&m_FrameArena);
+    pointRanges.reserve(std::min(m_Scene->m_Lights.size(), (size_t)MAX_CLUSTERED_POINT_LIGHTS));
+
+    FrameVector<uint> pointCounts(CLUSTER_COUNT, 0, &m_FrameArena);
+    FrameVector<uint> spotCounts(CLUSTER_COUNT, 0, &m_FrameArena);
+
+    uint pointLightCount = 0;
+    uint spotLightCount = 0;
+    uint shadowCount = 0;
+
+    for (const Light* light : m_Scene->m_Lights)
+    {
+        switch (light->GetType())
+        {
+            case Light::LightType::Directional: break;
+
+            case Light::LightType::Point:
+            {
+                if (pointLightCount >= MAX_CLUSTERED_POINT_LIGHTS) break;
+                const PointLight* pLight = static_cast<const PointLight*>(light);
+
+                float radius = GetLightRadius(pLight->Color, pLight->Intensity, pLight->Constant, pLight->Linear, pLight->Quadratic);
+                glm::vec3 viewPos = glm::vec3(view * glm::vec4(pLight->Position, 1.0f));
+
+                ClusterRange range;
+                if (radius <= 0.0f || !GetClusterRange(viewPos, radius, proj, nearPlane, farPlane, range)) break;
+
+                PointLightData& data = pointLights[pointLightCount++];
+                data.Position = glm::vec4(pLight->Position, radius);
+                data.Color = glm::vec4(pLight->Color, pLight->Intensity);
+                int shadow = pLight->CastShadows ? RequestLocalShadow(pLight, pLight->Position, glm::vec3(0.0f), radius, 90.0f, shadowCount) : -1;
+                data.Attenuation = glm::vec4(pLight->Constant, pLight->Linear, pLight->Quadratic, (float)shadow);
+
+                pointRanges.push_back(range);
+                ForEachCluster(range, [&](int c) { pointCounts[c]++; });
+            } break;
+
+            case Light::LightType::Spotlight:
+            {
+                if (spotLightCount >= MAX_CLUSTERED_SPOT_LIGHTS) break;
+                const SpotLight* sLight = static_cast<const SpotLight*>(light);
+
+                // bounded by the sphere around the light, the cone is not used for culling
+                float radius = GetLightRadius(sLight->Color, sLight->Intensity, sLight->Constant, 0.09f, 0.032f);
+                glm::vec3 viewPos = glm::vec3(view * glm::vec4(sLight->Position, 1.0f));
+
+                ClusterRange range;
+                if (radius <= 0.0f || !GetClusterRange(viewPos, radius, proj, nearPlane, farPlane, range)) break;
+
+                SpotLightData& data = spotLights[spotLightCount++];
+                data.Position = glm::vec4(sLight->Position, radius);
+                data.Direction = glm::vec4(sLight->Direction, 0.0f);
+                data.Color = glm::vec4(sLight->Color, sLight->Intensity);
+                int shadow = sLight->CastShadows ? RequestLocalShadow(sLight, sLight->Position, glm::normalize(sLight->Direction), radius, sLight->OuterCutoff, shadowCount) : -1;
+                data.Cone = glm::vec4(glm::cos(glm::radians(sLight->InnerCutoff)), glm::cos(glm::radians(sLight->OuterCutoff)), sLight->Constant, (float)shadow);
+
+                spotRanges.push_back(range);
+                ForEachCluster(range, [&](int c) { spotCounts[c]++; });
+            } break;
+        }
+    }
+
+    // prefix sum into offsets, truncating clusters once the index buffer is full
+    uint offset = 0;
+    uint maxPerCluster = 0;
+    bool overflow = false;
+    for (int c = 0; c < CLUSTER_COUNT; ++c)
+    {
+        uint available = MAX_CLUSTER_LIGHT_INDICES - offset;
+        uint points = std::min(pointCounts[c], available);
+        uint spots = std::min(spotCounts[c], available - points);
+        overflow |= points != pointCounts[c] || spots != spotCounts[c];
+
+        clusters[c] = { offset, points, spots, 0 };
+        offset += points + spots;
+        maxPerCluster = std::max(maxPerCluster, points + spots);
+
+        // reuse the count arrays as write cursors
+        pointCounts[c] = 0;
+        spotCounts[c] = 0;
+    }
+
+    for (uint i = 0; i < pointLightCount; ++i)
+    {
+        ForEachCluster(pointRanges[i], [&](int c) {
+            ClusterData& cluster = clusters[c];
+            if (pointCounts[c] < cluster.PointCount) indices[cluster.Offset + pointCounts[c]++] = i;
+        });
+    }
+
+    for (uint i = 0; i < spotLightCount; ++i)
+    {
+        ForEachCluster(spotRanges[i], [&](int c) {
+            ClusterData& cluster = clusters[c];
+            if (spotCounts[c] < cluster.SpotCount) indices[cluster.Offset + cluster.PointCount + spotCounts[c]++] = i;
+        });
+    }
+
+    m_PointLightSSBO->Bind(std::max(pointLightCount, 1u) * sizeof(PointLightData));
+    m_SpotLightSSBO->Bind(std::max(spotLightCount, 1u) * sizeof(SpotLightData));
+    m_ClusterSSBO->Bind(CLUSTER_COUNT * sizeof(ClusterData));
+    m_LightIndexSSBO->Bind(std::max(offset, 1u) * sizeof(uint));
+
+    UpdateLocalShadows(shadows);
+    m_LocalShadowSSBO->Bind(std::max(shadowCount, 1u) * sizeof(LocalShadowData));
+
+    m_LightCullingStats.VisiblePointLights = pointLightCount;
+    m_LightCullingStats.VisibleSpotLights = spotLightCount;
+    m_LightCullingStats.IndexCount = offset;
+    m_LightCullingStats.MaxLightsPerCluster = maxPerCluster;
+    m_LightCullingStats.Overflow = overflow;
+    m_LightCullingStats.CpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,221 @@
+#include "../Renderer.h"
+
+#include <bit>
+
+static constexpr float LOCAL_SHADOW_NEAR = 0.05f;
+static constexpr uint SPOT_SHADOW_MAX_TILE = 1024;
+static constexpr uint POINT_SHADOW_MAX_TILE = 512;
+
+bool Renderer::SphereInFrustum(const glm::mat4& viewProj, const glm::vec3& center, float radius)
+{
+    // planes straight from the matrix rows (Gribb/Hartmann)
+    glm::mat4 m = glm::transpose(viewProj);
+    for (int i = 0; i < 6; ++i)
+    {
+        glm::vec4 plane = m[3] + ((i & 1) ? -m[i / 2] : m[i / 2]);
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * glm::length(glm::vec3(plane))) return false;
+    }
+    return true;
+}
+
+// pixels covered by the light's sphere on screen, roughly
+static float GetLightImportance(const Camera* camera, const glm::vec3& position, float radius, uint screenHeight)
+{
+    float distance = glm::length(position - camera->GetPosition());
+    if (distance <= radius) return (float)screenHeight;
+    return radius / (distance * std::tan(glm::radians(camera->GetFOV()) * 0.5f)) * screenHeight;
+}
+
+// called by LightCullingPass for every visible light with CastShadows. keeps the atlas tiles and marks
+// them dirty when the light or a caster in its range moved. reserves the light's entries in the local
+// shadow buffer and returns the first one, -1 if the light gets no shadow this frame
+int Renderer::RequestLocalShadow(const Light* light, const glm::vec3& position, const glm::vec3& direction, float radius, float cutoff, uint& shadowCount)
+{
+    const bool point = light->GetType() == Light::LightType::Point;
+    const uint tileCount = point ? 6 : 1;
+    const uint allTiles = (1u << tileCount) - 1;
+    if (shadowCount + tileCount > MAX_LOCAL_SHADOW_TILES) return -1;
+
+    LocalShadow& shadow = m_LocalShadows[light];
+    shadow.Seen = true;
+    shadow.Importance = GetLightImportance(m_Scene->activeCamera, position, radius, m_Height);
+
+    // grow as soon as the light needs more texels, only shrink once it needs a quarter of them
+    uint maxTile = point ? POINT_SHADOW_MAX_TILE : SPOT_SHADOW_MAX_TILE;
+    uint wanted = std::clamp(std::bit_ceil((uint)std::max(shadow.Importance, 1.0f)), (uint)SHADOW_ATLAS_MIN_TILE, maxTile);
+    bool resize = shadow.TileCount != tileCount || wanted > shadow.TileSize || wanted * 4 <= shadow.TileSize;
+
+    if (resize)
+    {
+        for (ShadowAtlasTile& tile : shadow.Tiles) m_ShadowAtlas.Free(tile);
+        shadow.TileCount = 0;
+        shadow.RenderedMask = 0;
+
+        bool complete = true;
+        for (uint i = 0; i < tileCount; ++i)
+        {
+            shadow.Tiles[i] = m_ShadowAtlas.Allocate(wanted);
+            complete &= shadow.Tiles[i].IsValid();
+        }
+        if (!complete)
+        {
+            for (ShadowAtlasTile& tile : shadow.Tiles) m_ShadowAtlas.Free(tile);
+            m_LocalShadowStats.FailedAllocations++;
+            return -1;
+        }
+
+        shadow.TileCount = tileCount;
+        shadow.TileSize = wanted;
+    }
+
+    bool lightChanged = shadow.Position != position || shadow.Direction != direction || shadow.Radius != radius || shadow.Cutoff != cutoff;
+    if (lightChanged || resize)
+    {
+        shadow.Position = position;
+        shadow.Direction = direction;
+        shadow.Radius = radius;
+        shadow.Cutoff = cutoff;
+
+        float fov = point ? glm::radians(90.0f) : std::min(2.0f * glm::radians(cutoff) + 0.05f, glm::radians(170.0f));
+        glm::mat4 proj = glm::perspective(fov, 1.0f, LOCAL_SHADOW_NEAR, radius);
+        if (point)
+        {
+            static const glm::vec3 faceTargets[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+            static const glm::vec3 faceUps[] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+            for (uint i = 0; i < 6; ++i) shadow.Matrices[i] = proj * glm::lookAt(position, position + faceTargets[i], faceUps[i]);
+        }
+        else
+        {
+            glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            shadow.Matrices[0] = proj * glm::lookAt(position, position + direction, up);
+        }
+        shadow.DirtyMask = allTiles;
+    }
+
+    // any caster in range that moved, appeared or went away changes the signature
+    size_t signature = 0;
+    for (const DrawCmd& cmd : m_DeferredQueue)
+    {
+        if (!cmd.shadowCasting || glm::length(cmd.boundsCenter - position) > radius + cmd.boundsRadius) continue;
+        signature = signature * 31 + std::hash<const void*>()(cmd.Owner) + cmd.SubMeshIndex * 7919 + cmd.Owner->transformVersion;
+    }
+    if (signature != shadow.CasterSignature)
+    {
+        shadow.CasterSignature = signature;
+        shadow.DirtyMask = allTiles;
+    }
+
+    shadow.BufferIndex = shadowCount;
+    shadowCount += tileCount;
+    return (int)shadow.BufferIndex;
+}
+
+// after culling: gives the tiles of lights that were not requested this frame (culled, deleted or no
+// longer casting) back, picks the dirty tiles LocalShadowPass renders within the budget, most important
+// lights first, and fills the reserved buffer entries. a tile keeps the matrix it was rendered with until
+// it is re-rendered, so a light whose update is pending shows a slightly stale shadow, never a wrong one
+void Renderer::UpdateLocalShadows(LocalShadowData* shadowData)
+{
+    PROFILE_FUNCTION();
+    FrameVector<LocalShadow*> pending(&m_FrameArena);
+    for (auto it = m_LocalShadows.begin(); it != m_LocalShadows.end(); )
+    {
+        LocalShadow& shadow = it->second;
+        if (!shadow.Seen || !shadow.TileCount)
+        {
+            for (ShadowAtlasTile& tile : shadow.Tiles) m_ShadowAtlas.Free(tile);
+            it = m_LocalShadows.erase(it);
+            continue;
+        }
+
+        shadow.Seen = false;
+        if (shadow.DirtyMask) pending.push_back(&shadow);
+        ++it;
+    }
+
+    std::sort(pending.begin(), pending.end(), [](const LocalShadow* a, const LocalShadow* b) { return a->Importance > b->Importance; });
+
+    uint budget = (uint)std::max(m_ShadowTileBudget, 1);
+    uint scheduled = 0;
+    for (LocalShadow* shadow : pending)
+    {
+        for (uint i = 0; i < shadow->TileCount && scheduled < budget; ++i)
+        {
+            uint bit = 1u << i;
+            if (!(shadow->DirtyMask & bit)) continue;
+
+            shadow->RenderedMatrices[i] = shadow->Matrices[i];
+            shadow->DirtyMask &= ~bit;
+            shadow->ScheduledMask |= bit;
+            shadow->RenderedMask |= bit;
+            scheduled++;
+        }
+    }
+
+    uint pendingTiles = 0;
+    float atlasSize = (float)m_ShadowAtlas.GetSize();
+    for (auto& [light, shadow] : m_LocalShadows)
+    {
+        pendingTiles += std::popcount(shadow.DirtyMask);
+        for (uint i = 0; i < shadow.TileCount; ++i)
+        {
+            const ShadowAtlasTile& tile = shadow.Tiles[i];
+            bool rendered = shadow.RenderedMask & (1u << i);
+
+            LocalShadowData& data = shadowData[shadow.BufferIndex + i];
+            data.ViewProj = shadow.RenderedMatrices[i];
+            data.AtlasRect = rendered ? glm::vec4(tile.X, tile.Y, tile.Size, tile.Size) / atlasSize : glm::vec4(0.0f);
+        }
+    }
+
+    m_LocalShadowStats.ShadowedLights = (uint)m_LocalShadows.size();
+    m_LocalShadowStats.AllocatedTiles = m_ShadowAtlas.GetAllocatedTiles();
+    m_LocalShadowStats.Occupancy = m_ShadowAtlas.GetOccupancy();
+    m_LocalShadowStats.TilesUpdated = scheduled;
+    m_LocalShadowStats.PendingTiles = pendingTiles;
+    m_LocalShadowStats.TotalTileUpdates += scheduled;
+}
+
+// renders the tiles UpdateLocalShadows scheduled this frame
+void Renderer::LocalShadowPass()
+{
+    if (m_LocalShadowStats.TilesUpdated == 0) return;
+
+    m_ShadowMapShader->Bind();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_ShadowAtlas.GetFramebuffer());
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.5f, 4.0f);
+
+    for (auto& [light, shadow] : m_LocalShadows)
+    {
+        for (uint i = 0; i < shadow.TileCount; ++i)
+        {
+            if (!(shadow.ScheduledMask & (1u << i))) continue;
+
+            const ShadowAtlasTile& tile = shadow.Tiles[i];
+            const glm::mat4& viewProj = shadow.RenderedMatrices[i];
+            glViewport(tile.X, tile.Y, tile.Size, tile.Size);
+            glScissor(tile.X, tile.Y, tile.Size, tile.Size);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            m_ShadowMapShader->Set(m_ShadowMapUniforms.LightProj, viewProj);
+            for (const DrawCmd& cmd : m_DeferredQueue)
+            {
+                if (!cmd.shadowCasting || !SphereInFrustum(viewProj, cmd.boundsCenter, cmd.boundsRadius)) continue;
+                m_ShadowMapShader->Set(m_ShadowMapUniforms.Model, cmd.Model);
+                BindMaterial(cmd.Material);
+                cmd.Mesh->Bind();
+                cmd.Mesh->DrawSubMesh(cmd.SubMeshIndex);
+            }
+        }
+        shadow.ScheduledMask = 0;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
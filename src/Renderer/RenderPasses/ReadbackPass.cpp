@@ -0,0 +1,169 @@
+#include "../Renderer.h"
+
+// order of m_ReadbackPBOs
+enum ReadbackTarget { ReadbackFinal, ReadbackAlbedo, ReadbackNormal, ReadbackARM, ReadbackLighting, ReadbackDepth, ReadbackTargetCount };
+static const char* s_ReadbackNames[ReadbackTargetCount] = { "final", "albedo", "normal", "arm", "lighting", "depth" };
+
+// float targets come back as rgba32f (or r32f for depth), the rest as rgba8
+static size_t ReadbackPixelSize(int target)
+{
+    if (target == ReadbackNormal || target == ReadbackLighting) return 16;
+    return 4;
+}
+
+static uint8_t ReadbackToByte(float value)
+{
+    return (uint8_t)std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+// same as DecodeNormal in lighting.frag
+static glm::vec3 ReadbackDecodeOctahedral(glm::vec2 f)
+{
+    f = f * 2.0f - 1.0f;
+    glm::vec3 n(f.x, f.y, 1.0f - std::abs(f.x) - std::abs(f.y));
+    float t = std::clamp(-n.z, 0.0f, 1.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+void Renderer::SetTargetReadback(bool enabled)
+{
+    if (enabled == m_TargetReadback) return;
+    m_TargetReadback = enabled;
+    m_RenderGraphDirty = true;
+}
+
+void Renderer::RequestTargetReadback()
+{
+    SetTargetReadback(true);
+    m_ReadbackRequested = true;
+}
+
+void Renderer::ReadbackPass()
+{
+    if (!m_ReadbackRequested) return;
+    m_ReadbackRequested = false;
+
+    if (!m_ReadbackPBOs[0]) glGenBuffers(ReadbackTargetCount, m_ReadbackPBOs.data());
+
+    // reallocated only when the size changes
+    if (m_ReadbackWidth != m_Width || m_ReadbackHeight != m_Height)
+    {
+        for (int i = 0; i < ReadbackTargetCount; ++i)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadbackPBOs[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)m_Width * m_Height * ReadbackPixelSize(i), nullptr, GL_STREAM_READ);
+        }
+        m_ReadbackWidth = m_Width;
+        m_ReadbackHeight = m_Height;
+    }
+
+    m_ReadbackNear = m_Scene->activeCamera->GetNear();
+    m_ReadbackFar = m_Scene->activeCamera->GetFar();
+    m_ReadbackSlim = m_GBufferLayout == GBufferLayout::Slim;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadbackPBOs[ReadbackFinal]);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_OutputFBO);
+    glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    auto readTexture = [this](int target, RenderGraphResource resource, GLenum format, GLenum type) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadbackPBOs[target]);
+        glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(resource));
+        glGetTexImage(GL_TEXTURE_2D, 0, format, type, nullptr);
+    };
+    readTexture(ReadbackAlbedo, m_GBuffer.Albedo, GL_RGBA, GL_UNSIGNED_BYTE);
+    readTexture(ReadbackNormal, m_GBuffer.Normal, GL_RGBA, GL_FLOAT);
+    readTexture(ReadbackARM, m_GBuffer.ARM, GL_RGBA, GL_UNSIGNED_BYTE);
+    readTexture(ReadbackLighting, m_LightingResult, GL_RGBA, GL_FLOAT);
+    readTexture(ReadbackDepth, m_GBuffer.Depth, GL_DEPTH_COMPONENT, GL_FLOAT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    if (m_ReadbackFence) glDeleteSync(m_ReadbackFence);
+    m_ReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool Renderer::ReadbackTargets(std::vector<RenderTargetImage>& images)
+{
+    if (!m_ReadbackFence) return false;
+
+    GLenum status;
+    do status = glClientWaitSync(m_ReadbackFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    while (status == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(m_ReadbackFence);
+    m_ReadbackFence = nullptr;
+
+    const uint width = m_ReadbackWidth;
+    const uint height = m_ReadbackHeight;
+    const float n = m_ReadbackNear;
+    const float f = m_ReadbackFar;
+
+    images.resize(ReadbackTargetCount);
+    for (int target = 0; target < ReadbackTargetCount; ++target)
+    {
+        RenderTargetImage& image = images[target];
+        image.Name = s_ReadbackNames[target];
+        image.Pixels.assign((size_t)width * height * 4, 255);
+
+        const size_t pixelSize = ReadbackPixelSize(target);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ReadbackPBOs[target]);
+        const uint8_t* data = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)width * height * pixelSize, GL_MAP_READ_BIT);
+        if (!data)
+        {
+            std::cout << "Readback: failed to map the " << image.Name << " buffer" << std::endl;
+            continue;
+        }
+
+        for (uint y = 0; y < height; ++y)
+        {
+            // GL rows are bottom up
+            const uint8_t* row = data + (size_t)(height - 1 - y) * width * pixelSize;
+            uint8_t* out = image.Pixels.data() + (size_t)y * width * 4;
+
+            for (uint x = 0; x < width; ++x, out += 4)
+            {
+                if (pixelSize == 4 && target != ReadbackDepth)
+                {
+                    out[0] = row[x * 4 + 0];
+                    out[1] = row[x * 4 + 1];
+                    out[2] = row[x * 4 + 2];
+                    continue;
+                }
+
+                if (target == ReadbackDepth)
+                {
+                    // linear view depth, log mapped so near geometry keeps some precision
+                    float d = ((const float*)row)[x];
+                    float linear = 2.0f * n * f / (f + n - (d * 2.0f - 1.0f) * (f - n));
+                    uint8_t v = ReadbackToByte(std::log(linear / n) / std::log(f / n));
+                    out[0] = out[1] = out[2] = v;
+                    continue;
+                }
+
+                const float* texel = (const float*)row + x * 4;
+                glm::vec3 value(texel[0], texel[1], texel[2]);
+                if (target == ReadbackNormal)
+                {
+                    if (m_ReadbackSlim) value = ReadbackDecodeOctahedral(glm::vec2(value));
+                    value = value * 0.5f + 0.5f;
+                }
+                else value = value / (1.0f + value);    // reinhard, the lighting target is hdr
+
+                out[0] = ReadbackToByte(value.r);
+                out[1] = ReadbackToByte(value.g);
+                out[2] = ReadbackToByte(value.b);
+            }
+        }
+
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
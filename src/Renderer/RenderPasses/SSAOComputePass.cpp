@@ -0,0 +1,60 @@
+#include "../Renderer.h"
+
+static uint DivideRoundUp(uint value, uint divisor)
+{
+    return (value + divisor - 1) / divisor;
+}
+
+void Renderer::SSAOComputePass()
+{
+    int scale = m_SSAOMode == SSAOMode::QuarterResolution ? 4 : 2;
+    uint lowWidth = DivideRoundUp(m_Width, scale);
+    uint lowHeight = DivideRoundUp(m_Height, scale);
+
+    uint lowDepth = m_RenderGraph.GetTexture(m_SSAOLowDepth);
+    uint lowRaw = m_RenderGraph.GetTexture(m_SSAOLowRaw);
+    uint lowBlur = m_RenderGraph.GetTexture(m_SSAOLowBlur);
+    uint depth = m_RenderGraph.GetTexture(m_GBuffer.Depth);
+
+    // downsample depth, closest of each footprint, stored linear
+    m_SSAODownsampleShader->Bind();
+    m_SSAODownsampleShader->Set(m_SSAODownsampleScale, scale);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depth);
+    glBindImageTexture(0, lowDepth, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(DivideRoundUp(lowWidth, 8), DivideRoundUp(lowHeight, 8), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // AO at low resolution
+    m_SSAOComputeShader->Bind();
+    m_SSAOComputeShader->Set(m_SSAOComputeSampleCount, m_SSAOComputeSamples);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, lowDepth);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Normal));
+    glBindImageTexture(0, lowRaw, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+    glDispatchCompute(DivideRoundUp(lowWidth, 8), DivideRoundUp(lowHeight, 8), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // bilateral blur, 16x16 tiles in shared memory
+    m_SSAOBlurComputeShader->Bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, lowRaw);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, lowDepth);
+    glBindImageTexture(0, lowBlur, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+    glDispatchCompute(DivideRoundUp(lowWidth, 16), DivideRoundUp(lowHeight, 16), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // joint bilateral upsample into the same target the fragment path blurs into
+    m_SSAOUpsampleShader->Bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, lowBlur);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, lowDepth);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, depth);
+    glBindImageTexture(0, m_RenderGraph.GetTexture(m_SSAOResult), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+    glDispatchCompute(DivideRoundUp(m_Width, 8), DivideRoundUp(m_Height, 8), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
@@ -2,25 +2,24 @@
 
 void Renderer::SSAOPass()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_SSAOFBO);
     glClear(GL_COLOR_BUFFER_BIT);
     m_SSAOShader->Bind();
-    m_SSAOShader->SetUniformMat4f("uProjection", m_Scene->activeCamera->GetProjectionMatrix());
-    m_SSAOShader->SetUniform2f("uResolution", m_Width, m_Height);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Position);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Position));
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Normal);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Normal));
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, m_SSAONoise);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Depth));
     m_GBuffer.quad.Draw();
+}
 
-    // blur SSAO texture
-    glBindFramebuffer(GL_FRAMEBUFFER, m_SSAOBlurFBO);
+void Renderer::SSAOBlurPass()
+{
     glClear(GL_COLOR_BUFFER_BIT);
     m_SSAOBlurShader->Bind();
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_SSAOColorBuffer);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_SSAORaw));
     m_GBuffer.quad.Draw();
-
-}
\ No newline at end of file
+}
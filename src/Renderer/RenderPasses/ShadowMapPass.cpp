@@ -1,81 +1,79 @@
 #include "../Renderer.h"
 
-std::vector<glm::vec4> Renderer::GetFrustumCornersWorldSpace(const glm::mat4& proj, const glm::mat4& view)
+// far cascades cover a lot of ground per texel, refreshing them every few frames is not visible.
+// staggered by the cascade index so they don't all land on the same frame
+static constexpr uint SHADOW_CASCADE_INTERVALS[] = { 1, 1, 2, 4, 4 };
+
+// the box is snapped to cells this many times smaller than the shadow map and padded by half a cell,
+// so the cascade (and its cached static layer) stays put until the camera leaves the cell
+static constexpr uint SHADOW_CASCADE_CELL_DIVISOR = 8;
+static constexpr float SHADOW_CASTER_DISTANCE = 3000.0f;   // behind the cascade, towards the sun
+
+// bounding sphere against a cascade's light space box, per axis scale comes from the matrix rows
+static bool SphereInCascade(const glm::mat4& lightSpace, const glm::vec3& center, float radius)
 {
-    const auto inv = glm::inverse(proj * view);
-    
-    std::vector<glm::vec4> frustumCorners;
-    for (unsigned int x = 0; x < 2; ++x)
+    glm::vec4 p = lightSpace * glm::vec4(center, 1.0f);
+    for (int axis = 0; axis < 3; ++axis)
     {
-        for (unsigned int y = 0; y < 2; ++y)
-        {
-            for (unsigned int z = 0; z < 2; ++z)
-            {
-                const glm::vec4 pt = 
-                    inv * glm::vec4(
-                        2.0f * x - 1.0f,
-                        2.0f * y - 1.0f,
-                        2.0f * z - 1.0f,
-                        1.0f);
-                frustumCorners.push_back(pt / pt.w);
-            }
-        }
+        float scale = glm::length(glm::vec3(lightSpace[0][axis], lightSpace[1][axis], lightSpace[2][axis]));
+        if (std::abs(p[axis]) > 1.0f + radius * scale) return false;
     }
-    return frustumCorners;
+    return true;
 }
 
-glm::mat4 Renderer::GetLightSpaceMatrix(const float nearPlane, const float farPlane)
+// smallest sphere around the split, from the fov / aspect / distances alone so it doesn't pick up
+// float noise from the camera's position or rotation. rounded up to a whole unit
+ShadowCascadeKey Renderer::GetShadowCascadeKey(const float nearPlane, const float farPlane)
 {
-    const auto proj = glm::perspective(
-        glm::radians(m_Scene->activeCamera->GetFOV()), 
-        (float)m_Width / (float)m_Height, 
-        nearPlane, 
-        farPlane
-    );
+    const Camera& camera = *m_Scene->activeCamera;
+    float tanHalfFov = std::tan(glm::radians(camera.GetFOV()) * 0.5f);
+    float aspect = (float)m_Width / (float)m_Height;
+    float spread = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);  // corner offset squared / depth squared
 
-    const auto corners = GetFrustumCornersWorldSpace(proj, m_Scene->activeCamera->GetViewMatrix());
+    // along the view direction, where the near and far corners are the same distance away. past
+    // the far plane for wide splits, then the far corners alone decide
+    float depth = std::min(0.5f * (nearPlane + farPlane) * (1.0f + spread), farPlane);
+    float radius = std::sqrt((farPlane - depth) * (farPlane - depth) + farPlane * farPlane * spread);
+    radius = std::ceil(radius);
 
-    glm::vec3 center = glm::vec3(0, 0, 0);
-    for (const auto& v : corners)
-    {
-        center += glm::vec3(v);
-    }
-    center /= corners.size();
+    ShadowCascadeKey key;
+    key.SunDirection = glm::normalize(m_Scene->m_Sun.Direction);
+    key.Extent = radius * SHADOW_CASCADE_CELL_DIVISOR / (SHADOW_CASCADE_CELL_DIVISOR - 1.0f);
+    float cellSize = 2.0f * key.Extent / SHADOW_CASCADE_CELL_DIVISOR;
 
-    float radius = 0.0f;
-    for (const auto& v : corners)
-    {
-        float distance = glm::length(glm::vec3(v) - center);
-        radius = std::max(radius, distance);
-    }
-    
-    float texelsPerUnit = m_ShadowMapResolution / (radius * 2.0f);
-    glm::mat4 tempLightView = glm::lookAt(
-        glm::vec3(0.0f), 
-        glm::normalize(m_Scene->m_Sun.Direction), 
-        glm::vec3(0.0f, 1.0f, 0.0f)
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), key.SunDirection, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec3 center = glm::vec3(lightView * glm::vec4(camera.GetPosition() + camera.GetFront() * depth, 1.0f));
+
+    // the depth range is long enough that z only needs slabs as deep as the box
+    key.Cell = glm::ivec3(
+        (int)std::round(center.x / cellSize),
+        (int)std::round(center.y / cellSize),
+        (int)std::round(center.z / key.Extent)
     );
-    
-    glm::vec3 centerLS = glm::vec3(tempLightView * glm::vec4(center, 1.0f));
-    centerLS *= texelsPerUnit;
-    centerLS.x = std::floor(centerLS.x);
-    centerLS.y = std::floor(centerLS.y);
-    centerLS /= texelsPerUnit;
+    return key;
+}
 
+// a cell is a whole number of texels and the box is the map's resolution wide, so the texels land
+// in the same world spots whichever cell the camera is in
+glm::mat4 Renderer::GetLightSpaceMatrix(const ShadowCascadeKey& key)
+{
+    float cellSize = 2.0f * key.Extent / SHADOW_CASCADE_CELL_DIVISOR;
+    glm::vec3 centerLS = glm::vec3(glm::vec2(key.Cell) * cellSize, key.Cell.z * key.Extent);
+
+    glm::mat4 tempLightView = glm::lookAt(glm::vec3(0.0f), key.SunDirection, glm::vec3(0.0f, 1.0f, 0.0f));
     glm::vec3 centerWorld = glm::vec3(glm::inverse(tempLightView) * glm::vec4(centerLS, 1.0f));
 
-    float farShadowRenderDistance = 3000.0f; 
-    
+    // the snapped center can be half a slab off in z, both ends are pushed out by that
     glm::mat4 lightProjection = glm::ortho(
-        -radius, radius,
-        -radius, radius,
-        -farShadowRenderDistance,
-        radius
+        -key.Extent, key.Extent,
+        -key.Extent, key.Extent,
+        -SHADOW_CASTER_DISTANCE - key.Extent * 0.5f,
+        key.Extent * 1.5f
     );
 
     glm::mat4 lightView = glm::lookAt(
         centerWorld,
-        centerWorld + glm::normalize(m_Scene->m_Sun.Direction),
+        centerWorld + key.SunDirection,
         glm::vec3(0.0f, 1.0f, 0.0f)
     );
 
@@ -112,6 +110,19 @@ void Renderer::ShadowMapInit()
     
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
+    // static casters only, copied into m_ShadowMapTexture before the dynamic ones are drawn
+    glGenTextures(1, &m_StaticShadowMapTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_StaticShadowMapTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, m_ShadowMapResolution, m_ShadowMapResolution, m_ShadowMapSplit);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    m_ShadowCascadeCache.resize(m_ShadowMapSplit);
+
+    // sized once here, the pass only overwrites entries
+    m_ShadowCascadeLevels.resize(m_ShadowMapSplit + 1);
+    m_ShadowCascadeMatrices.resize(m_ShadowMapSplit);
+
     m_ShadowMapDebugTextures.resize(m_ShadowMapSplit);
     glGenTextures(m_ShadowMapSplit, m_ShadowMapDebugTextures.data());
 
@@ -129,10 +140,80 @@ void Renderer::ShadowMapInit()
 }
 
 
+// compares the static casters with what is baked into the cache, a static caster that moved, appeared
+// or went away (removed or made dynamic) invalidates every cascade it overlaps, before and after
+void Renderer::UpdateStaticShadowCasters()
+{
+    auto invalidate = [this](const glm::vec3& center, float radius) {
+        for (ShadowCascadeCache& cache : m_ShadowCascadeCache)
+        {
+            if (cache.StaticValid && SphereInCascade(cache.Matrix, center, radius)) cache.StaticValid = false;
+        }
+    };
+
+    for (auto& [key, caster] : m_StaticShadowCasters) caster.Seen = false;
+
+    for (const DrawCmd& cmd : m_DeferredQueue)
+    {
+        if (!cmd.shadowCasting || !cmd.isStatic) continue;
+
+        auto [it, inserted] = m_StaticShadowCasters.try_emplace({ cmd.Owner, cmd.SubMeshIndex });
+        StaticShadowCaster& caster = it->second;
+        caster.Seen = true;
+
+        if (!inserted && caster.TransformVersion == cmd.Owner->transformVersion) continue;
+
+        if (!inserted) invalidate(caster.Center, caster.Radius);
+        invalidate(cmd.boundsCenter, cmd.boundsRadius);
+
+        caster.TransformVersion = cmd.Owner->transformVersion;
+        caster.Center = cmd.boundsCenter;
+        caster.Radius = cmd.boundsRadius;
+    }
+
+    for (auto it = m_StaticShadowCasters.begin(); it != m_StaticShadowCasters.end(); )
+    {
+        if (it->second.Seen) { ++it; continue; }
+        invalidate(it->second.Center, it->second.Radius);
+        it = m_StaticShadowCasters.erase(it);
+    }
+}
+
+// into whatever layer is attached to m_ShadowMapFBO
+void Renderer::RenderShadowCasters(bool staticCasters, uint cascade)
+{
+    const glm::mat4& lightSpace = m_ShadowCascadeCache[cascade].Matrix;
+
+    for (const DrawCmd& cmd : m_DeferredQueue)
+    {
+        if (!cmd.shadowCasting || cmd.isStatic != staticCasters) continue;
+        if (!SphereInCascade(lightSpace, cmd.boundsCenter, cmd.boundsRadius)) continue;
+
+        m_ShadowMapShader->Set(m_ShadowMapUniforms.Model, cmd.Model);
+        BindMaterial(cmd.Material);
+        cmd.Mesh->Bind();
+        cmd.Mesh->DrawSubMesh(cmd.SubMeshIndex);
+    }
+}
+
+// static casters are rendered once per cascade into m_StaticShadowMapTexture, an update copies that
+// layer in and draws the dynamic casters on top. cascades without dynamic casters whose key did not
+// change are left alone entirely. far cascades keep their old matrix between scheduled updates so
+// the matrix and the map always agree
 void Renderer::ShadowMapPass()
 {
-    m_ShadowCascadeLevels = { m_Scene->activeCamera->GetNear(), m_ShadowCascadeLevelOne, m_ShadowCascadeLevelTwo, m_ShadowCascadeLevelThree, m_ShadowCascadeLevelFour, m_Scene->activeCamera->GetFar() };
-    m_ShadowCascadeMatrices.clear();
+    m_ShadowCascadeLevels[0] = m_Scene->activeCamera->GetNear();
+    m_ShadowCascadeLevels[1] = m_ShadowCascadeLevelOne;
+    m_ShadowCascadeLevels[2] = m_ShadowCascadeLevelTwo;
+    m_ShadowCascadeLevels[3] = m_ShadowCascadeLevelThree;
+    m_ShadowCascadeLevels[4] = m_ShadowCascadeLevelFour;
+    m_ShadowCascadeLevels[5] = m_Scene->activeCamera->GetFar();
+
+    if (!m_ShadowCaching)
+    {
+        for (ShadowCascadeCache& cache : m_ShadowCascadeCache) cache.StaticValid = false;
+    }
+    UpdateStaticShadowCasters();
 
     m_ShadowMapShader->Bind();
     glEnable(GL_DEPTH_TEST);
@@ -141,32 +222,74 @@ void Renderer::ShadowMapPass()
     glBindFramebuffer(GL_FRAMEBUFFER, m_ShadowMapFBO);
     glViewport(0, 0, m_ShadowMapResolution, m_ShadowMapResolution);
 
-    for (size_t i = 0; i < m_ShadowCascadeLevels.size() - 1; ++i)
+    for (uint i = 0; i < m_ShadowMapSplit; ++i)
     {
-        glm::mat4 lightSpaceMatrix = GetLightSpaceMatrix(m_ShadowCascadeLevels[i], m_ShadowCascadeLevels[i+1]);
-        m_ShadowCascadeMatrices.push_back(lightSpaceMatrix);
-        
-        m_ShadowMapShader->SetUniformMat4f("uLightProj", lightSpaceMatrix);
+        ShadowCascadeCache& cache = m_ShadowCascadeCache[i];
+        cache.Updated = false;
+
+        uint interval = SHADOW_CASCADE_INTERVALS[std::min<size_t>(i, std::size(SHADOW_CASCADE_INTERVALS) - 1)];
+        bool scheduled = !m_ShadowCaching || !cache.StaticValid || (m_ShadowFrameIndex + i) % interval == 0;
+        if (!scheduled) continue;
 
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_ShadowMapTexture, 0, i);
-        glClear(GL_DEPTH_BUFFER_BIT);
+        ShadowCascadeKey key = GetShadowCascadeKey(m_ShadowCascadeLevels[i], m_ShadowCascadeLevels[i+1]);
+        if (!(key == cache.Key))
+        {
+            cache.Key = key;
+            cache.Matrix = GetLightSpaceMatrix(key);
+            cache.StaticValid = false;
+        }
+        m_ShadowCascadeMatrices[i] = cache.Matrix;
 
+        bool hasDynamic = false;
         for (const DrawCmd& cmd : m_DeferredQueue)
         {
-            if (!cmd.shadowCasting) continue;
-            m_ShadowMapShader->SetUniformMat4f("uModel", cmd.Model);
-            BindMaterial(cmd.Material);
-            cmd.Mesh->Bind();
-            cmd.Mesh->DrawSubMesh(cmd.SubMeshIndex);
+            if (cmd.shadowCasting && !cmd.isStatic && SphereInCascade(cache.Matrix, cmd.boundsCenter, cmd.boundsRadius))
+            {
+                hasDynamic = true;
+                break;
+            }
         }
+
+        if (cache.StaticValid && !hasDynamic && !cache.HasDynamic) continue;
+
+        m_ShadowMapShader->Set(m_ShadowMapUniforms.LightProj, cache.Matrix);
+
+        if (!cache.StaticValid)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_StaticShadowMapTexture, 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            RenderShadowCasters(true, i);
+            cache.StaticValid = true;
+            cache.StaticUpdateCount++;
+        }
+
+        glCopyImageSubData(
+            m_StaticShadowMapTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+            m_ShadowMapTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
+            m_ShadowMapResolution, m_ShadowMapResolution, 1
+        );
+
+        if (hasDynamic)
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_ShadowMapTexture, 0, i);
+            RenderShadowCasters(false, i);
+        }
+
+        cache.HasDynamic = hasDynamic;
+        cache.Updated = true;
+        cache.UpdateCount++;
     }
+    m_ShadowFrameIndex++;
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    UploadCascadeUniforms();
+
     // for debugging
     if (m_ShadowMapDebugTextures.empty()) return;
     for (uint i = 0; i < m_ShadowMapSplit; ++i)
     {
+        if (!m_ShadowCascadeCache[i].Updated) continue;
         glCopyImageSubData(
             m_ShadowMapTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
             m_ShadowMapDebugTextures[i], GL_TEXTURE_2D, 0, 0, 0, 0,
@@ -1,47 +1,98 @@
 #include "../Renderer.h"
 
+// about a quarter of a degree of sun movement, 1% colour / intensity / exposure change
+static constexpr float SKY_PROBE_DIRECTION_THRESHOLD = 0.99999f;
+static constexpr float SKY_PROBE_COLOR_THRESHOLD = 0.01f;
+static constexpr float SKY_PROBE_RELATIVE_THRESHOLD = 0.01f;
+
+static bool SkyProbeInputsChanged(const SkyProbeInputs& a, const SkyProbeInputs& b)
+{
+    auto relativeChange = [](float x, float y) {
+        return std::abs(x - y) > SKY_PROBE_RELATIVE_THRESHOLD * std::max(std::abs(x), std::abs(y));
+    };
+
+    if (glm::dot(glm::normalize(a.SunDirection), glm::normalize(b.SunDirection)) < SKY_PROBE_DIRECTION_THRESHOLD) return true;
+    glm::vec3 colorDelta = glm::abs(a.SunColor - b.SunColor);
+    if (std::max(std::max(colorDelta.r, colorDelta.g), colorDelta.b) > SKY_PROBE_COLOR_THRESHOLD) return true;
+    return relativeChange(a.SunIntensity, b.SunIntensity) || relativeChange(a.Exposure, b.Exposure);
+}
+
+void Renderer::RenderSkyProbeFace(uint probe, uint face)
+{
+    static const glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    static const glm::mat4 captureViews[] = {
+        glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+    };
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, probe, 0);
+    m_AtmosphereIBLShader->Set(m_AtmosphereUniforms.CaptureInvViewProj, glm::inverse(proj * captureViews[face]));
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_GBuffer.quad.Draw();
+}
+
+// the probe only changes with the sun and exposure. a refresh renders one face per frame into
+// the back probe and swaps it in once all six are done, the very first capture does all faces at once
 void Renderer::SkyCapture()
 {
+    SkyProbeInputs inputs;
+    inputs.SunDirection = m_Scene->m_Sun.Direction;
+    inputs.SunColor = m_Scene->m_Sun.Color;
+    inputs.SunIntensity = m_Scene->m_Sun.Intensity;
+    inputs.Exposure = m_Exposure;
+
+    if (m_SkyProbeFace < 0)
+    {
+        bool changed = !m_SkyProbeValid || m_SkyProbeForceRefresh || SkyProbeInputsChanged(inputs, m_SkyProbeInputs);
+        if (!changed) return;
+
+        m_SkyProbeInputs = inputs;
+        m_SkyProbeForceRefresh = false;
+        m_SkyProbeFace = 0;
+    }
+
     glViewport(0, 0, m_SkyCaptureSize, m_SkyCaptureSize);
     glBindFramebuffer(GL_FRAMEBUFFER, m_SkyProbeFBO);
     
     glDisable(GL_CULL_FACE); 
     glDisable(GL_DEPTH_TEST);
     
-    m_AtmosphereShader->Bind();
+    m_AtmosphereIBLShader->Bind();
 
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, m_TransmittanceLUT);
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, m_MultiScatteringLUT);
-    
-    m_AtmosphereShader->SetUniform3f("viewPos", 0.0, 0.0, 0.0);
-    m_AtmosphereShader->SetUniform1f("exposure", m_Exposure);
-    m_AtmosphereShader->SetUniform3f("uLightDir", -m_Scene->m_Sun.Direction.x, -m_Scene->m_Sun.Direction.y, -m_Scene->m_Sun.Direction.z);
-    m_AtmosphereShader->SetUniform1i("uIsIBLPass", 1);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, m_SkyViewLUT);
 
-    glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);    glm::mat4 captureViews[] = {
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f), glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-    };
-    
-    for (unsigned int i = 0; i < 6; ++i)
+    if (!m_SkyProbeValid)
     {
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_SkyProbeMap, 0);
-        glm::mat4 viewProj = proj * captureViews[i];
-        m_AtmosphereShader->SetUniformMat4f("uInvViewProj", glm::inverse(viewProj)); 
-        
-        glClear(GL_COLOR_BUFFER_BIT);
-        m_GBuffer.quad.Draw(); 
+        for (uint i = 0; i < 6; ++i) RenderSkyProbeFace(m_SkyProbeMap, i);
+        m_SkyProbeFace = -1;
+        m_SkyProbeValid = true;
+        m_SkyProbeRefreshCount++;
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_SkyProbeMap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     }
+    else
+    {
+        RenderSkyProbeFace(m_SkyProbeBackMap, m_SkyProbeFace++);
 
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_SkyProbeMap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        if (m_SkyProbeFace == 6)
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, m_SkyProbeBackMap);
+            glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_SkyProbeFBO);
-    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_SkyProbeMap, 0);
-}
\ No newline at end of file
+            std::swap(m_SkyProbeMap, m_SkyProbeBackMap);
+            m_SkyProbeFace = -1;
+            m_SkyProbeRefreshCount++;
+        }
+    }
+}
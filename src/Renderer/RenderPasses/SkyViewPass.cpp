@@ -0,0 +1,37 @@
+#include "../Renderer.h"
+
+// same sun threshold as the sky probe, the LUT is parametrized around the camera so it also
+// depends on altitude. a metre is way below anything visible in the sky gradient
+static constexpr float SKY_VIEW_DIRECTION_THRESHOLD = 0.99999f;
+static constexpr float SKY_VIEW_ALTITUDE_THRESHOLD = 1.0f;
+
+void Renderer::SkyViewPass()
+{
+    glm::vec3 sunDirection = glm::normalize(m_Scene->m_Sun.Direction);
+    float altitude = m_Scene->activeCamera->GetPosition().y;
+
+    bool changed = !m_SkyViewValid
+        || glm::dot(sunDirection, m_SkyViewSunDirection) < SKY_VIEW_DIRECTION_THRESHOLD
+        || std::abs(altitude - m_SkyViewAltitude) > SKY_VIEW_ALTITUDE_THRESHOLD;
+    if (!changed) return;
+
+    m_SkyViewSunDirection = sunDirection;
+    m_SkyViewAltitude = altitude;
+    m_SkyViewValid = true;
+    m_SkyViewUpdateCount++;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_SkyViewFBO);
+    glViewport(0, 0, SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+
+    m_SkyViewShader->Bind();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_TransmittanceLUT);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_MultiScatteringLUT);
+
+    m_GBuffer.quad.Draw();
+}
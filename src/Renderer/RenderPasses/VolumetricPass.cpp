@@ -0,0 +1,79 @@
+#include "../Renderer.h"
+
+// (re)creates the ping-pong history for the reduced resolution modes, called on resize and
+// whenever the render graph is rebuilt. frees it again in the other modes
+void Renderer::CreateVolumetricTargets()
+{
+    int scale = m_VolumetricMode == VolumetricMode::QuarterResolution ? 4 : 2;
+    bool reduced = m_VolumetricMode == VolumetricMode::HalfResolution || m_VolumetricMode == VolumetricMode::QuarterResolution;
+    uint width = reduced ? (m_Width + scale - 1) / scale : 0;
+    uint height = reduced ? (m_Height + scale - 1) / scale : 0;
+
+    if (width == m_VolumetricWidth && height == m_VolumetricHeight) return;
+
+    if (m_VolumetricHistory[0])
+    {
+        glDeleteTextures(2, m_VolumetricHistory);
+        glDeleteTextures(2, m_VolumetricHistoryTransmittance);
+        m_VolumetricHistory[0] = m_VolumetricHistory[1] = 0;
+        m_VolumetricHistoryTransmittance[0] = m_VolumetricHistoryTransmittance[1] = 0;
+    }
+
+    m_VolumetricWidth = width;
+    m_VolumetricHeight = height;
+    m_VolumetricHistoryValid = false;
+    if (!reduced) return;
+
+    glGenTextures(2, m_VolumetricHistory);
+    glGenTextures(2, m_VolumetricHistoryTransmittance);
+    for (int i = 0; i < 2; ++i)
+    {
+        for (uint texture : { m_VolumetricHistory[i], m_VolumetricHistoryTransmittance[i] })
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, 1, texture == m_VolumetricHistory[i] ? GL_RGBA16F : GL_R11F_G11F_B10F, width, height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+}
+
+void Renderer::VolumetricPass()
+{
+    const Camera* camera = m_Scene->activeCamera;
+    glm::mat4 viewProj = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+
+    uint previous = m_VolumetricHistoryIndex;
+    m_VolumetricHistoryIndex ^= 1;
+
+    m_VolumetricShader->Bind();
+    m_VolumetricShader->Set(m_VolumetricScale, m_VolumetricMode == VolumetricMode::QuarterResolution ? 4 : 2);
+    m_VolumetricShader->Set(m_VolumetricFrame, m_VolumetricFrameIndex++);
+    m_VolumetricShader->Set(m_VolumetricUseHistory, m_VolumetricHistoryValid ? 1 : 0);
+    m_VolumetricShader->Set(m_VolumetricPrevViewProj, m_PrevViewProj);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_RenderGraph.GetTexture(m_GBuffer.Depth));
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_TransmittanceLUT);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_MultiScatteringLUT);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_ShadowMapTexture);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, m_BlueNoise);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, m_VolumetricHistory[previous]);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, m_VolumetricHistoryTransmittance[previous]);
+
+    glBindImageTexture(0, m_VolumetricHistory[m_VolumetricHistoryIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(1, m_VolumetricHistoryTransmittance[m_VolumetricHistoryIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R11F_G11F_B10F);
+    glDispatchCompute((m_VolumetricWidth + 7) / 8, (m_VolumetricHeight + 7) / 8, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    m_PrevViewProj = viewProj;
+    m_VolumetricHistoryValid = true;
+}
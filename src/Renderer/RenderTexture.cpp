@@ -1,10 +1,11 @@
 #include "RenderTexture.h"
+#include <algorithm>
 #include <iostream>
 
-RenderTexture::RenderTexture(const Texture& texture)
-    : m_Width(texture.GetWidth()), m_Height(texture.GetHeight())
+RenderTexture::RenderTexture(const Texture& texture, bool stream)
+    : m_Width(texture.GetWidth()), m_Height(texture.GetHeight()), m_Channels(texture.GetChannels())
 {
-    CreateTexture(texture);
+    CreateTexture(texture, stream);
 }
 
 RenderTexture::~RenderTexture()
@@ -12,40 +13,108 @@ RenderTexture::~RenderTexture()
     glDeleteTextures(1, &m_RendererID);
 }
 
-void RenderTexture::CreateTexture(const Texture& texture)
+void RenderTexture::CreateTexture(const Texture& texture, bool stream)
 {
+    m_Source = &texture;
+    m_LevelCount = GetMipLevelCount(m_Width, m_Height);
+
     glGenTextures(1, &m_RendererID);
     glBindTexture(GL_TEXTURE_2D, m_RendererID);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -0.6f);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, -0.6f);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
     GLenum internalFormat = GL_RGBA8;
-    GLenum dataFormat = GL_RGBA;
+    m_DataFormat = GL_RGBA;
 
-    if (texture.GetChannels() == 1)
+    if (m_Channels == 1)
     {
         internalFormat = GL_R8;
-        dataFormat     = GL_RED;
+        m_DataFormat   = GL_RED;
     }
-    else if (texture.GetChannels() == 3)
+    else if (m_Channels == 2)
     {
-        internalFormat = GL_RGB8;
-        dataFormat     = GL_RGB;
+        internalFormat = GL_RG8;
+        m_DataFormat   = GL_RG;
     }
-    else if (texture.GetChannels() == 4)
+    else if (m_Channels == 3)
     {
-        internalFormat = GL_RGBA8;
-        dataFormat     = GL_RGBA;
+        internalFormat = GL_RGB8;
+        m_DataFormat   = GL_RGB;
     }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_Width, m_Height, 0, dataFormat, GL_UNSIGNED_BYTE, texture.GetData());
-    
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // storage for every level up front, residency is only a matter of what has been uploaded
+    glTexStorage2D(GL_TEXTURE_2D, m_LevelCount, internalFormat, m_Width, m_Height);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    // nothing to upload, the contents stay undefined like glTexImage2D with no data
+    if (!texture.GetData())
+    {
+        ResetRequest();
+        return;
+    }
+
+    // textures made outside the asset load (fallbacks, tools) get a plain box filter here
+    if (!texture.HasMips()) m_FallbackMips = BuildMipChain(texture.GetData(), m_Width, m_Height, m_Channels, MipSettings());
+
+    int tail = 0;
+    while (std::max(GetMipLevelSize(m_Width, tail), GetMipLevelSize(m_Height, tail)) > RENDER_TEXTURE_TAIL_SIZE) tail++;
+    if (!stream) tail = 0;
+
+    // every level explicitly, nothing is left to glGenerateMipmap
+    for (int level = tail; level < m_LevelCount; ++level)
+        UploadRows(level, 0, GetMipLevelSize(m_Height, level), GetLevelData(level));
+    SetResidentLevel(tail);
+
+    ResetRequest();
+}
+
+const uchar* RenderTexture::GetLevelData(int level) const
+{
+    if (level == 0 || m_FallbackMips.empty()) return m_Source->GetLevelData(level);
+    return m_FallbackMips.data() + GetMipLevelOffset(m_Width, m_Height, m_Channels, level);
+}
+
+size_t RenderTexture::StreamLevel(size_t budget)
+{
+    if (m_RequestedLevel >= m_ResidentLevel) return 0;
+
+    const int level = m_ResidentLevel - 1;
+    const int height = GetMipLevelSize(m_Height, level);
+    const size_t rowBytes = (size_t)GetMipLevelSize(m_Width, level) * m_Channels;
+    const int rows = (int)std::clamp<size_t>(budget / rowBytes, 1, (size_t)(height - m_UploadedRows));
+
+    UploadRows(level, m_UploadedRows, rows, GetLevelData(level) + m_UploadedRows * rowBytes);
+    m_UploadedRows += rows;
+
+    if (m_UploadedRows == height)
+    {
+        m_UploadedRows = 0;
+        SetResidentLevel(level);
+    }
+    return rows * rowBytes;
+}
+
+size_t RenderTexture::GetLevelBytes(int level) const
+{
+    return GetMipLevelBytes(m_Width, m_Height, m_Channels, level);
+}
+
+// direct state access, streaming happens between passes and mustn't disturb their bindings
+void RenderTexture::UploadRows(int level, int firstRow, int rowCount, const uchar* data)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTextureSubImage2D(m_RendererID, level, 0, firstRow, GetMipLevelSize(m_Width, level), rowCount, m_DataFormat, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void RenderTexture::SetResidentLevel(int level)
+{
+    m_ResidentLevel = level;
+    glTextureParameteri(m_RendererID, GL_TEXTURE_BASE_LEVEL, level);
 }
 
 void RenderTexture::Bind(uint slot) const
@@ -57,4 +126,4 @@ void RenderTexture::Bind(uint slot) const
 void RenderTexture::Unbind() const
 {
     glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+}
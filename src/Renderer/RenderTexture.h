@@ -2,21 +2,35 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "Types.h"
 #include "Resources/Material.h"
 
+// levels whose largest side is at most this go up in the constructor, a new material is usable
+// the same frame
+constexpr int RENDER_TEXTURE_TAIL_SIZE = 64;
+
+// a material texture with storage for the whole mip chain that is filled a level at a time.
+// GL_TEXTURE_BASE_LEVEL points at the largest level uploaded so far, nothing above it is ever
+// sampled. the levels come from the Texture's chain built at load (a box filtered one is built
+// here for textures without), the constructor uploads the tail and TextureStreamer the rest as
+// draws ask for it. stream = false uploads every level right away
 class RenderTexture
 {
 
 public:
     RenderTexture() = default;
-    
-    RenderTexture(const Texture& texture);
-    
+
+    RenderTexture(const Texture& texture, bool stream = false);
+
     ~RenderTexture();
 
+    RenderTexture(const RenderTexture&) = delete;
+    RenderTexture& operator=(const RenderTexture&) = delete;
+
     void Bind(uint slot = 0) const;
     void Unbind() const;
 
@@ -24,10 +38,38 @@ public:
     inline int GetHeight() const { return m_Height; }
     inline uint GetID() const { return m_RendererID; }
 
+    int GetLevelCount() const { return m_LevelCount; }
+    // largest level that can be sampled, 0 once fully resident
+    int GetResidentLevel() const { return m_ResidentLevel; }
+    // largest level a draw asked for this frame, GetLevelCount() if none did
+    int GetRequestedLevel() const { return m_RequestedLevel; }
+
+    // called per draw, keeps the largest level
+    void Request(int level) { m_RequestedLevel = std::min(m_RequestedLevel, std::max(level, 0)); }
+    void ResetRequest() { m_RequestedLevel = m_LevelCount; }
+
+    // uploads rows of the next level towards the request, at most budget bytes (but at least a row).
+    // returns the bytes uploaded
+    size_t StreamLevel(size_t budget);
+    size_t GetLevelBytes(int level) const;
+
 private:
     uint m_RendererID = 0;
-    int m_Width = 0, m_Height = 0;
-    
-    void CreateTexture(const Texture& texture);
+    int m_Width = 0, m_Height = 0, m_Channels = 0;
+    GLenum m_DataFormat = GL_RGBA;
+
+    int m_LevelCount = 1;
+    int m_ResidentLevel = 0;
+    int m_RequestedLevel = 0;
+    int m_UploadedRows = 0;    // of level m_ResidentLevel - 1
+
+    // the levels stay with the Texture (owned by the material)
+    const Texture* m_Source = nullptr;
+    std::vector<uchar> m_FallbackMips;
+
+    void CreateTexture(const Texture& texture, bool stream);
+    const uchar* GetLevelData(int level) const;
+    void UploadRows(int level, int firstRow, int rowCount, const uchar* data);
+    void SetResidentLevel(int level);
 
-};
\ No newline at end of file
+};
@@ -1,7 +1,11 @@
 #include "Renderer.h"
+#include "BlueNoise.h"
+#include "ShaderCache.h"
+#include "Core/AllocationCounter.h"
 #include <iostream>
 #include <random>
 #include <algorithm>
+#include <limits>
 
 GLenum glCheckError_(const char *file, int line)
 {
@@ -31,24 +35,59 @@ void Renderer::Init(int width, int height)
     m_Height = height;
 
     m_Exposure = 1.0;
-    m_ForwardShader = new Shader("assets/shaders/forward.vert", "assets/shaders/forward.frag");
-
-    m_GBufferShader = new Shader("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag");
-    m_LightingShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/lighting.frag");
-    m_SSAOShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/ssao.frag");
-    m_SSAOBlurShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/ssaoblur.frag");
-    m_SkyboxShader = new Shader("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
-
-    m_EquirectangularToCubemapShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/equirectangular_to_cubemap.frag");
-    m_IrradianceShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/irradiance_convolution.frag");
-    m_PrefilterShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/prefilter.frag");
-    m_BrdfShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/brdf.frag");
+
+    // grid sizes the shaders share with UniformBlocks.h, they're injected instead of kept in sync by hand
+    Shader::SetGlobalDefines({
+        { "MAX_CASCADES", std::to_string(MAX_CASCADES) },
+        { "CLUSTER_X", std::to_string(CLUSTER_X) },
+        { "CLUSTER_Y", std::to_string(CLUSTER_Y) },
+        { "CLUSTER_Z", std::to_string(CLUSTER_Z) },
+        { "FROXEL_X", std::to_string(FROXEL_X) },
+        { "FROXEL_Y", std::to_string(FROXEL_Y) },
+        { "FROXEL_Z", std::to_string(FROXEL_Z) },
+        { "SKY_VIEW_LUT_WIDTH", std::to_string(SKY_VIEW_LUT_WIDTH) },
+        { "SKY_VIEW_LUT_HEIGHT", std::to_string(SKY_VIEW_LUT_HEIGHT) },
+    });
+
+    // everything is compiled at once, the programs are only checked in Finish
+    ShaderBatch shaders;
+    m_ForwardShader = new Shader("assets/shaders/forward.vert", "assets/shaders/forward.frag", &shaders);
+
+    m_GBufferShader = new Shader("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag", &shaders);
+    m_LightingShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/lighting.frag", &shaders);
+    m_SSAOShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/ssao.frag", &shaders);
+    m_SSAOBlurShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/ssaoblur.frag", &shaders);
+    m_SSAODownsampleShader = new Shader("assets/shaders/ssao_downsample.comp", &shaders);
+    m_SSAOComputeShader = new Shader("assets/shaders/ssao_compute.comp", &shaders);
+    m_SSAOBlurComputeShader = new Shader("assets/shaders/ssao_blur.comp", &shaders);
+    m_SSAOUpsampleShader = new Shader("assets/shaders/ssao_upsample.comp", &shaders);
+    m_SkyboxShader = new Shader("assets/shaders/skybox.vert", "assets/shaders/skybox.frag", &shaders);
+
+    m_EquirectangularToCubemapShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/equirectangular_to_cubemap.frag", &shaders);
+    m_IrradianceShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/irradiance_convolution.frag", &shaders);
+    m_PrefilterShader = new Shader("assets/shaders/cubemap.vert", "assets/shaders/prefilter.frag", &shaders);
+    m_BrdfShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/brdf.frag", &shaders);
     
     // m_AtmosphereShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/volumetric.frag");
-    m_AtmosphereShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/atmosphere.frag");
-    m_TransmittanceShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/transmittance.frag");
-    m_MultiScatteringShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/multi_scattering.frag");
-    m_ShadowMapShader = new Shader("assets/shaders/shadow_map.vert", "assets/shaders/shadow_map.frag");
+    m_AtmosphereShaders = new ShaderPermutations("assets/shaders/fullscreen.vert", "assets/shaders/atmosphere.frag");
+    m_AtmosphereShader = m_AtmosphereShaders->Get({}, &shaders);
+    m_AtmosphereIBLShader = m_AtmosphereShaders->Get({ { "IBL_PASS", "1" } }, &shaders);
+    m_TransmittanceShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/transmittance.frag", &shaders);
+    m_MultiScatteringShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/multi_scattering.frag", &shaders);
+    m_SkyViewShader = new Shader("assets/shaders/fullscreen.vert", "assets/shaders/sky_view.frag", &shaders);
+    // the other local lights variant is compiled the first time the toggle flips
+    m_FroxelInjectShaders = new ShaderPermutations("assets/shaders/froxel_inject.comp");
+    m_FroxelInjectShaders->Get({ { "LOCAL_LIGHTS", m_FroxelLocalLights ? "1" : "0" } }, &shaders);
+    m_FroxelIntegrateShader = new Shader("assets/shaders/froxel_integrate.comp", &shaders);
+    m_VolumetricShader = new Shader("assets/shaders/volumetric_march.comp", &shaders);
+    m_ShadowMapShader = new Shader("assets/shaders/shadow_map.vert", "assets/shaders/shadow_map.frag", &shaders);
+
+    // ray start jitter for the reduced resolution volumetrics, cpu work that overlaps the compiles
+    constexpr uint blueNoiseSize = 64;
+    std::vector<uint8_t> blueNoise = BlueNoise::Generate(blueNoiseSize);
+
+    shaders.Finish();
+    ShaderCache::PrintStats();
 
     // glEnable(GL_BLEND);
     // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -60,102 +99,12 @@ void Renderer::Init(int width, int height)
 
     glViewport(0, 0, m_Width, m_Height);
 
-    // fbo
-    glGenFramebuffers(1, &m_GBuffer.FBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer.FBO);
-
-    // position rgb
-    glGenTextures(1, &m_GBuffer.Position);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Position);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_Width, m_Height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_GBuffer.Position, 0);
-
-    // normal rgb
-    glGenTextures(1, &m_GBuffer.Normal);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Normal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_Width, m_Height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_GBuffer.Normal, 0);
-
-    // albedo rgb
-    glGenTextures(1, &m_GBuffer.Albedo);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Albedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_GBuffer.Albedo, 0);
-
-    // ARM texture rgb
-    glGenTextures(1, &m_GBuffer.ARM);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.ARM);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, m_GBuffer.ARM, 0);
-
-    uint attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-    glDrawBuffers(4, attachments);
-
-    // depth
-    glGenTextures(1, &m_GBuffer.Depth);
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Depth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, m_Width, m_Height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_GBuffer.Depth, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        std::cout << "GBuffer framebuffer not complete!" << std::endl;
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
- 
-    // SSAO 
-    glGenFramebuffers(1, &m_SSAOFBO);
-    glGenFramebuffers(1, &m_SSAOBlurFBO);
-
-    // SSAO color buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, m_SSAOFBO);
-    
-    glGenTextures(1, &m_SSAOColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_SSAOColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_Width, m_Height, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_SSAOColorBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-    }
-
-    // SSAO blur buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, m_SSAOBlurFBO);
-    glGenTextures(1, &m_SSAOBlurBuffer);
-    glBindTexture(GL_TEXTURE_2D, m_SSAOBlurBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_Width, m_Height, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_SSAOBlurBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // screen sized targets are created by the render graph on the first frame
 
     // SSAO sample kernel
     std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
 
-    m_SSAOShader->Bind();
     for (uint i = 0; i < 64; ++i) 
     {
         glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
@@ -166,7 +115,17 @@ void Renderer::Init(int width, int height)
         scale = 0.1f + scale * (1.0f - 0.1f);
         sample *= scale;
         m_SSAOKernel.push_back(sample);
-        m_SSAOShader->SetUniform3f("samples[" + std::to_string(i) + "]", sample.x, sample.y, sample.z);
+    }
+
+    // glUniform writes to the bound program, each shader gets the kernel while it's bound
+    for (Shader* shader : { m_SSAOShader, m_SSAOComputeShader })
+    {
+        shader->Bind();
+        for (uint i = 0; i < m_SSAOKernel.size(); ++i)
+        {
+            const glm::vec3& sample = m_SSAOKernel[i];
+            shader->SetUniform3f("samples[" + std::to_string(i) + "]", sample.x, sample.y, sample.z);
+        }
     }
 
     // SSAO noise texture
@@ -187,24 +146,6 @@ void Renderer::Init(int width, int height)
 
     m_GBuffer.quad.Init();
 
-    glGenFramebuffers(1, &m_LightingFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_LightingFBO);
-
-    glGenTextures(1, &m_LightingResult);
-    glBindTexture(GL_TEXTURE_2D, m_LightingResult);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_LightingResult, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        std::cout << "Lighting Framebuffer not complete!" << std::endl;
-    }    
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
     /*
     // skybox
     float cubeVertices[] = {-0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.5f,  0.5f, -0.5f,  1.0f, 1.0f, -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.5f,  0.5f,  0.5f,  1.0f, 1.0f, -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.5f, -0.5f, -0.5f,  1.0f, 1.0f, 0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.5f, -0.5f,  0.5f,  1.0f, 0.0f, -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, -0.5f,  0.5f, -0.5f,  0.0f, 1.0f };
@@ -416,18 +357,22 @@ void Renderer::Init(int width, int height)
     
     */
 
-    glGenTextures(1, &m_SkyProbeMap);
+    // front probe is sampled by lighting, the back one is filled a face at a time and swapped in
     m_SkyCaptureSize = 128;
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_SkyProbeMap);
-    for (unsigned int i = 0; i < 6; ++i)
+    for (uint* probe : { &m_SkyProbeMap, &m_SkyProbeBackMap })
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, m_SkyCaptureSize, m_SkyCaptureSize, 0, GL_RGB, GL_FLOAT, nullptr);
+        glGenTextures(1, probe);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, *probe);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, m_SkyCaptureSize, m_SkyCaptureSize, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
     // Create FBO
     glGenFramebuffers(1, &m_SkyProbeFBO);
@@ -469,8 +414,59 @@ void Renderer::Init(int width, int height)
     glViewport(0, 0, 32, 32);
     m_MultiScatteringShader->Bind();
     m_GBuffer.quad.Draw();
+
+    // filled by SkyViewPass once the camera and sun are known
+    glGenTextures(1, &m_SkyViewLUT);
+    glBindTexture(GL_TEXTURE_2D, m_SkyViewLUT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenFramebuffers(1, &m_SkyViewFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_SkyViewFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_SkyViewLUT, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Sky View Framebuffer not complete!" << std::endl;
+
+    m_SkyViewShader->Bind();
+    m_SkyViewShader->SetUniform1i("uTransmittanceLUT", 0);
+    m_SkyViewShader->SetUniform1i("uMultiScatteringLUT", 1);
+
+    // fixed size, independent of the screen resolution
+    struct FroxelVolume { uint* Texture; GLenum Format; };
+    for (const FroxelVolume& volume : {
+        FroxelVolume{ &m_FroxelScattering, GL_RGBA16F },
+        FroxelVolume{ &m_FroxelExtinction, GL_R11F_G11F_B10F },
+        FroxelVolume{ &m_FroxelIntegratedScattering, GL_RGBA16F },
+        FroxelVolume{ &m_FroxelIntegratedTransmittance, GL_R11F_G11F_B10F } })
+    {
+        glGenTextures(1, volume.Texture);
+        glBindTexture(GL_TEXTURE_3D, *volume.Texture);
+        glTexStorage3D(GL_TEXTURE_3D, 1, volume.Format, FROXEL_X, FROXEL_Y, FROXEL_Z);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // blue noise generated while the shaders compiled, tiled over the screen
+    glGenTextures(1, &m_BlueNoise);
+    glBindTexture(GL_TEXTURE_2D, m_BlueNoise);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, blueNoiseSize, blueNoiseSize, 0, GL_RED, GL_UNSIGNED_BYTE, blueNoise.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     
     ShadowMapInit();
+    m_ShadowAtlas.Init(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE);
+    CreateOutputTarget();
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glViewport(0, 0, m_Width, m_Height);
@@ -484,11 +480,14 @@ void Renderer::Init(int width, int height)
     m_LightingShader->SetUniform1i("uShadowMap", 5);
     m_LightingShader->SetUniform1i("uTransmittanceLUT", 6);
     m_LightingShader->SetUniform1i("uSkyProbe", 7);
+    m_LightingShader->SetUniform1i("gDepth", 8);
+    m_LightingShader->SetUniform1i("uShadowAtlas", 9);
 
     m_SSAOShader->Bind();
     m_SSAOShader->SetUniform1i("gPosition", 0);
     m_SSAOShader->SetUniform1i("gNormal", 1);
     m_SSAOShader->SetUniform1i("gNoiseTexture", 2);
+    m_SSAOShader->SetUniform1i("gDepth", 3);
 
     m_SSAOBlurShader->Bind();
     m_SSAOBlurShader->SetUniform1i("gSSAOInput", 0);
@@ -503,12 +502,85 @@ void Renderer::Init(int width, int height)
     m_ForwardShader->SetUniform1i("uNormal", 1);
     m_ForwardShader->SetUniform1i("uARM", 2);
 
-    m_AtmosphereShader->Bind();
-    m_AtmosphereShader->SetUniform1i("gDepth", 0);
-    m_AtmosphereShader->SetUniform1i("uTransmittanceLUT", 1);
-    m_AtmosphereShader->SetUniform1i("uMultiScatteringLUT", 2);
-    m_AtmosphereShader->SetUniform1i("uShadowMap", 3);
-    m_AtmosphereShader->SetUniform1i("gScene", 4);
+
+    InitUniformHandles();
+    SetGBufferLayout(m_GBufferLayout);
+
+    m_FrameUBO = new StreamBuffer(GL_UNIFORM_BUFFER, FrameBlockBinding, sizeof(FrameBlock));
+    m_CascadeUBO = new StreamBuffer(GL_UNIFORM_BUFFER, CascadeBlockBinding, sizeof(CascadeBlock));
+
+    m_PointLightSSBO = new StreamBuffer(GL_SHADER_STORAGE_BUFFER, PointLightBufferBinding, MAX_CLUSTERED_POINT_LIGHTS * sizeof(PointLightData));
+    m_SpotLightSSBO = new StreamBuffer(GL_SHADER_STORAGE_BUFFER, SpotLightBufferBinding, MAX_CLUSTERED_SPOT_LIGHTS * sizeof(SpotLightData));
+    m_ClusterSSBO = new StreamBuffer(GL_SHADER_STORAGE_BUFFER, ClusterBufferBinding, CLUSTER_COUNT * sizeof(ClusterData));
+    m_LightIndexSSBO = new StreamBuffer(GL_SHADER_STORAGE_BUFFER, LightIndexBufferBinding, MAX_CLUSTER_LIGHT_INDICES * sizeof(uint));
+    m_LocalShadowSSBO = new StreamBuffer(GL_SHADER_STORAGE_BUFFER, LocalShadowBufferBinding, MAX_LOCAL_SHADOW_TILES * sizeof(LocalShadowData));
+}
+
+void Renderer::UploadFrameUniforms()
+{
+    const Camera* camera = m_Scene->activeCamera;
+
+    FrameBlock* frame = static_cast<FrameBlock*>(m_FrameUBO->Map());
+    if (!frame) return;
+
+    frame->View = camera->GetViewMatrix();
+    frame->Projection = camera->GetProjectionMatrix();
+    frame->InvView = glm::inverse(frame->View);
+    frame->InvProjection = glm::inverse(frame->Projection);
+    frame->ViewProj = frame->Projection * frame->View;
+    frame->InvViewProj = glm::inverse(frame->ViewProj);
+    frame->CameraPosition = glm::vec4(camera->GetPosition(), 1.0f);
+    frame->SunDirection = glm::vec4(m_Scene->m_Sun.Direction, 0.0f);
+    frame->SunColor = glm::vec4(m_Scene->m_Sun.Color, m_Scene->m_Sun.Intensity);
+    frame->ScreenSize = glm::vec4(m_Width, m_Height, 1.0f / m_Width, 1.0f / m_Height);
+    frame->Params = glm::vec4(m_Exposure, camera->GetNear(), camera->GetFar(), 0.0f);
+
+    m_FrameUBO->Bind(sizeof(FrameBlock));
+}
+
+void Renderer::UploadCascadeUniforms()
+{
+    CascadeBlock* cascades = static_cast<CascadeBlock*>(m_CascadeUBO->Map());
+    if (!cascades) return;
+
+    int count = std::min((int)m_ShadowCascadeMatrices.size(), MAX_CASCADES);
+    for (int i = 0; i < count; ++i)
+    {
+        cascades->Matrices[i] = m_ShadowCascadeMatrices[i];
+        cascades->PlaneDistances[i] = glm::vec4(m_ShadowCascadeLevels[i + 1]);
+    }
+    cascades->Count = count;
+
+    m_CascadeUBO->Bind(sizeof(CascadeBlock));
+}
+
+void Renderer::InitUniformHandles()
+{
+    m_GBufferUniforms.Model = m_GBufferShader->GetUniform<glm::mat4>("uModel");
+
+    m_GBufferPacked     = m_GBufferShader->GetUniform<int>("uPackedGBuffer", true);
+    m_LightingPacked    = m_LightingShader->GetUniform<int>("uPackedGBuffer", true);
+    m_SSAOPacked        = m_SSAOShader->GetUniform<int>("uPackedGBuffer", true);
+    m_SSAOComputePacked = m_SSAOComputeShader->GetUniform<int>("uPackedGBuffer", true);
+
+    m_ForwardUniforms.Model   = m_ForwardShader->GetUniform<glm::mat4>("uModel");
+    m_ForwardUniforms.Opacity = m_ForwardShader->GetUniform<float>("uOpacity");
+
+    m_ShadowMapUniforms.LightProj = m_ShadowMapShader->GetUniform<glm::mat4>("uLightProj");
+    m_ShadowMapUniforms.Model     = m_ShadowMapShader->GetUniform<glm::mat4>("uModel");
+
+    m_SSAODownsampleScale = m_SSAODownsampleShader->GetUniform<int>("uScale");
+    m_SSAOComputeSampleCount = m_SSAOComputeShader->GetUniform<int>("uSampleCount");
+    m_FroxelFogDensity = m_FroxelInjectShaders->GetUniform<float>("uFogDensity");
+    m_VolumetricScale = m_VolumetricShader->GetUniform<int>("uScale");
+    m_VolumetricFrame = m_VolumetricShader->GetUniform<int>("uFrameIndex");
+    m_VolumetricUseHistory = m_VolumetricShader->GetUniform<int>("uHistoryValid");
+    m_VolumetricPrevViewProj = m_VolumetricShader->GetUniform<glm::mat4>("uPrevViewProj");
+
+    m_LightingDebugClusters = m_LightingShader->GetUniform<int>("uDebugClusters", true);
+
+    m_AtmosphereUniforms.VolumetricMode     = m_AtmosphereShaders->GetUniform<int>("uVolumetricMode");
+    m_AtmosphereUniforms.CaptureInvViewProj = m_AtmosphereShaders->GetUniform<glm::mat4>("uCaptureInvViewProj");
 }
 
 void Renderer::Shutdown() { }
@@ -538,20 +610,74 @@ void Renderer::OnImGuiRender()
 
     if (ImGui::CollapsingHeader("GBuffers"))
     {
-        DebugTextureItem("Position", m_GBuffer.Position);
-        DebugTextureItem("Normal", m_GBuffer.Normal);
-        DebugTextureItem("Albedo", m_GBuffer.Albedo);
-        DebugTextureItem("ARM", m_GBuffer.ARM);
-        DebugTextureItem("Depth", m_GBuffer.Depth);
-        DebugTextureItem("Lighting", m_LightingResult);
+        const char* layouts[] = { "Full (position + rgba16f normal)", "Slim (depth + octahedral normal)" };
+        int layout = (int)m_GBufferLayout;
+        if (ImGui::Combo("Layout", &layout, layouts, 2)) SetGBufferLayout((GBufferLayout)layout);
+
+        uint bytesPerPixel = GetGBufferBytesPerPixel();
+        ImGui::Text("%u bytes/pixel, %.1f MB at %ux%u", bytesPerPixel, (double)bytesPerPixel * m_Width * m_Height / (1024.0 * 1024.0), m_Width, m_Height);
+
+        auto& timers = RenderProfiler::GetTimerMap();
+        auto geometry = timers.find("Geometry");
+        auto lighting = timers.find("Lighting");
+        if (geometry != timers.end() && lighting != timers.end())
+        {
+            ImGui::Text("Geometry %.3f ms, Lighting %.3f ms", geometry->second.TimeMs, lighting->second.TimeMs);
+        }
+
+        if (m_GBuffer.Position.IsValid()) DebugTextureItem("Position", m_RenderGraph.GetTexture(m_GBuffer.Position));
+        DebugTextureItem("Normal", m_RenderGraph.GetTexture(m_GBuffer.Normal));
+        DebugTextureItem("Albedo", m_RenderGraph.GetTexture(m_GBuffer.Albedo));
+        DebugTextureItem("ARM", m_RenderGraph.GetTexture(m_GBuffer.ARM));
+        DebugTextureItem("Depth", m_RenderGraph.GetTexture(m_GBuffer.Depth));
+        DebugTextureItem("Lighting", m_RenderGraph.GetTexture(m_LightingResult));
     }
     
     ImGui::NewLine(); 
 
     if (ImGui::CollapsingHeader("Lighting"))
     {
-        DebugTextureItem("SSAO Raw", m_SSAOColorBuffer);
-        DebugTextureItem("SSAO Blur", m_SSAOBlurBuffer);
+        const char* ssaoModes[] = { "Full resolution (fragment)", "Half resolution (compute)", "Quarter resolution (compute)" };
+        int ssaoMode = (int)m_SSAOMode;
+        if (ImGui::Combo("SSAO", &ssaoMode, ssaoModes, 3))
+        {
+            m_SSAOMode = (SSAOMode)ssaoMode;
+            m_RenderGraphDirty = true;
+        }
+        if (m_SSAOMode != SSAOMode::FullResolution) ImGui::SliderInt("AO samples", &m_SSAOComputeSamples, 4, 64);
+
+        // timers of inactive modes keep their last value, switch modes to fill in the table
+        if (ImGui::BeginTable("SSAO timings", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Path");
+            ImGui::TableSetupColumn("GPU ms");
+            ImGui::TableHeadersRow();
+
+            const char* scopes[] = { "SSAO", "SSAO Blur", "SSAO Half", "SSAO Quarter" };
+            auto& timers = RenderProfiler::GetTimerMap();
+            for (const char* scope : scopes)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", scope);
+                ImGui::TableNextColumn();
+                auto it = timers.find(scope);
+                if (it != timers.end()) ImGui::Text("%.3f", it->second.TimeMs);
+                else ImGui::TextDisabled("-");
+            }
+            ImGui::EndTable();
+        }
+
+        if (m_SSAOMode == SSAOMode::FullResolution)
+        {
+            DebugTextureItem("SSAO Raw", m_RenderGraph.GetTexture(m_SSAORaw));
+        }
+        else
+        {
+            DebugTextureItem("SSAO Low Res", m_RenderGraph.GetTexture(m_SSAOLowBlur));
+        }
+        ImGui::SameLine();
+        DebugTextureItem("SSAO Final", m_RenderGraph.GetTexture(m_SSAOResult));
         // DebugTextureItem("BRDF LUT", m_BRDFLUTTexture, 128,128);
 
         ImGui::NewLine();
@@ -565,6 +691,32 @@ void Renderer::OnImGuiRender()
             }
             ImGui::NewLine();
             ImGui::Text("%d cascades", m_ShadowCascadeLevels.size());
+            ImGui::Checkbox("Cache static casters", &m_ShadowCaching);
+            if (ImGui::BeginTable("Cascade updates", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+            {
+                ImGui::TableSetupColumn("Cascade");
+                ImGui::TableSetupColumn("Updated this frame");
+                ImGui::TableSetupColumn("Static layer");
+                ImGui::TableSetupColumn("Updates");
+                ImGui::TableSetupColumn("Static redraws");
+                ImGui::TableHeadersRow();
+                for (uint i = 0; i < m_ShadowCascadeCache.size(); ++i)
+                {
+                    const ShadowCascadeCache& cache = m_ShadowCascadeCache[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", i);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", cache.Updated ? "yes" : "-");
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", cache.StaticValid ? "cached" : "invalid");
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", cache.UpdateCount);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", cache.StaticUpdateCount);
+                }
+                ImGui::EndTable();
+            }
             ImGui::DragFloat("First cascade dist", &m_ShadowCascadeLevelOne, 1.0, 0.0f, m_ShadowCascadeLevelTwo);
             ImGui::DragFloat("Second cascade dist", &m_ShadowCascadeLevelTwo, 1.0, m_ShadowCascadeLevelOne, m_ShadowCascadeLevelThree);
             ImGui::DragFloat("Third cascade dist", &m_ShadowCascadeLevelThree, 1.0, m_ShadowCascadeLevelTwo, m_ShadowCascadeLevelFour);
@@ -573,6 +725,90 @@ void Renderer::OnImGuiRender()
         }
         ImGui::NewLine();
         DebugTextureItem("Transmittance LUT", m_TransmittanceLUT, 256, 64);
+        ImGui::SameLine();
+        DebugTextureItem("Sky View LUT", m_SkyViewLUT, SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT);
+        ImGui::Text("Sky view LUT updates: %u", m_SkyViewUpdateCount);
+        if (ImGui::TreeNode("Volumetrics"))
+        {
+            const char* volumetricModes[] = { "Froxel volume", "Full resolution raymarch", "Half resolution raymarch", "Quarter resolution raymarch" };
+            int volumetricMode = (int)m_VolumetricMode;
+            if (ImGui::Combo("Mode", &volumetricMode, volumetricModes, 4))
+            {
+                m_VolumetricMode = (VolumetricMode)volumetricMode;
+                m_RenderGraphDirty = true;
+            }
+
+            // timers of inactive modes keep their last value, the full resolution raymarch is part of Atmosphere
+            if (ImGui::BeginTable("Volumetric timings", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+            {
+                ImGui::TableSetupColumn("Pass");
+                ImGui::TableSetupColumn("GPU ms");
+                ImGui::TableHeadersRow();
+
+                const char* scopes[] = { "Froxels", "Volumetrics Half", "Volumetrics Quarter", "Atmosphere" };
+                auto& timers = RenderProfiler::GetTimerMap();
+                for (const char* scope : scopes)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", scope);
+                    ImGui::TableNextColumn();
+                    auto it = timers.find(scope);
+                    if (it != timers.end()) ImGui::Text("%.3f", it->second.TimeMs);
+                    else ImGui::TextDisabled("-");
+                }
+                ImGui::EndTable();
+            }
+
+            if (ImGui::Button("Compare with full resolution")) m_VolumetricCompareRequested = true;
+            if (m_VolumetricDiffTexture)
+            {
+                ImGui::Text("PSNR %.2f dB, mean error %.3f, max error %u", m_VolumetricDiff.PSNR, m_VolumetricDiff.MeanError, m_VolumetricDiff.MaxError);
+                DebugTextureItem("Difference (x8)", m_VolumetricDiffTexture, 256, 144);
+                ImGui::NewLine();
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Froxel Volume"))
+        {
+            ImGui::Text("%dx%dx%d froxels, %.1f MB", FROXEL_X, FROXEL_Y, FROXEL_Z, FROXEL_X * FROXEL_Y * FROXEL_Z * 24 / (1024.0f * 1024.0f));
+            ImGui::Checkbox("Local lights", &m_FroxelLocalLights);
+            ImGui::DragFloat("Fog density (1/km)", &m_FogDensity, 0.01f, 0.0f, 10.0f);
+            ImGui::TreePop();
+        }
+        ImGui::NewLine();
+        if (ImGui::TreeNode("Clustered Lights"))
+        {
+            const LightCullingStats& stats = m_LightCullingStats;
+            ImGui::Text("Grid: %dx%dx%d (%d clusters)", CLUSTER_X, CLUSTER_Y, CLUSTER_Z, CLUSTER_COUNT);
+            ImGui::Text("Visible: %u point, %u spot", stats.VisiblePointLights, stats.VisibleSpotLights);
+            ImGui::Text("Light indices: %u (max %u in one cluster)", stats.IndexCount, stats.MaxLightsPerCluster);
+            ImGui::Text("CPU assignment: %.3f ms", stats.CpuMs);
+            if (stats.Overflow) ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Light index buffer full, clusters truncated");
+            if (ImGui::Checkbox("Show light count heatmap", &m_ShowClusterHeatmap))
+            {
+                m_LightingShader->Set(m_LightingDebugClusters, m_ShowClusterHeatmap ? 1 : 0);
+            }
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Local Shadows"))
+        {
+            const LocalShadowStats& stats = m_LocalShadowStats;
+            ImGui::Text("Atlas: %dx%d, tiles %d to %d", SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE, SHADOW_ATLAS_SIZE);
+            ImGui::Text("Occupancy: %.1f%% (%u tiles, %u lights)", stats.Occupancy * 100.0f, stats.AllocatedTiles, stats.ShadowedLights);
+            ImGui::Text("Tiles rendered: %u this frame, %u pending, %llu total", stats.TilesUpdated, stats.PendingTiles, (unsigned long long)stats.TotalTileUpdates);
+            if (stats.FailedAllocations) ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%u failed allocations, atlas full", stats.FailedAllocations);
+            ImGui::SliderInt("Tile budget per frame", &m_ShadowTileBudget, 1, 64);
+            ImGui::TreePop();
+        }
+        if (ImGui::TreeNode("Sky Probe"))
+        {
+            if (m_SkyProbeFace >= 0) ImGui::Text("Capturing face %d/6", m_SkyProbeFace + 1);
+            else                     ImGui::Text("Up to date");
+            ImGui::Text("Refreshes: %u", m_SkyProbeRefreshCount);
+            if (ImGui::Button("Refresh now")) m_SkyProbeForceRefresh = true;
+            ImGui::TreePop();
+        }
         ImGui::NewLine();
         ImGui::DragFloat("Exposure", &m_Exposure, 0.05, 0.0, 3.0);
     }
@@ -581,19 +817,38 @@ void Renderer::OnImGuiRender()
 
     if (ImGui::CollapsingHeader("Material Cache (Uploaded)"))
     {
+        if (m_TextureStreamer.IsEnabled())
+        {
+            int budgetMB = (int)(m_TextureStreamer.GetBudget() / (1024 * 1024));
+            if (ImGui::SliderInt("Upload budget (MB/frame)", &budgetMB, 1, 64)) m_TextureStreamer.SetBudget((size_t)budgetMB * 1024 * 1024);
+            ImGui::Text("Uploaded this frame: %.2f MB", m_TextureStreamer.GetUploadedBytes() / (1024.0f * 1024.0f));
+        }
+        else
+        {
+            ImGui::TextDisabled("Streaming off, textures are uploaded whole");
+        }
+
+        // resident = largest level that can be sampled, wanted = what the draws asked for this frame
         int count = 0;
-        for (const auto& [cpuTex, gpuTex] : m_TextureCache)
+        for (const auto& [cpuTex, gpuTex] : m_TextureStreamer.GetTextures())
         {
             uint32_t id = gpuTex->GetID(); 
-            std::string label = "Tex " + std::to_string(count++);
+            int requested = gpuTex->GetRequestedLevel();
+            std::string label = "Tex " + std::to_string(count++) + " mip " + std::to_string(gpuTex->GetResidentLevel()) +
+                (requested < gpuTex->GetLevelCount() ? "/" + std::to_string(requested) : "/-");
             
             DebugTextureItem(label.c_str(), id, 128,128);
         }
         
-        if (m_TextureCache.empty())
+        if (m_TextureStreamer.GetTextures().empty())
         {
             ImGui::Text("No materials uploaded to cache yet.");
         }
+        else
+        {
+            ImGui::NewLine();
+            ImGui::TextDisabled("mip resident/wanted");
+        }
     }
     
     ImGui::NewLine();
@@ -601,85 +856,328 @@ void Renderer::OnImGuiRender()
     std::string DrawCmdCount = "Opaque: " + std::to_string(m_DeferredQueue.size()) + " Transparent: " + std::to_string(m_ForwardQueue.size());
     ImGui::Text("%s",DrawCmdCount.c_str());
 
+    ImGui::NewLine();
+
+    if (ImGui::CollapsingHeader("Render Graph"))
+    {
+        m_RenderGraph.OnImGuiRender();
+    }
+
+    ImGui::NewLine();
+
+    if (ImGui::CollapsingHeader("Frame Capture"))
+    {
+        static int captureFrames = 300;
+        ImGui::SliderInt("Frames", &captureFrames, 1, 3600);
+        if (IsCapturing()) ImGui::Text("Capturing to %s, %d frames left", m_Capture.GetPath().c_str(), m_CaptureFramesLeft);
+        else if (ImGui::Button("Capture to echo_capture.ecap")) CaptureFrames("echo_capture.ecap", captureFrames);
+        ImGui::TextDisabled("replay with EchoReplay echo_capture.ecap");
+    }
+
+    ImGui::NewLine();
+
+    if (ImGui::CollapsingHeader("Frame Memory"))
+    {
+        ImGui::Text("Frame arena: %.1f / %.1f KB (peak %.1f KB)", m_FrameArena.GetUsed() / 1024.0f, m_FrameArena.GetCapacity() / 1024.0f, m_FrameArena.GetPeak() / 1024.0f);
+        if (m_FrameArena.GetOverflowCount() > 0) ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Arena overflowed %u times", m_FrameArena.GetOverflowCount());
+        if (m_FrameArena.GetGrowCount() > 0) ImGui::Text("Arena grown %u times", m_FrameArena.GetGrowCount());
+
+        if (AllocationCounter::IsEnabled())
+        {
+            ImGui::Text("Heap allocations in DrawScene: %zu (%zu bytes)", AllocationCounter::GetFrameAllocations(), AllocationCounter::GetFrameBytes());
+            ImGui::Text("Allocation free frames in a row: %zu", AllocationCounter::GetCleanFrameStreak());
+        }
+        else
+        {
+            ImGui::TextDisabled("Build with ECHO_TRACK_ALLOCATIONS to count heap allocations");
+        }
+    }
+
     ImGui::End();
 }
 
 void Renderer::BeginFrame()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer.FBO);
-	glViewport(0, 0, m_Width, m_Height);
-	glEnable(GL_DEPTH_TEST);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // the sky view LUT is only rebuilt when its inputs move, a new atmosphere shader is one
+    if (m_ShaderWatcher.Update() > 0) m_SkyViewValid = false;
 
     m_DeferredQueue.clear();
     m_ForwardQueue.clear();
+
+    m_FrameArena.Reset();
+    AllocationCounter::BeginFrame();
 }
 
-void Renderer::EndFrame() { }
+void Renderer::EndFrame()
+{
+    m_FrameUBO->EndFrame();
+    m_CascadeUBO->EndFrame();
+    m_PointLightSSBO->EndFrame();
+    m_SpotLightSSBO->EndFrame();
+    m_ClusterSSBO->EndFrame();
+    m_LightIndexSSBO->EndFrame();
+    m_LocalShadowSSBO->EndFrame();
+
+    RenderProfiler::EndFrame();
+    AllocationCounter::EndFrame();
+}
 
 void Renderer::DrawScene()
 {
+    PROFILE_FUNCTION();
 
-    for (Entity* e : m_Scene->m_Entities)
     {
-        SubmitDrawCmd(*e, *m_GBufferShader);
+        PROFILE_SCOPE("SubmitDrawCmds");
+        for (Entity* e : m_Scene->m_Entities)
+        {
+            SubmitDrawCmd(*e, *m_GBufferShader);
+        }
     }
-    
-    { ProfileScope p("Geometry"); GeometryPass(); }
-    { ProfileScope p("SSAO"); SSAOPass(); }
-    { ProfileScope p("SkyCap"); SkyCapture(); }
-    { ProfileScope p("ShadowMap"); ShadowMapPass(); }
-    { ProfileScope p("Lighting"); LightingPass(); }
-    { ProfileScope p("Atmosphere"); AtmospherePass(); }
-    { ProfileScope p("Forward"); ForwardPass(); }
+
+    RequestTextureLevels();
+    m_TextureStreamer.Update();
+
+    if (m_CaptureFramesLeft > 0)
+    {
+        m_Capture.WriteFrame(*m_Scene, GetSettings(), m_Width, m_Height, GetDrawCmdCount());
+        if (--m_CaptureFramesLeft == 0) m_Capture.Close();
+    }
+
+    UploadFrameUniforms();
+    LightCullingPass();
+
+    if (m_RenderGraphDirty) BuildRenderGraph();
+    m_RenderGraph.Execute();
 }
 
-void Renderer::Resize(int nWidth, int nHeight)
+// declares every pass with what it reads and writes, the graph works out order, lifetimes and targets.
+// each pass gets a GPU timer scope named after it
+void Renderer::BuildRenderGraph()
 {
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Position);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, nWidth, nHeight, 0, GL_RGB, GL_FLOAT, NULL);
+    PROFILE_FUNCTION();
+    m_RenderGraph.Reset();
+
+    const bool slim = m_GBufferLayout == GBufferLayout::Slim;
+    CreateVolumetricTargets();
+
+    // persistent resources owned by the renderer
+    RenderGraphResource backbuffer = m_RenderGraph.ImportTexture("Backbuffer", m_OutputColor);
+    RenderGraphResource shadowMap = m_RenderGraph.ImportTexture("Shadow Map", m_ShadowMapTexture);
+    RenderGraphResource shadowAtlas = m_RenderGraph.ImportTexture("Shadow Atlas", m_ShadowAtlas.GetTexture());
+    RenderGraphResource skyProbe = m_RenderGraph.ImportTexture("Sky Probe", m_SkyProbeMap);
+    RenderGraphResource transmittance = m_RenderGraph.ImportTexture("Transmittance LUT", m_TransmittanceLUT);
+    RenderGraphResource multiScattering = m_RenderGraph.ImportTexture("Multi Scattering LUT", m_MultiScatteringLUT);
+    RenderGraphResource skyView = m_RenderGraph.ImportTexture("Sky View LUT", m_SkyViewLUT);
+    RenderGraphResource froxels = m_RenderGraph.ImportTexture("Froxel Volume", m_FroxelIntegratedScattering);
+    RenderGraphResource volumetrics = m_RenderGraph.ImportTexture("Volumetric History", m_VolumetricHistory[0]);
+    m_RenderGraph.MarkOutput(backbuffer);
+
+    m_GBuffer.Position = slim ? RenderGraphResource() : m_RenderGraph.CreateTexture("GBuffer Position", { GL_RGBA16F });
+    m_GBuffer.Normal = m_RenderGraph.CreateTexture("GBuffer Normal", { slim ? (GLenum)GL_RG16 : (GLenum)GL_RGBA16F });
+    m_GBuffer.Albedo = m_RenderGraph.CreateTexture("GBuffer Albedo", { GL_RGBA8 });
+    m_GBuffer.ARM = m_RenderGraph.CreateTexture("GBuffer ARM", { GL_RGBA8 });
+    m_GBuffer.Depth = m_RenderGraph.CreateTexture("GBuffer Depth", { GL_DEPTH_COMPONENT24, 1.0f, GL_NEAREST, GL_CLAMP_TO_BORDER });
+    m_LightingResult = m_RenderGraph.CreateTexture("Lighting", { slim ? (GLenum)GL_R11F_G11F_B10F : (GLenum)GL_RGBA16F });
+
+    m_SSAORaw = m_RenderGraph.CreateTexture("SSAO Raw", { GL_R16F });
+    m_SSAOResult = m_RenderGraph.CreateTexture("SSAO", { GL_R16F });
+    float ssaoScale = m_SSAOMode == SSAOMode::QuarterResolution ? 0.25f : 0.5f;
+    m_SSAOLowDepth = m_RenderGraph.CreateTexture("SSAO Low Depth", { GL_R32F, ssaoScale });
+    m_SSAOLowRaw = m_RenderGraph.CreateTexture("SSAO Low Raw", { GL_R16F, ssaoScale });
+    m_SSAOLowBlur = m_RenderGraph.CreateTexture("SSAO Low Blur", { GL_R16F, ssaoScale });
+
+    m_RenderGraph.AddPass("Geometry", [&](RenderGraphBuilder& b) {
+        b.WriteColor(m_GBuffer.Position, 0);
+        b.WriteColor(m_GBuffer.Normal, 1);
+        b.WriteColor(m_GBuffer.Albedo, 2);
+        b.WriteColor(m_GBuffer.ARM, 3);
+        b.WriteDepth(m_GBuffer.Depth);
+    }, [this] { GeometryPass(); });
+
+    if (m_SSAOMode == SSAOMode::FullResolution)
+    {
+        m_RenderGraph.AddPass("SSAO", [&](RenderGraphBuilder& b) {
+            b.Read(m_GBuffer.Position);
+            b.Read(m_GBuffer.Normal);
+            b.Read(m_GBuffer.Depth);
+            b.WriteColor(m_SSAORaw, 0);
+        }, [this] { SSAOPass(); });
+
+        m_RenderGraph.AddPass("SSAO Blur", [&](RenderGraphBuilder& b) {
+            b.Read(m_SSAORaw);
+            b.WriteColor(m_SSAOResult, 0);
+        }, [this] { SSAOBlurPass(); });
+    }
+    else
+    {
+        const char* name = m_SSAOMode == SSAOMode::HalfResolution ? "SSAO Half" : "SSAO Quarter";
+        m_RenderGraph.AddPass(name, [&](RenderGraphBuilder& b) {
+            b.Read(m_GBuffer.Normal);
+            b.Read(m_GBuffer.Depth);
+            b.Write(m_SSAOLowDepth);
+            b.Write(m_SSAOLowRaw);
+            b.Write(m_SSAOLowBlur);
+            b.Write(m_SSAOResult);
+        }, [this] { SSAOComputePass(); });
+    }
 
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Normal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, nWidth, nHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+    m_RenderGraph.AddPass("SkyView", [&](RenderGraphBuilder& b) {
+        b.Read(transmittance);
+        b.Read(multiScattering);
+        b.Write(skyView);
+    }, [this] { SkyViewPass(); });
 
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Albedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nWidth, nHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    m_RenderGraph.AddPass("SkyCap", [&](RenderGraphBuilder& b) {
+        b.Read(transmittance);
+        b.Read(multiScattering);
+        b.Read(skyView);
+        b.Write(skyProbe);
+    }, [this] { SkyCapture(); });
 
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.ARM);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, nWidth, nHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    m_RenderGraph.AddPass("ShadowMap", [&](RenderGraphBuilder& b) {
+        b.Write(shadowMap);
+    }, [this] { ShadowMapPass(); });
 
-    glBindTexture(GL_TEXTURE_2D, m_GBuffer.Depth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, nWidth, nHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    m_RenderGraph.AddPass("LocalShadows", [&](RenderGraphBuilder& b) {
+        b.Write(shadowAtlas);
+    }, [this] { LocalShadowPass(); });
 
-    glBindTexture(GL_TEXTURE_2D, m_SSAOColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, nWidth, nHeight, 0, GL_RED, GL_FLOAT, NULL);
+    if (m_VolumetricMode == VolumetricMode::Froxel)
+    {
+        m_RenderGraph.AddPass("Froxels", [&](RenderGraphBuilder& b) {
+            b.Read(shadowMap);
+            b.Read(transmittance);
+            b.Read(multiScattering);
+            b.Write(froxels);
+        }, [this] { FroxelPass(); });
+    }
+    else if (m_VolumetricMode != VolumetricMode::FullResolution)
+    {
+        const char* name = m_VolumetricMode == VolumetricMode::HalfResolution ? "Volumetrics Half" : "Volumetrics Quarter";
+        m_RenderGraph.AddPass(name, [&](RenderGraphBuilder& b) {
+            b.Read(m_GBuffer.Depth);
+            b.Read(shadowMap);
+            b.Read(transmittance);
+            b.Read(multiScattering);
+            b.Write(volumetrics);
+        }, [this] { VolumetricPass(); });
+    }
+
+    m_RenderGraph.AddPass("Lighting", [&](RenderGraphBuilder& b) {
+        b.Read(m_GBuffer.Position);
+        b.Read(m_GBuffer.Normal);
+        b.Read(m_GBuffer.Albedo);
+        b.Read(m_GBuffer.ARM);
+        b.Read(m_GBuffer.Depth);
+        b.Read(m_SSAOResult);
+        b.Read(shadowMap);
+        b.Read(shadowAtlas);
+        b.Read(transmittance);
+        b.Read(skyProbe);
+        b.WriteColor(m_LightingResult, 0);
+    }, [this] { LightingPass(); });
+
+    m_RenderGraph.AddPass("Atmosphere", [&](RenderGraphBuilder& b) {
+        b.Read(m_GBuffer.Depth);
+        b.Read(m_LightingResult);
+        b.Read(shadowMap);
+        b.Read(transmittance);
+        b.Read(multiScattering);
+        b.Read(skyView);
+        b.Read(froxels);
+        b.Read(volumetrics);
+        b.Write(backbuffer);
+    }, [this] { AtmospherePass(); });
+
+    m_RenderGraph.AddPass("Forward", [&](RenderGraphBuilder& b) {
+        b.Write(backbuffer);
+    }, [this] { ForwardPass(); });
+
+    if (m_TargetReadback)
+    {
+        m_RenderGraph.AddPass("Readback", [&](RenderGraphBuilder& b) {
+            b.Read(backbuffer);
+            b.Read(m_GBuffer.Normal);
+            b.Read(m_GBuffer.Albedo);
+            b.Read(m_GBuffer.ARM);
+            b.Read(m_GBuffer.Depth);
+            b.Read(m_LightingResult);
+            b.SetSideEffect();
+        }, [this] { ReadbackPass(); });
+    }
+
+    m_RenderGraph.Compile(m_Width, m_Height);
+    m_RenderGraphDirty = false;
+}
+
+RenderSettings Renderer::GetSettings() const
+{
+    RenderSettings settings;
+    settings.Exposure = m_Exposure;
+    settings.CascadeSplits = { m_ShadowCascadeLevelOne, m_ShadowCascadeLevelTwo, m_ShadowCascadeLevelThree, m_ShadowCascadeLevelFour };
+    settings.GBufferLayout = (u8)m_GBufferLayout;
+    settings.SSAOMode = (u8)m_SSAOMode;
+    settings.SSAOSamples = m_SSAOComputeSamples;
+    settings.VolumetricMode = (u8)m_VolumetricMode;
+    settings.FroxelLocalLights = m_FroxelLocalLights;
+    settings.FogDensity = m_FogDensity;
+    settings.ShadowCaching = m_ShadowCaching;
+    settings.ShadowTileBudget = m_ShadowTileBudget;
+    return settings;
+}
+
+// only rebuilds the render graph when a mode actually changed, replay calls this every frame
+void Renderer::ApplySettings(const RenderSettings& settings)
+{
+    m_Exposure = settings.Exposure;
+    m_ShadowCascadeLevelOne = settings.CascadeSplits[0];
+    m_ShadowCascadeLevelTwo = settings.CascadeSplits[1];
+    m_ShadowCascadeLevelThree = settings.CascadeSplits[2];
+    m_ShadowCascadeLevelFour = settings.CascadeSplits[3];
+
+    if ((GBufferLayout)settings.GBufferLayout != m_GBufferLayout) SetGBufferLayout((GBufferLayout)settings.GBufferLayout);
+    if ((SSAOMode)settings.SSAOMode != m_SSAOMode)
+    {
+        m_SSAOMode = (SSAOMode)settings.SSAOMode;
+        m_RenderGraphDirty = true;
+    }
+    if ((VolumetricMode)settings.VolumetricMode != m_VolumetricMode)
+    {
+        m_VolumetricMode = (VolumetricMode)settings.VolumetricMode;
+        m_RenderGraphDirty = true;
+    }
 
-    glBindTexture(GL_TEXTURE_2D, m_SSAOBlurBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, nWidth, nHeight, 0, GL_RED, GL_FLOAT, NULL);
+    m_SSAOComputeSamples = settings.SSAOSamples;
+    m_FroxelLocalLights = settings.FroxelLocalLights;
+    m_FogDensity = settings.FogDensity;
+    m_ShadowCaching = settings.ShadowCaching;
+    m_ShadowTileBudget = settings.ShadowTileBudget;
+}
 
-    glBindTexture(GL_TEXTURE_2D, m_LightingResult);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, nWidth, nHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+bool Renderer::CaptureFrames(const std::string& path, int count)
+{
+    if (count <= 0 || !m_Capture.Open(path)) return false;
+    m_CaptureFramesLeft = count;
+    return true;
+}
 
+void Renderer::Resize(int nWidth, int nHeight)
+{
 	m_Width = nWidth;
 	m_Height = nHeight;
+
+    m_RenderGraph.Resize(m_Width, m_Height);
+    CreateVolumetricTargets();
+    CreateOutputTarget();
 }
 
+// everything, blocking. the watcher only rebuilds what changed
 void Renderer::ReloadShaders()
 {
-    m_GBufferShader->Reload("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag");
-	m_LightingShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/lighting.frag");
-    m_SSAOShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/ssao.frag");
-    m_SSAOBlurShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/ssaoblur.frag");
-    m_SkyboxShader->Reload("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
-    m_EquirectangularToCubemapShader->Reload("assets/shaders/cubemap.vert", "assets/shaders/equirectangular_to_cubemap.frag");
-    m_IrradianceShader->Reload("assets/shaders/cubemap.vert", "assets/shaders/irradiance_convolution.frag");
-    m_PrefilterShader->Reload("assets/shaders/cubemap.vert", "assets/shaders/prefilter.frag");
-    m_BrdfShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/brdf.frag");
-    // m_AtmosphereShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/volumetric.frag");
-    m_AtmosphereShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/atmosphere.frag");
-    m_TransmittanceShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/transmittance.frag");
-    m_MultiScatteringShader->Reload("assets/shaders/fullscreen.vert", "assets/shaders/multi_scattering.frag");
+    ShaderBatch shaders;
+    for (Shader* shader : Shader::GetLiveShaders()) shader->Reload(&shaders);
+    shaders.Finish();
+    m_SkyViewValid = false;
 }
 
 void Renderer::SubmitDrawCmd(const Entity& entity, Shader& shader)
@@ -687,16 +1185,23 @@ void Renderer::SubmitDrawCmd(const Entity& entity, Shader& shader)
     if (!entity.meshAsset) return;
 
     shader.Bind();
-    shader.SetUniformMat4f("uModel", entity.transform);
 
     if (m_MeshCache.find(entity.meshAsset.get()) == m_MeshCache.end())
     {
+        PROFILE_SCOPE("Mesh Upload");
         m_MeshCache[entity.meshAsset.get()] = std::make_unique<MeshResource>(*entity.meshAsset);
     }
     
     MeshResource* mesh = m_MeshCache[entity.meshAsset.get()].get();
     mesh->Bind();
 
+    AppendDrawCmds(entity, mesh, m_Scene->activeCamera->GetViewMatrix(), m_DeferredQueue);
+}
+
+void Renderer::AppendDrawCmds(const Entity& entity, MeshResource* mesh, const glm::mat4& view, std::vector<DrawCmd>& queue)
+{
+    if (!entity.meshAsset) return;
+
     const std::vector<SubMesh>& subMeshes = entity.meshAsset->SubMeshes;
     for (int i = 0; i < subMeshes.size(); ++i)
     {
@@ -704,40 +1209,64 @@ void Renderer::SubmitDrawCmd(const Entity& entity, Shader& shader)
         
         if (subMesh.MaterialIndex < entity.materials.size())
         {
-            Material* mat = entity.materials[subMesh.MaterialIndex].get();
-
             DrawCmd item;
             item.shadowCasting = true;
+            item.isStatic = entity.isStatic;
+            item.Owner = &entity;
             item.Mesh = mesh;
             item.Material = entity.materials[subMesh.MaterialIndex];
             item.Model = entity.transform;
             item.SubMeshIndex = i;
             
             glm::vec4 worldCenter = item.Model * glm::vec4(subMesh.LocalCenter, 1.0f);
-            glm::vec4 viewCenter  = m_Scene->activeCamera->GetViewMatrix() * worldCenter;
+            glm::vec4 viewCenter  = view * worldCenter;
             item.depth = -viewCenter.z;
+
+            glm::vec3 axisScale = glm::vec3(glm::length(glm::vec3(item.Model[0])), glm::length(glm::vec3(item.Model[1])), glm::length(glm::vec3(item.Model[2])));
+            item.boundsCenter = glm::vec3(worldCenter);
+            item.boundsRadius = subMesh.LocalRadius * std::max(axisScale.x, std::max(axisScale.y, axisScale.z));
             
-            m_DeferredQueue.push_back(item);
-            // if (mat->Translucent) m_ForwardQueue.push_back(item);
-            // else                  m_DeferredQueue.push_back(item);
+            queue.push_back(item);
+            // if (item.Material->Translucent) m_ForwardQueue.push_back(item);
+            // else                            m_DeferredQueue.push_back(item);
         }
     }
 }
 
 RenderTexture* Renderer::GetGPUTexture(const Texture* cpuTexture)
 {
-    if (m_TextureCache.find(cpuTexture) == m_TextureCache.end())
-    {
-        m_TextureCache[cpuTexture] = std::make_unique<RenderTexture>(*cpuTexture);
-    }
-
-    return m_TextureCache[cpuTexture].get();
+    return m_TextureStreamer.Get(cpuTexture);
 }
 
 void Renderer::ClearCache()
 {
     m_MeshCache.clear();
-    m_TextureCache.clear();
+    m_TextureStreamer.Clear();
+}
+
+// the level each texture needs from the screen size of the visible draws using it, taking the
+// texture to span the submesh's bounds once. a camera inside the bounds wants everything
+void Renderer::RequestTextureLevels()
+{
+    PROFILE_SCOPE("Texture Requests");
+    m_TextureStreamer.BeginFrame();
+
+    const Camera* camera = m_Scene->activeCamera;
+    const glm::mat4 viewProj = camera->GetProjectionMatrix() * camera->GetViewMatrix();
+    const float pixelsPerUnit = m_Height / (2.0f * std::tan(glm::radians(camera->GetFOV()) * 0.5f));
+
+    for (const std::vector<DrawCmd>* queue : { &m_DeferredQueue, &m_ForwardQueue })
+    {
+        for (const DrawCmd& cmd : *queue)
+        {
+            if (!cmd.Material || !SphereInFrustum(viewProj, cmd.boundsCenter, cmd.boundsRadius)) continue;
+
+            float pixels = cmd.depth > cmd.boundsRadius ? 2.0f * cmd.boundsRadius * pixelsPerUnit / cmd.depth : std::numeric_limits<float>::max();
+            if (cmd.Material->DiffuseTexture) m_TextureStreamer.Request(cmd.Material->DiffuseTexture.get(), pixels);
+            if (cmd.Material->NormalTexture) m_TextureStreamer.Request(cmd.Material->NormalTexture.get(), pixels);
+            if (cmd.Material->ARMTexture) m_TextureStreamer.Request(cmd.Material->ARMTexture.get(), pixels);
+        }
+    }
 }
 
 void Renderer::BindMaterial(std::shared_ptr<Material> mat)
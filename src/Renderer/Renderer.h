@@ -2,14 +2,25 @@
 
 #include <unordered_map>
 #include <memory>
+#include <array>
+#include <map>
 
 #include "Resources/Entity.h"
 #include "Core/Scene.h"
 #include "MeshResource.h"
 #include "RenderTexture.h"
 #include "Shader.h"
+#include "ShaderWatcher.h"
+#include "TextureStreamer.h"
 #include "FullscreenQuad.h"
 #include "GPUTimer.h"
+#include "FrameArena.h"
+#include "StreamBuffer.h"
+#include "UniformBlocks.h"
+#include "RenderGraph.h"
+#include "ImageDiff.h"
+#include "ShadowAtlas.h"
+#include "FrameCapture.h"
 
 #include "imgui.h"
 #include "stb_image.h"
@@ -17,17 +28,149 @@
 struct GBuffer
 {
 
-	uint Position;
-	uint Normal;
-	uint Albedo;
-    uint ARM;
-	uint Depth;
-	uint FBO;
+	RenderGraphResource Position; // full layout only
+	RenderGraphResource Normal;   // rgba16f view space, or octahedral rg16 in the slim layout
+	RenderGraphResource Albedo;
+    RenderGraphResource ARM;
+	RenderGraphResource Depth;
 
 	FullscreenQuad quad;
     
 };
 
+// one target read back by Renderer::ReadbackTargets, rgba8 with the top row first.
+// float targets are mapped to 0..255 so images from both gbuffer layouts compare
+struct RenderTargetImage
+{
+    std::string Name;   // final, albedo, normal, arm, lighting, depth
+    std::vector<uint8_t> Pixels;
+};
+
+struct MeshPassUniforms
+{
+    UniformHandle<glm::mat4> Model;
+    UniformHandle<glm::mat4> LightProj;
+    UniformHandle<float> Opacity;
+};
+
+struct AtmosphereUniforms
+{
+    UniformHandle<int> VolumetricMode;
+    UniformHandle<glm::mat4> CaptureInvViewProj;
+};
+
+// everything the sky probe depends on, a refresh starts once one of these moves past a threshold
+struct SkyProbeInputs
+{
+    glm::vec3 SunDirection = glm::vec3(0.0f);
+    glm::vec3 SunColor = glm::vec3(0.0f);
+    float SunIntensity = 0.0f;
+    float Exposure = 0.0f;
+};
+
+// how the atmosphere pass gets aerial perspective and light shafts for pixels that hit geometry
+enum class VolumetricMode
+{
+    Froxel,             // froxel volume from FroxelPass, one 3d lookup per pixel
+    FullResolution,     // shadowed raymarch per pixel in atmosphere.frag, the reference
+    HalfResolution,     // volumetric_march.comp, jittered + temporally accumulated, bilateral upsample
+    QuarterResolution
+};
+
+enum class GBufferLayout
+{
+    Full,   // rgba16f position + normal, rgba16f lighting
+    Slim    // position from depth, rg16 octahedral normal, r11g11b10f lighting
+};
+
+enum class SSAOMode
+{
+    FullResolution,     // ssao.frag + ssaoblur.frag, reads gPosition
+    HalfResolution,     // compute path from downsampled depth
+    QuarterResolution
+};
+
+// what a cascade matrix is built from. only changes when the camera leaves the cell, the split
+// distances / fov / aspect change or the sun moves, so it's compared instead of the float matrix
+struct ShadowCascadeKey
+{
+    glm::vec3 SunDirection = glm::vec3(0.0f);
+    float Extent = 0.0f;                // half size of the light space box
+    glm::ivec3 Cell = glm::ivec3(0);    // snapped center, x / y in snap cells and z in depth slabs
+
+    bool operator==(const ShadowCascadeKey& other) const
+    {
+        return SunDirection == other.SunDirection && Extent == other.Extent && Cell == other.Cell;
+    }
+};
+
+// per cascade state of the shadow cache. static casters live in a separate layer that is only
+// re-rendered when the cascade key changes or a static caster inside it moved
+struct ShadowCascadeCache
+{
+    ShadowCascadeKey Key;
+    glm::mat4 Matrix = glm::mat4(0.0f);
+    bool StaticValid = false;
+    bool HasDynamic = false;    // dynamic casters were drawn over the static layer last update
+    bool Updated = false;       // this frame
+    uint UpdateCount = 0;
+    uint StaticUpdateCount = 0; // static layer redraws, should stay put while the camera pans
+};
+
+// last seen state of a static caster, to find which cascades to invalidate when it moves or goes away
+struct StaticShadowCaster
+{
+    uint TransformVersion = 0;
+    glm::vec3 Center = glm::vec3(0.0f);
+    float Radius = 0.0f;
+    bool Seen = false;
+};
+
+// atlas tiles of one shadowed point or spot light
+struct LocalShadow
+{
+    std::array<ShadowAtlasTile, 6> Tiles;   // spot lights only use the first
+    std::array<glm::mat4, 6> Matrices;          // for the light as it is now
+    std::array<glm::mat4, 6> RenderedMatrices;  // what each tile was last rendered with
+    uint TileCount = 0;
+    uint TileSize = 0;
+    uint DirtyMask = 0;         // tiles waiting to be re-rendered
+    uint ScheduledMask = 0;     // tiles LocalShadowPass renders this frame
+    uint RenderedMask = 0;      // tiles that hold depth for this light (maybe stale)
+    uint BufferIndex = 0;       // first entry in the local shadow buffer this frame
+
+    // light state the matrices were built from
+    glm::vec3 Position = glm::vec3(0.0f);
+    glm::vec3 Direction = glm::vec3(0.0f);
+    float Radius = 0.0f;
+    float Cutoff = 0.0f;
+    size_t CasterSignature = 0;
+
+    float Importance = 0.0f;    // projected size in pixels, decides the tile size and update order
+    bool Seen = false;
+};
+
+struct LocalShadowStats
+{
+    uint ShadowedLights = 0;
+    uint AllocatedTiles = 0;
+    float Occupancy = 0.0f;
+    uint TilesUpdated = 0;      // this frame
+    uint PendingTiles = 0;
+    uint FailedAllocations = 0;
+    uint64_t TotalTileUpdates = 0;
+};
+
+struct LightCullingStats
+{
+    uint VisiblePointLights = 0;
+    uint VisibleSpotLights = 0;
+    uint IndexCount = 0;
+    uint MaxLightsPerCluster = 0;
+    bool Overflow = false;
+    float CpuMs = 0.0f;
+};
+
 struct DrawCmd
 {
     
@@ -36,6 +179,12 @@ struct DrawCmd
     glm::mat4 Model;
     std::shared_ptr<Material> Material;
     bool shadowCasting;
+    bool isStatic;
+    const Entity* Owner;
+
+    // world space bounding sphere of the submesh
+    glm::vec3 boundsCenter;
+    float boundsRadius;
     
     float depth;
 
@@ -57,76 +206,231 @@ public:
     void DrawScene();
     void Resize(int nWidth, int nHeight);
     void ReloadShaders();
+    // recompile shaders as their files change, polled in BeginFrame
+    void WatchShaders(const std::string& directory) { m_ShaderWatcher.Start(directory); }
 
     void SubmitDrawCmd(const Entity& entity, Shader& shader);
+    // the cpu side of SubmitDrawCmd, one command per submesh with a material. no GL, mesh may be null
+    static void AppendDrawCmds(const Entity& entity, MeshResource* mesh, const glm::mat4& view, std::vector<DrawCmd>& queue);
     void ClearCache();
 
     RenderTexture* GetGPUTexture(const Texture* cpuTexture);
 
+    RenderSettings GetSettings() const;
+    void ApplySettings(const RenderSettings& settings);
+    uint GetDrawCmdCount() const { return (uint)(m_DeferredQueue.size() + m_ForwardQueue.size()); }
+
+    // writes what DrawScene consumes over the next count frames to path, see FrameCapture.h
+    bool CaptureFrames(const std::string& path, int count);
+    bool IsCapturing() const { return m_CaptureFramesLeft > 0; }
+
+    // draw into a framebuffer owned by the renderer instead of the default one, for contexts
+    // without a window surface. set before Init
+    void SetOffscreenOutput(bool offscreen) { m_OffscreenOutput = offscreen; }
+    // off uploads every material texture whole the first time it's drawn, before Init
+    void SetTextureStreaming(bool enabled) { m_TextureStreamer.SetEnabled(enabled); }
+    // rgba8 of the last finished frame, rows bottom up
+    std::vector<uint8_t> ReadOutputPixels() const;
+    const LocalShadowStats& GetLocalShadowStats() const { return m_LocalShadowStats; }
+
+    // adds a pass at the end of the graph that keeps the gbuffer alive and copies it, together with
+    // the final image, into PBOs when requested. enable up front when timings matter, toggling it
+    // rebuilds the graph
+    void SetTargetReadback(bool enabled);
+    // the next DrawScene does the copies, enables the readback pass if needed
+    void RequestTargetReadback();
+    // waits for the copies of the last request and decodes them, false if nothing was requested
+    bool ReadbackTargets(std::vector<RenderTargetImage>& images);
+
     void SetScene(SceneData& s) { m_Scene = &s; }
     SceneData* GetScene(void) { return m_Scene; }
 
-    std::unordered_map<std::string, std::chrono::nanoseconds> m_PerformanceTimer;
 private:
     SceneData* m_Scene;
     
     GBuffer m_GBuffer;
 
     // TODO: clean this up...
-    uint m_SSAOFBO, m_SSAOBlurFBO, m_SSAONoise;
-    uint m_SSAOColorBuffer, m_SSAOBlurBuffer;
+    uint m_SSAONoise;
+    RenderGraphResource m_SSAORaw, m_SSAOResult;
+    RenderGraphResource m_SSAOLowDepth, m_SSAOLowRaw, m_SSAOLowBlur;
+    SSAOMode m_SSAOMode = SSAOMode::FullResolution;
+    int m_SSAOComputeSamples = 16;
     uint m_ShadowMapFBO, m_ShadowMapTexture, m_ShadowMapResolution, m_ShadowMapSplit;
     // uint m_SkyboxTexture, m_IrradianceMap, m_EnvCubemap, m_SkyboxVAO, m_SkyboxVBO, m_CubeVAO, m_CubeVBO, m_CaptureFBO, m_CaptureRBO, m_PrefilterMap, m_BRDFLUTTexture;
     uint m_Width, m_Height;
+    bool m_OffscreenOutput = false;
+    uint m_OutputFBO = 0, m_OutputColor = 0, m_OutputDepth = 0;     // all 0 when drawing to the window
+    bool m_TargetReadback = false;      // readback pass is in the graph
+    bool m_ReadbackRequested = false;
+    GLsync m_ReadbackFence = nullptr;
+    std::array<uint, 6> m_ReadbackPBOs = {};
+    uint m_ReadbackWidth = 0, m_ReadbackHeight = 0;
+    float m_ReadbackNear = 0.1f, m_ReadbackFar = 10000.0f;
+    bool m_ReadbackSlim = true;
     uint m_TransmittanceLUT, m_TransmittanceFBO;
     uint m_MultiScatteringLUT, m_MultiScatteringFBO;
+    uint m_SkyViewLUT, m_SkyViewFBO;
+    glm::vec3 m_SkyViewSunDirection = glm::vec3(0.0f); // what the LUT was last rendered with
+    float m_SkyViewAltitude = 0.0f;
+    bool m_SkyViewValid = false;
+    uint m_SkyViewUpdateCount = 0;
+    uint m_FroxelScattering, m_FroxelExtinction;                         // written by the inject step
+    uint m_FroxelIntegratedScattering, m_FroxelIntegratedTransmittance;  // read by the atmosphere pass
+    VolumetricMode m_VolumetricMode = VolumetricMode::Froxel;
+    bool m_FroxelLocalLights = true;
+    float m_FogDensity = 0.0f; // km^-1
+    uint m_BlueNoise;
+    uint m_VolumetricHistory[2] = { 0, 0 };                 // rgb in-scattering, a view depth
+    uint m_VolumetricHistoryTransmittance[2] = { 0, 0 };
+    uint m_VolumetricWidth = 0, m_VolumetricHeight = 0;
+    uint m_VolumetricHistoryIndex = 0;                      // the one written this frame
+    bool m_VolumetricHistoryValid = false;
+    int m_VolumetricFrameIndex = 0;
+    glm::mat4 m_PrevViewProj = glm::mat4(1.0f);
+    bool m_VolumetricCompareRequested = false;
+    ImageDiffResult m_VolumetricDiff;
+    uint m_VolumetricDiffTexture = 0;
     uint m_PrefilteredMap;
     uint m_PostProcess;
-    uint m_LightingFBO, m_LightingResult;
-    uint m_SkyProbeMap, m_SkyProbeFBO;
+    RenderGraphResource m_LightingResult;
+    GBufferLayout m_GBufferLayout = GBufferLayout::Slim;
+    uint m_SkyProbeMap, m_SkyProbeBackMap, m_SkyProbeFBO;
     uint m_SkyCaptureSize;
+    SkyProbeInputs m_SkyProbeInputs;    // what the front probe (or the one being captured) was rendered with
+    int m_SkyProbeFace = -1;            // next face of the back probe, -1 when no refresh is running
+    bool m_SkyProbeValid = false;
+    bool m_SkyProbeForceRefresh = false;
+    uint m_SkyProbeRefreshCount = 0;
     Shader* m_ForwardShader;
     Shader* m_GBufferShader;
     Shader* m_LightingShader;
     Shader* m_SSAOShader;
     Shader* m_SSAOBlurShader;
+    Shader* m_SSAODownsampleShader;
+    Shader* m_SSAOComputeShader;
+    Shader* m_SSAOBlurComputeShader;
+    Shader* m_SSAOUpsampleShader;
     Shader* m_SkyboxShader;
     Shader* m_EquirectangularToCubemapShader;
     Shader* m_IrradianceShader;
     Shader* m_PrefilterShader;
     Shader* m_BrdfShader;
+    ShaderPermutations* m_AtmosphereShaders;
     Shader* m_AtmosphereShader;
+    Shader* m_AtmosphereIBLShader;
     Shader* m_TransmittanceShader;
     Shader* m_MultiScatteringShader;
+    Shader* m_SkyViewShader;
+    ShaderPermutations* m_FroxelInjectShaders;
+    Shader* m_FroxelIntegrateShader;
+    Shader* m_VolumetricShader;
     Shader* m_ShadowMapShader;
     Shader* m_PostProcessShader;
+    ShaderWatcher m_ShaderWatcher;
     
     float m_ShadowCascadeLevelOne, m_ShadowCascadeLevelTwo, m_ShadowCascadeLevelThree, m_ShadowCascadeLevelFour;
     std::vector<float> m_ShadowCascadeLevels;
     std::vector<glm::mat4> m_ShadowCascadeMatrices;
     std::vector<uint> m_ShadowMapDebugTextures;
+    uint m_StaticShadowMapTexture;
+    std::vector<ShadowCascadeCache> m_ShadowCascadeCache;
+    std::map<std::pair<const Entity*, uint>, StaticShadowCaster> m_StaticShadowCasters; // entity, submesh
+    uint m_ShadowFrameIndex = 0;
+    bool m_ShadowCaching = true;
 
     void GeometryPass();
+    void SetGBufferLayout(GBufferLayout layout);
+    uint GetGBufferBytesPerPixel() const;
+    void SkyViewPass();
     void SkyCapture();
+    void RenderSkyProbeFace(uint probe, uint face);
     void SSAOPass();
+    void SSAOBlurPass();
+    void SSAOComputePass();
     void ShadowMapPass();
+    void LightCullingPass();
+    int RequestLocalShadow(const Light* light, const glm::vec3& position, const glm::vec3& direction, float radius, float cutoff, uint& shadowCount);
+    void UpdateLocalShadows(LocalShadowData* shadowData);
+    void LocalShadowPass();
     void LightingPass();
+    void FroxelPass();
+    void VolumetricPass();
+    void CreateVolumetricTargets();
+    void CompareVolumetricsWithReference();
     void AtmospherePass();
+    void CreateOutputTarget();
     void ForwardPass();
+    void ReadbackPass();
 
     void ShadowMapInit();
-    std::vector<glm::vec4> GetFrustumCornersWorldSpace(const glm::mat4& proj, const glm::mat4& view);
-    glm::mat4 GetLightSpaceMatrix(const float nearPlane, const float farPlane);
+    void UpdateStaticShadowCasters();
+    void RenderShadowCasters(bool staticCasters, uint cascade);
+    void BuildRenderGraph();
+    void InitUniformHandles();
+    ShadowCascadeKey GetShadowCascadeKey(const float nearPlane, const float farPlane);
+    glm::mat4 GetLightSpaceMatrix(const ShadowCascadeKey& key);
 
     float m_Exposure;
 
+    MeshPassUniforms m_GBufferUniforms;
+    MeshPassUniforms m_ForwardUniforms;
+    MeshPassUniforms m_ShadowMapUniforms;
+    AtmosphereUniforms m_AtmosphereUniforms;
+    UniformHandle<int> m_GBufferPacked;
+    UniformHandle<int> m_LightingPacked;
+    UniformHandle<int> m_SSAOPacked;
+    UniformHandle<int> m_SSAOComputePacked;
+    UniformHandle<int> m_SSAODownsampleScale;
+    UniformHandle<int> m_SSAOComputeSampleCount;
+    UniformHandle<float> m_FroxelFogDensity;
+    UniformHandle<int> m_VolumetricScale;
+    UniformHandle<int> m_VolumetricFrame;
+    UniformHandle<int> m_VolumetricUseHistory;
+    UniformHandle<glm::mat4> m_VolumetricPrevViewProj;
+
+    // std140 blocks shared by all passes, written once per frame
+    StreamBuffer* m_FrameUBO;
+    StreamBuffer* m_CascadeUBO;
+
+    // clustered lighting, filled by LightCullingPass
+    StreamBuffer* m_PointLightSSBO;
+    StreamBuffer* m_SpotLightSSBO;
+    StreamBuffer* m_ClusterSSBO;
+    StreamBuffer* m_LightIndexSSBO;
+    LightCullingStats m_LightCullingStats;
+
+    // point and spot light shadows, tiles are requested by LightCullingPass for visible lights
+    ShadowAtlas m_ShadowAtlas;
+    StreamBuffer* m_LocalShadowSSBO;
+    std::unordered_map<const Light*, LocalShadow> m_LocalShadows;
+    LocalShadowStats m_LocalShadowStats;
+    int m_ShadowTileBudget = 8;     // tiles re-rendered per frame at most
+    UniformHandle<int> m_LightingDebugClusters;
+    bool m_ShowClusterHeatmap = false;
+
+    void UploadFrameUniforms();
+    void UploadCascadeUniforms();
+
     std::vector<glm::vec3> m_SSAOKernel;
 
+    // owns the screen sized targets and pass order, rebuilt when the gbuffer layout or SSAO mode changes
+    RenderGraph m_RenderGraph;
+    bool m_RenderGraphDirty = true;
+
+    FrameCaptureWriter m_Capture;
+    int m_CaptureFramesLeft = 0;
+
+    // transient per-frame allocations (uniform names, frustum corners...), reset in BeginFrame
+    FrameArena m_FrameArena;
+
     std::vector<DrawCmd> m_DeferredQueue;
     std::vector<DrawCmd> m_ForwardQueue;
 
     std::unordered_map<const Mesh*, std::unique_ptr<MeshResource>> m_MeshCache;
-    std::unordered_map<const Texture*, std::unique_ptr<RenderTexture>> m_TextureCache;
+    TextureStreamer m_TextureStreamer;
 
     void BindMaterial(std::shared_ptr<Material> mat);
+    void RequestTextureLevels();
+    static bool SphereInFrustum(const glm::mat4& viewProj, const glm::vec3& center, float radius);
 };
\ No newline at end of file
@@ -4,25 +4,62 @@
 #include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <thread>
 
-Shader::Shader(const std::string& vertPath, const std::string& fragPath) : m_RendererID(0)
+#include <GLFW/glfw3.h>
+
+#include "Core/Profiler.h"
+#include "ShaderCache.h"
+
+// KHR_parallel_shader_compile, not in the generated glad
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+#endif
+
+Shader::Shader(const std::string& vertPath, const std::string& fragPath, ShaderBatch* batch)
+    : Shader(vertPath, fragPath, ShaderDefines(), batch)
+{
+}
+
+Shader::Shader(const std::string& vertPath, const std::string& fragPath, const ShaderDefines& defines, ShaderBatch* batch)
+    : m_RendererID(0), m_VertPath(vertPath), m_FragPath(fragPath), m_Defines(defines), m_PermutationKey(GetShaderPermutationKey(defines))
 {
-    std::optional<std::string> vertexSource = ParseShader(vertPath);
-    std::optional<std::string> fragmentSource = ParseShader(fragPath);
+    m_Label = "shader program from '" + std::filesystem::path(vertPath).filename().string() +
+        "' and '" + std::filesystem::path(fragPath).filename().string() + "'" +
+        (m_PermutationKey.empty() ? "" : " [" + m_PermutationKey + "]");
+
+    GetInstances().push_back(this);
+    Build(false, batch);
+}
 
-    if (!vertexSource || !fragmentSource) return;
+Shader::Shader(const std::string& computePath, ShaderBatch* batch)
+    : Shader(computePath, ShaderDefines(), batch)
+{
+}
 
-    m_RendererID = CreateShader(*vertexSource, *fragmentSource);
+Shader::Shader(const std::string& computePath, const ShaderDefines& defines, ShaderBatch* batch)
+    : m_RendererID(0), m_ComputePath(computePath), m_Defines(defines), m_PermutationKey(GetShaderPermutationKey(defines))
+{
+    m_Label = "compute program from '" + std::filesystem::path(computePath).filename().string() + "'" +
+        (m_PermutationKey.empty() ? "" : " [" + m_PermutationKey + "]");
 
-    // tell what program id the shader now belongs to (print the name and id)
-    std::cout << "Loaded shader program from '" << std::filesystem::path(vertPath).filename().string()
-        << "' and '" << std::filesystem::path(fragPath).filename().string()
-        << "' with ID: " << m_RendererID << std::endl;
+    GetInstances().push_back(this);
+    Build(false, batch);
 }
 
 Shader::~Shader()
 {
+    std::vector<Shader*>& instances = GetInstances();
+    instances.erase(std::remove(instances.begin(), instances.end(), this), instances.end());
+
     if (m_RendererID != 0) glDeleteProgram(m_RendererID);
+    if (m_Pending.Program != 0) glDeleteProgram(m_Pending.Program);
+    for (const PendingStage& stage : m_Pending.Stages) glDeleteShader(stage.ID);
 }
 
 void Shader::Bind() const
@@ -40,226 +77,561 @@ bool Shader::IsValid() const
     return m_RendererID != 0;
 }
 
-std::optional<std::string> Shader::ParseShader(const std::string& filepath)
+std::string GetShaderPermutationKey(const ShaderDefines& defines)
+{
+    ShaderDefines sorted = defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string key;
+    for (const auto& [name, value] : sorted)
+    {
+        if (!key.empty()) key += ";";
+        key += name + "=" + value;
+    }
+    return key;
+}
+
+// appends path to output with its #includes expanded. every file goes in at most once, a second
+// include of it is dropped, so the shared files need no guards and cycles end by themselves.
+// prologue goes right below #version, which only the top level file may have
+static bool PreprocessShaderFile(const std::filesystem::path& path, const std::string& prologue, std::string& output, std::vector<std::string>& files)
 {
-    std::ifstream stream(filepath);
+    const std::string name = path.lexically_normal().generic_string();
+    if (std::find(files.begin(), files.end(), name) != files.end()) return true;
+
+    std::ifstream stream(path);
     if (!stream.is_open())
     {
-        std::cerr << "failed to open shader file: " << filepath << std::endl;
-        return std::nullopt;
+        std::cerr << "failed to open shader file: " << name << std::endl;
+        return false;
+    }
+
+    const int fileIndex = (int)files.size();
+    files.push_back(name);
+    if (fileIndex > 0) output += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t");
+        std::string_view directive = start == std::string::npos ? std::string_view() : std::string_view(line).substr(start);
+
+        if (directive.starts_with("#version"))
+        {
+            if (fileIndex > 0)
+            {
+                std::cerr << name << "(" << lineNumber << "): #version in an included file" << std::endl;
+                return false;
+            }
+
+            output += line + "\n" + prologue + "#line " + std::to_string(lineNumber + 1) + " 0\n";
+            continue;
+        }
+
+        if (directive.starts_with("#include"))
+        {
+            size_t open = directive.find('"');
+            size_t close = open == std::string_view::npos ? open : directive.find('"', open + 1);
+            if (close == std::string_view::npos)
+            {
+                std::cerr << name << "(" << lineNumber << "): expected #include \"file\"" << std::endl;
+                return false;
+            }
+
+            std::filesystem::path include = path.parent_path() / directive.substr(open + 1, close - open - 1);
+            if (!PreprocessShaderFile(include, prologue, output, files))
+            {
+                std::cerr << "  included from " << name << "(" << lineNumber << ")" << std::endl;
+                return false;
+            }
+
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        output += line + "\n";
+    }
+
+    return true;
+}
+
+// expands #include "file" (relative to the including file) and writes the global and this shader's
+// defines below #version. #line directives keep compile errors pointing at the right file, their
+// second number is the index into ShaderSource::Files
+bool Shader::ParseShader(const std::string& filepath, ShaderSource& source)
+{
+    // the shader's own value wins over a global one of the same name
+    std::map<std::string, std::string> defines;
+    for (const auto& [name, value] : GetGlobalDefines()) defines[name] = value;
+    for (const auto& [name, value] : m_Defines) defines[name] = value;
+
+    std::string prologue;
+    for (const auto& [name, value] : defines) prologue += "#define " + name + " " + value + "\n";
+
+    return PreprocessShaderFile(filepath, prologue, source.Code, source.Files);
+}
+
+// both stages are always parsed, so a file that failed still ends up in m_SourceFiles and fixing it
+// triggers the watcher
+void Shader::Build(bool reload, ShaderBatch* batch)
+{
+    ShaderSource sources[2];
+    std::vector<StageSource> stages;
+    bool parsed;
+    if (m_ComputePath.empty())
+    {
+        bool vertexParsed = ParseShader(m_VertPath, sources[0]);
+        bool fragmentParsed = ParseShader(m_FragPath, sources[1]);
+        parsed = vertexParsed && fragmentParsed;
+        stages = { { GL_VERTEX_SHADER, &sources[0] }, { GL_FRAGMENT_SHADER, &sources[1] } };
+    }
+    else
+    {
+        parsed = ParseShader(m_ComputePath, sources[0]);
+        stages = { { GL_COMPUTE_SHADER, &sources[0] } };
+    }
+
+    m_SourceFiles.clear();
+    for (const ShaderSource& source : sources)
+        for (const std::string& file : source.Files)
+            if (std::find(m_SourceFiles.begin(), m_SourceFiles.end(), file) == m_SourceFiles.end()) m_SourceFiles.push_back(file);
+
+    if (!parsed)
+    {
+        if (reload && m_RendererID != 0) std::cerr << "Reload of " << m_Label << " failed, keeping the previous program" << std::endl;
+        return;
     }
-    
-    std::stringstream buffer;
-    buffer << stream.rdbuf();
-    stream.close();
-    return buffer.str();
+
+    IssueProgram(stages, reload, batch);
 }
 
-uint Shader::CompileShader(uint type, const std::string& source)
+// the sources only need to live until this returns, the driver has its own copy after glShaderSource
+void Shader::IssueProgram(const std::vector<StageSource>& stages, bool reload, ShaderBatch* batch)
 {
-    uint id = glCreateShader(type);
-    const char* src = source.c_str();
-    glShaderSource(id, 1, &src, nullptr);
-    glCompileShader(id);
+    PROFILE_SCOPE("Shader Compile");
+
+    // a second change before the first reload finished, that one is out of date
+    if (m_Pending.Program != 0) glDeleteProgram(m_Pending.Program);
+    for (const PendingStage& stage : m_Pending.Stages) glDeleteShader(stage.ID);
+
+    m_Pending = PendingProgram();
+    m_Pending.Label = m_Label;
+    m_Pending.Reload = reload;
+    m_Pending.Start = std::chrono::steady_clock::now();
 
-    int result;
-    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-    if (result == GL_FALSE) {
-        int length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    std::vector<std::string_view> sources;
+    for (const StageSource& stage : stages) sources.push_back(stage.Source->Code);
+    m_Pending.CacheKey = ShaderCache::GetKey(sources);
 
-        std::vector<char> message(length);
-        glGetShaderInfoLog(id, length, &length, message.data());
+    if (uint cached = ShaderCache::Load(m_Pending.CacheKey))
+    {
+        m_Pending.Program = cached;
+        m_Pending.FromCache = true;
+    }
+    else
+    {
+        m_Pending.Program = glCreateProgram();
+        ShaderCache::PrepareProgram(m_Pending.Program);
 
-        std::cerr << " failed to compile "
-            << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
-            << " shader!\n" << message.data() << std::endl;
+        for (const StageSource& stage : stages)
+        {
+            uint id = glCreateShader(stage.Type);
+            const char* src = stage.Source->Code.c_str();
+            glShaderSource(id, 1, &src, nullptr);
+            glCompileShader(id);
+            glAttachShader(m_Pending.Program, id);
+            m_Pending.Stages.push_back({ stage.Type, id, stage.Source->Files });
+        }
 
-        glDeleteShader(id);
-        return 0;
+        // no status queries here, they would wait for the compiler. a stage that failed just makes
+        // the link fail, FinishProgram prints the logs
+        glLinkProgram(m_Pending.Program);
     }
-    return id;
+
+    if (batch) batch->Add(this);
+    else FinishProgram();
+}
+
+// only called with KHR_parallel_shader_compile, without it GL_COMPLETION_STATUS_KHR is an invalid enum
+bool Shader::IsProgramComplete() const
+{
+    if (m_Pending.Program == 0 || m_Pending.FromCache) return true;
+
+    int complete = GL_FALSE;
+    glGetProgramiv(m_Pending.Program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
 }
 
-uint Shader::CreateShader(const std::string& vertex_shader, const std::string& fragment_shader)
+void Shader::FinishProgram()
 {
-    uint program = glCreateProgram();
-    uint vs = CompileShader(GL_VERTEX_SHADER, vertex_shader);
-    uint fs = CompileShader(GL_FRAGMENT_SHADER, fragment_shader);
+    // already finished through another batch
+    if (m_Pending.Program == 0) return;
 
-    if (vs == 0 || fs == 0)
+    PendingProgram pending = std::move(m_Pending);
+    m_Pending = PendingProgram();
+    uint program = pending.Program;
+
+    if (!pending.FromCache)
     {
-        if (vs != 0) glDeleteShader(vs);
-        if (fs != 0) glDeleteShader(fs);
-        glDeleteProgram(program);
-        return 0;
+        bool compiled = true;
+        for (const PendingStage& stage : pending.Stages)
+        {
+            int result;
+            glGetShaderiv(stage.ID, GL_COMPILE_STATUS, &result);
+            if (result == GL_FALSE)
+            {
+                int length;
+                glGetShaderiv(stage.ID, GL_INFO_LOG_LENGTH, &length);
+
+                std::vector<char> message(length);
+                glGetShaderInfoLog(stage.ID, length, &length, message.data());
+
+                std::cerr << " failed to compile "
+                    << (stage.Type == GL_VERTEX_SHADER ? "vertex" : stage.Type == GL_COMPUTE_SHADER ? "compute" : "fragment")
+                    << " shader!\n" << message.data() << std::endl;
+
+                // the log says 1(42) for line 42 of the first include
+                if (stage.Files.size() > 1)
+                {
+                    std::cerr << "sources:";
+                    for (size_t i = 0; i < stage.Files.size(); ++i) std::cerr << " " << i << " " << stage.Files[i];
+                    std::cerr << std::endl;
+                }
+                compiled = false;
+            }
+
+            // flagged only, it goes away with the program
+            glDeleteShader(stage.ID);
+        }
+
+        int linkResult;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
+        if (linkResult == GL_FALSE)
+        {
+            if (compiled)
+            {
+                int length;
+                glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+                std::vector<char> message(length);
+                glGetProgramInfoLog(program, length, &length, message.data());
+
+                std::cerr << "failed to link shader program!\n"
+                    << message.data() << std::endl;
+            }
+
+            glDeleteProgram(program);
+            program = 0;
+        }
+
+        // in a batch this is issue to seen complete, the compiles overlap so it runs a bit high
+        ShaderCache::Store(pending.CacheKey, program, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.Start).count());
     }
 
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
-    glLinkProgram(program);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.Start).count();
+    if (pending.Reload && m_RendererID != 0)
+    {
+        if (program == 0)
+        {
+            std::cerr << "Reload of " << pending.Label << " failed, keeping the previous program" << std::endl;
+            return;
+        }
 
-    int linkResult;
-    glGetProgramiv(program, GL_LINK_STATUS, &linkResult);
-    if (linkResult == GL_FALSE)
+        glDeleteProgram(m_RendererID);
+        std::printf("Reloaded %s in %.1f ms%s\n", pending.Label.c_str(), ms, pending.FromCache ? " (cached)" : "");
+        std::fflush(stdout);
+    }
+    else
     {
-        int length;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
-        std::vector<char> message(length);
-        glGetProgramInfoLog(program, length, &length, message.data());
-
-        std::cerr << "failed to link shader program!\n"
-            << message.data() << std::endl;
-
-        glDeleteProgram(program);
-        glDeleteShader(vs);
-        glDeleteShader(fs);
-        return 0;
+        std::cout << "Loaded " << pending.Label << " with ID: " << program << std::endl;
     }
 
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    return program;
+    m_RendererID = program;
+    m_UniformLocationCache.clear();
+    for (UniformSlot& slot : m_UniformSlots) slot.Location = -1;
+
+    // handles resolved while the program was pending point nowhere yet
+    RestoreUniforms();
 }
 
-int Shader::GetUniformLocation(const std::string& name)
+ShaderBatch::ShaderBatch() : m_Start(std::chrono::steady_clock::now())
 {
-    if (m_UniformLocationCache.find(name) != m_UniformLocationCache.end())
-        return m_UniformLocationCache[name];
+    State& state = GetState();
+    if (state.Initialized) return;
+    state.Initialized = true;
+
+    if (!state.Parallel) return;
 
-    int location = glGetUniformLocation(m_RendererID, name.c_str());
+    // glad is generated without extensions, the entry point is looked up by hand. the ARB version
+    // is the same function
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count && !state.DriverThreads; ++i)
+    {
+        std::string_view name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        const char* function = name == "GL_KHR_parallel_shader_compile" ? "glMaxShaderCompilerThreadsKHR"
+                             : name == "GL_ARB_parallel_shader_compile" ? "glMaxShaderCompilerThreadsARB" : nullptr;
+        if (!function) continue;
+
+        auto maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress(function);
+        if (!maxShaderCompilerThreads) continue;
+
+        // all ones lets the driver pick the thread count
+        maxShaderCompilerThreads(0xFFFFFFFFu);
+        state.DriverThreads = true;
+    }
+}
+
+void ShaderBatch::Add(Shader* shader)
+{
+    if (std::find(m_Pending.begin(), m_Pending.end(), shader) != m_Pending.end()) return;
+
+    m_ProgramCount++;
+    if (GetState().Parallel) m_Pending.push_back(shader);
+    else shader->FinishProgram();
+}
+
+void ShaderBatch::Finish()
+{
+    PROFILE_SCOPE("Shader Batch");
+    const State& state = GetState();
+
+    while (!m_Pending.empty())
+    {
+        if (Poll() == 0) std::this_thread::yield();
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+    std::printf("Shader setup: %u programs in %.1f ms (%s)\n", m_ProgramCount, ms,
+                !state.Parallel ? "serial" : state.DriverThreads ? "parallel, driver compiler threads" : "batched, no parallel compile extension");
+    std::fflush(stdout);
+    m_ProgramCount = 0;
+    m_Start = std::chrono::steady_clock::now();
+}
+
+// with driver threads whatever is done first is finished first, otherwise the status queries
+// block anyway and the order doesn't matter
+uint ShaderBatch::Poll()
+{
+    const State& state = GetState();
+    const std::vector<Shader*>& live = Shader::GetLiveShaders();
+
+    uint finished = 0;
+    for (size_t i = 0; i < m_Pending.size();)
+    {
+        // destroyed while pending, the long lived reload batch can outlast a shader
+        bool alive = std::find(live.begin(), live.end(), m_Pending[i]) != live.end();
+        if (alive && state.DriverThreads && !m_Pending[i]->IsProgramComplete())
+        {
+            ++i;
+            continue;
+        }
+
+        if (alive)
+        {
+            m_Pending[i]->FinishProgram();
+            finished++;
+        }
+        m_Pending.erase(m_Pending.begin() + i);
+    }
+    return finished;
+}
+
+int Shader::GetUniformLocation(std::string_view name)
+{
+    auto it = m_UniformLocationCache.find(name);
+    if (it != m_UniformLocationCache.end())
+        return it->second;
+
+    // only hit the first time a name is seen, so the std::string here is not a per-frame cost
+    std::string key(name);
+    int location = glGetUniformLocation(m_RendererID, key.c_str());
 
     if (location == -1) {
         std::cerr << "Warning: uniform '" << name << "' doesn't exist in shader program ID " << m_RendererID << std::endl;
     }
 
-    m_UniformLocationCache[name] = location;
+    m_UniformLocationCache.emplace(std::move(key), location);
     return location;
 }
 
-void Shader::SetUniform1i(const std::string& name, int v)
+void Shader::CacheUniformValue(std::string_view name, const UniformVariant& value)
+{
+    auto it = m_UniformValueCache.find(name);
+    if (it != m_UniformValueCache.end())
+    {
+        it->second = value;
+        return;
+    }
+
+    m_UniformValueCache.emplace(std::string(name), value);
+}
+
+void Shader::SetUniform1i(std::string_view name, int v)
 {
     glUniform1i(GetUniformLocation(name), v);
-    m_UniformValueCache[name] = v;
+    CacheUniformValue(name, v);
 }
 
-void Shader::SetUniform2i(const std::string& name, int v0, int v1)
+void Shader::SetUniform2i(std::string_view name, int v0, int v1)
 {
     glUniform2i(GetUniformLocation(name), v0, v1);
-    m_UniformValueCache[name] = glm::ivec2(v0, v1);
+    CacheUniformValue(name, glm::ivec2(v0, v1));
 }
 
-void Shader::SetUniform3i(const std::string& name, int v0, int v1, int v2)
+void Shader::SetUniform3i(std::string_view name, int v0, int v1, int v2)
 {
     glUniform3i(GetUniformLocation(name), v0, v1, v2);
-    m_UniformValueCache[name] = glm::ivec3(v0, v1, v2);
+    CacheUniformValue(name, glm::ivec3(v0, v1, v2));
 }
 
-void Shader::SetUniform4i(const std::string& name, int v0, int v1, int v2, int v3)
+void Shader::SetUniform4i(std::string_view name, int v0, int v1, int v2, int v3)
 {
     glUniform4i(GetUniformLocation(name), v0, v1, v2, v3);
-    m_UniformValueCache[name] = glm::ivec4(v0, v1, v2, v3);
+    CacheUniformValue(name, glm::ivec4(v0, v1, v2, v3));
 }
 
-void Shader::SetUniform1f(const std::string& name, float v)
+void Shader::SetUniform1f(std::string_view name, float v)
 {
     glUniform1f(GetUniformLocation(name), v);
-    m_UniformValueCache[name] = v;
+    CacheUniformValue(name, v);
 }
 
-void Shader::SetUniform2f(const std::string& name, float v0, float v1)
+void Shader::SetUniform2f(std::string_view name, float v0, float v1)
 {
     glUniform2f(GetUniformLocation(name), v0, v1);
-    m_UniformValueCache[name] = glm::vec2(v0, v1);
+    CacheUniformValue(name, glm::vec2(v0, v1));
 }
 
-void Shader::SetUniform3f(const std::string& name, float v0, float v1, float v2)
+void Shader::SetUniform3f(std::string_view name, float v0, float v1, float v2)
 {
     glUniform3f(GetUniformLocation(name), v0, v1, v2);
-    m_UniformValueCache[name] = glm::vec3(v0, v1, v2);
+    CacheUniformValue(name, glm::vec3(v0, v1, v2));
 }
 
-void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
+void Shader::SetUniform4f(std::string_view name, float v0, float v1, float v2, float v3)
 {
     glUniform4f(GetUniformLocation(name), v0, v1, v2, v3);
-    m_UniformValueCache[name] = glm::vec4(v0, v1, v2, v3);
+    CacheUniformValue(name, glm::vec4(v0, v1, v2, v3));
 }
 
-void Shader::SetUniformMat3f(const std::string& name, const glm::mat3& matrix)
+void Shader::SetUniformMat3f(std::string_view name, const glm::mat3& matrix)
 {
     glUniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]);
-    m_UniformValueCache[name] = matrix;
+    CacheUniformValue(name, matrix);
 }
 
-void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
+void Shader::SetUniformMat4f(std::string_view name, const glm::mat4& matrix)
 {
     glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]);
-    m_UniformValueCache[name] = matrix;
+    CacheUniformValue(name, matrix);
 }
 
-void Shader::Reload(const std::string& vertexFilepath, const std::string& fragmentFilepath)
+int Shader::RegisterUniform(std::string_view name, bool cacheValue)
 {
-    std::cout << "Reloading shader: " << vertexFilepath << " and " << fragmentFilepath << std::endl;
-
-    if (m_RendererID != 0)
+    for (size_t i = 0; i < m_UniformSlots.size(); ++i)
     {
-        glDeleteProgram(m_RendererID);
-        m_RendererID = 0;
+        if (m_UniformSlots[i].Name == name)
+        {
+            m_UniformSlots[i].CacheValue |= cacheValue;
+            return (int)i;
+        }
     }
 
-    m_UniformLocationCache.clear();
+    UniformSlot slot;
+    slot.Name = std::string(name);
+    slot.Location = m_RendererID != 0 ? GetUniformLocation(name) : -1;
+    slot.CacheValue = cacheValue;
+    m_UniformSlots.push_back(std::move(slot));
 
-    std::optional<std::string> vertexSource = ParseShader(vertexFilepath);
-    std::optional<std::string> fragmentSource = ParseShader(fragmentFilepath);
-    if (!vertexSource || !fragmentSource) return;
-
-    m_RendererID = CreateShader(*vertexSource, *fragmentSource);
+    return (int)m_UniformSlots.size() - 1;
+}
 
-    if (m_RendererID != 0)
+void Shader::ResolveUniformSlots()
+{
+    for (UniformSlot& slot : m_UniformSlots)
     {
-        Bind();
+        slot.Location = GetUniformLocation(slot.Name);
 
-        for (const auto& pair : m_UniformValueCache)
+        if (slot.Location != -1 && slot.Value)
         {
-            const std::string& name = pair.first;
-            const UniformVariant& value = pair.second;
-            int location = GetUniformLocation(name);
+            std::visit([&](auto&& arg) { UploadUniform(slot.Location, &arg, 1); }, *slot.Value);
+        }
+    }
+}
 
-            if (location == -1) continue;
+void Shader::UploadUniform(int location, const int* v, int count)        { glProgramUniform1iv(m_RendererID, location, count, v); }
+void Shader::UploadUniform(int location, const glm::ivec2* v, int count) { glProgramUniform2iv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const glm::ivec3* v, int count) { glProgramUniform3iv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const glm::ivec4* v, int count) { glProgramUniform4iv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const float* v, int count)      { glProgramUniform1fv(m_RendererID, location, count, v); }
+void Shader::UploadUniform(int location, const glm::vec2* v, int count)  { glProgramUniform2fv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const glm::vec3* v, int count)  { glProgramUniform3fv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const glm::vec4* v, int count)  { glProgramUniform4fv(m_RendererID, location, count, &v[0][0]); }
+void Shader::UploadUniform(int location, const glm::mat3* v, int count)  { glProgramUniformMatrix3fv(m_RendererID, location, count, GL_FALSE, &v[0][0][0]); }
+void Shader::UploadUniform(int location, const glm::mat4* v, int count)  { glProgramUniformMatrix4fv(m_RendererID, location, count, GL_FALSE, &v[0][0][0]); }
+
+void Shader::Reload(ShaderBatch* batch)
+{
+    Build(true, batch);
+}
 
-            std::visit([&](auto&& arg) {
-                using T = std::decay_t<decltype(arg)>;
-                if constexpr (std::is_same_v<T, int>) {
-                    glUniform1i(location, arg);
-                }
-                else if constexpr (std::is_same_v<T, glm::ivec2>) {
-                    glUniform2i(location, arg.x, arg.y);
-                }
-                else if constexpr (std::is_same_v<T, glm::ivec3>) {
-                    glUniform3i(location, arg.x, arg.y, arg.z);
-                }
-                else if constexpr (std::is_same_v<T, glm::ivec4>) {
-                    glUniform4i(location, arg.x, arg.y, arg.z, arg.w);
-                }
-                else if constexpr (std::is_same_v<T, float>) {
-                    glUniform1f(location, arg);
-                }
-                else if constexpr (std::is_same_v<T, glm::vec2>) {
-                    glUniform2f(location, arg.x, arg.y);
-                }
-                else if constexpr (std::is_same_v<T, glm::vec3>) {
-                    glUniform3f(location, arg.x, arg.y, arg.z);
-                }
-                else if constexpr (std::is_same_v<T, glm::vec4>) {
-                    glUniform4f(location, arg.x, arg.y, arg.z, arg.w);
-                }
-                else if constexpr (std::is_same_v<T, glm::mat3>) {
-                    glUniformMatrix3fv(location, 1, GL_FALSE, &arg[0][0]);
-                }
-                else if constexpr (std::is_same_v<T, glm::mat4>) {
-                    glUniformMatrix4fv(location, 1, GL_FALSE, &arg[0][0]);
-                }
-            }, value);
+void Shader::RestoreUniforms()
+{
+    if (m_RendererID == 0) return;
+
+    for (const auto& pair : m_UniformValueCache)
+    {
+        std::string_view name = pair.first;
+        const UniformVariant& value = pair.second;
+        int location = GetUniformLocation(name);
+
+        if (location == -1) continue;
+
+        std::visit([&](auto&& arg) { UploadUniform(location, &arg, 1); }, value);
+    }
+
+    // handles keep their slot, only the locations move
+    ResolveUniformSlots();
+}
+
+Shader* ShaderPermutations::Get(const ShaderDefines& defines, ShaderBatch* batch)
+{
+    std::string key = GetShaderPermutationKey(defines);
+    auto it = m_Variants.find(key);
+    if (it != m_Variants.end()) return it->second.get();
+
+    std::unique_ptr<Shader> shader = m_ComputePath.empty()
+        ? std::make_unique<Shader>(m_VertPath, m_FragPath, defines, batch)
+        : std::make_unique<Shader>(m_ComputePath, defines, batch);
+
+    for (const auto& [name, cacheValue] : m_Uniforms) shader->RegisterUniform(name, cacheValue);
+
+    Shader* variant = shader.get();
+    m_Variants.emplace(std::move(key), std::move(shader));
+    return variant;
+}
+
+int ShaderPermutations::RegisterUniform(std::string_view name, bool cacheValue)
+{
+    int slot = -1;
+    for (size_t i = 0; i < m_Uniforms.size(); ++i)
+    {
+        if (m_Uniforms[i].first == name)
+        {
+            m_Uniforms[i].second |= cacheValue;
+            slot = (int)i;
+            break;
         }
     }
-}
\ No newline at end of file
+
+    if (slot < 0)
+    {
+        m_Uniforms.emplace_back(std::string(name), cacheValue);
+        slot = (int)m_Uniforms.size() - 1;
+    }
+
+    for (auto& [key, shader] : m_Variants) shader->RegisterUniform(name, cacheValue);
+    return slot;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <optional>
 #include <iostream>
@@ -9,6 +10,10 @@
 #include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <utility>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -28,43 +33,272 @@ using UniformVariant = std::variant<
     glm::mat4
 >;
 
+// lets the uniform caches be queried with a string_view without building a std::string
+struct StringHash
+{
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+template<typename T>
+using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+// index into a shader's uniform slot table, resolved once with Shader::GetUniform and kept
+// valid across Shader::Reload (only the slot's GL location changes)
+template<typename T>
+struct UniformHandle
+{
+    int Slot = -1;
+    bool IsValid() const { return Slot >= 0; }
+};
+
+class Shader;
+
+// name, value pairs the preprocessor writes as #defines below #version, see Shader::ParseShader
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// "NAME=VALUE;..." sorted by name, the same set gives the same key in any order
+std::string GetShaderPermutationKey(const ShaderDefines& defines);
+
+// builds several programs at once. every compile and link is issued up front and the statuses are
+// only read in Finish, with KHR_parallel_shader_compile the driver compiles them on its own threads
+// while the caller keeps loading. shaders added to a batch are invalid until Finish and have to
+// outlive it
+class ShaderBatch
+{
+
+public:
+    ShaderBatch();
+
+    void Add(Shader* shader);
+    // blocks until every program is linked and prints the wall clock time since construction
+    void Finish();
+    // finishes the programs the driver is done with and returns how many. only waits without
+    // driver compiler threads, then everything pending is finished
+    uint Poll();
+    bool IsEmpty() const { return m_Pending.empty(); }
+
+    // false finishes each shader as it is added, the old one at a time behaviour
+    static void SetParallel(bool parallel) { GetState().Parallel = parallel; }
+
+private:
+    struct State
+    {
+        bool Parallel = true;
+        bool Initialized = false;
+        bool DriverThreads = false;
+    };
+
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    std::vector<Shader*> m_Pending;
+    uint m_ProgramCount = 0;
+    std::chrono::steady_clock::time_point m_Start;
+};
+
 class Shader
 {
 
 public:
-    Shader(const std::string& vertPath, const std::string& fragPath);
+    Shader(const std::string& vertPath, const std::string& fragPath, ShaderBatch* batch = nullptr);
+    Shader(const std::string& vertPath, const std::string& fragPath, const ShaderDefines& defines, ShaderBatch* batch = nullptr);
+    explicit Shader(const std::string& computePath, ShaderBatch* batch = nullptr);
+    Shader(const std::string& computePath, const ShaderDefines& defines, ShaderBatch* batch = nullptr);
     ~Shader();
 
+    // written into every shader before its own defines, set before the first Shader is built
+    static void SetGlobalDefines(const ShaderDefines& defines) { GetGlobalDefines() = defines; }
+
     void Bind() const;
     void Unbind() const;
     bool IsValid() const;
 
-    void SetUniform1i(const std::string& name, int v);
-    void SetUniform2i(const std::string& name, int v0, int v1);
-    void SetUniform3i(const std::string& name, int v0, int v1, int v2);
-    void SetUniform4i(const std::string& name, int v0, int v1, int v2, int v3);
+    void SetUniform1i(std::string_view name, int v);
+    void SetUniform2i(std::string_view name, int v0, int v1);
+    void SetUniform3i(std::string_view name, int v0, int v1, int v2);
+    void SetUniform4i(std::string_view name, int v0, int v1, int v2, int v3);
 
-    void SetUniform1f(const std::string& name, float v);
-    void SetUniform2f(const std::string& name, float v0, float v1);
-    void SetUniform3f(const std::string& name, float v0, float v1, float v2);
-    void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
+    void SetUniform1f(std::string_view name, float v);
+    void SetUniform2f(std::string_view name, float v0, float v1);
+    void SetUniform3f(std::string_view name, float v0, float v1, float v2);
+    void SetUniform4f(std::string_view name, float v0, float v1, float v2, float v3);
 
-    void SetUniformMat3f(const std::string& name, const glm::mat3& matrix);
-    void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
+    void SetUniformMat3f(std::string_view name, const glm::mat3& matrix);
+    void SetUniformMat4f(std::string_view name, const glm::mat4& matrix);
+
+    // resolve a uniform once, cacheValue keeps the last value around so Reload can restore it
+    template<typename T>
+    UniformHandle<T> GetUniform(std::string_view name, bool cacheValue = false)
+    {
+        return UniformHandle<T>{ RegisterUniform(name, cacheValue) };
+    }
+
+    template<typename T>
+    void Set(UniformHandle<T> handle, const T& value)
+    {
+        if (!handle.IsValid()) return;
+        UniformSlot& slot = m_UniformSlots[handle.Slot];
+        if (slot.Location < 0) return;
+
+        UploadUniform(slot.Location, &value, 1);
+        if (slot.CacheValue) slot.Value = value;
+    }
+
+    // for uniform arrays, handle must point at element [0]. not value cached
+    template<typename T>
+    void Set(UniformHandle<T> handle, const T* values, int count)
+    {
+        if (!handle.IsValid()) return;
+        const UniformSlot& slot = m_UniformSlots[handle.Slot];
+        if (slot.Location < 0) return;
+
+        UploadUniform(slot.Location, values, count);
+    }
 
     inline uint GetRendererID() { return m_RendererID; }
+    const std::string& GetPermutationKey() const { return m_PermutationKey; }
+    // every file the last build read, includes too
+    const std::vector<std::string>& GetSourceFiles() const { return m_SourceFiles; }
+
+    // rebuilds from the paths it was created with. the current program stays bound and in use until
+    // the new one links, a failed compile or link keeps it
+    void Reload(ShaderBatch* batch = nullptr);
 
-    void Reload(const std::string& vertPath, const std::string& fragPath);
+    // every constructed shader, for reloading them all or by source file (see ShaderWatcher)
+    static const std::vector<Shader*>& GetLiveShaders() { return GetInstances(); }
 
 private:
+    friend class ShaderBatch;
+    friend class ShaderPermutations;
+
+    // preprocessed code, the #line source numbers index into Files
+    struct ShaderSource
+    {
+        std::string Code;
+        std::vector<std::string> Files;
+    };
+
+    struct StageSource
+    {
+        uint Type;
+        const ShaderSource* Source;
+    };
+
+    struct PendingStage
+    {
+        uint Type;
+        uint ID;
+        std::vector<std::string> Files;
+    };
+
+    // issued but not yet checked, see ShaderBatch
+    struct PendingProgram
+    {
+        uint Program = 0;
+        bool FromCache = false;
+        bool Reload = false;
+        uint64_t CacheKey = 0;
+        std::vector<PendingStage> Stages;
+        std::string Label;
+        std::chrono::steady_clock::time_point Start;
+    };
+
+    struct UniformSlot
+    {
+        std::string Name;
+        int Location;
+        bool CacheValue;
+        std::optional<UniformVariant> Value;
+    };
+
     uint m_RendererID;
+    PendingProgram m_Pending;
+
+    std::string m_VertPath;
+    std::string m_FragPath;
+    std::string m_ComputePath;
+    std::string m_Label;
+    std::vector<std::string> m_SourceFiles;
+
+    ShaderDefines m_Defines;
+    std::string m_PermutationKey;
+
+    std::vector<UniformSlot> m_UniformSlots;
+
+    StringMap<int> m_UniformLocationCache;
+    StringMap<UniformVariant> m_UniformValueCache;
+
+    void Build(bool reload, ShaderBatch* batch);
+    void IssueProgram(const std::vector<StageSource>& stages, bool reload, ShaderBatch* batch);
+    bool IsProgramComplete() const;
+    void FinishProgram();
+    void RestoreUniforms();
+
+    static ShaderDefines& GetGlobalDefines()
+    {
+        static ShaderDefines defines;
+        return defines;
+    }
 
-    std::unordered_map<std::string, int> m_UniformLocationCache;
-    std::unordered_map<std::string, UniformVariant> m_UniformValueCache;
+    static std::vector<Shader*>& GetInstances()
+    {
+        static std::vector<Shader*> instances;
+        return instances;
+    }
+
+    // false if a file couldn't be read, source.Files still lists what was
+    bool ParseShader(const std::string& filepath, ShaderSource& source);
+    int GetUniformLocation(std::string_view name);
+    void CacheUniformValue(std::string_view name, const UniformVariant& value);
+
+    int RegisterUniform(std::string_view name, bool cacheValue);
+    void ResolveUniformSlots();
+
+    void UploadUniform(int location, const int* v, int count);
+    void UploadUniform(int location, const glm::ivec2* v, int count);
+    void UploadUniform(int location, const glm::ivec3* v, int count);
+    void UploadUniform(int location, const glm::ivec4* v, int count);
+    void UploadUniform(int location, const float* v, int count);
+    void UploadUniform(int location, const glm::vec2* v, int count);
+    void UploadUniform(int location, const glm::vec3* v, int count);
+    void UploadUniform(int location, const glm::vec4* v, int count);
+    void UploadUniform(int location, const glm::mat3* v, int count);
+    void UploadUniform(int location, const glm::mat4* v, int count);
+};
+
+// one source built with several define sets (IBL vs main view, feature toggles). a variant is
+// compiled the first time it is asked for and kept, the binary cache keys on the preprocessed
+// source so every variant gets its own entry there too. handles from GetUniform are valid on
+// every variant, also ones built later
+class ShaderPermutations
+{
+
+public:
+    ShaderPermutations(const std::string& vertPath, const std::string& fragPath) : m_VertPath(vertPath), m_FragPath(fragPath) {}
+    explicit ShaderPermutations(const std::string& computePath) : m_ComputePath(computePath) {}
+
+    Shader* Get(const ShaderDefines& defines, ShaderBatch* batch = nullptr);
+
+    template<typename T>
+    UniformHandle<T> GetUniform(std::string_view name, bool cacheValue = false)
+    {
+        return UniformHandle<T>{ RegisterUniform(name, cacheValue) };
+    }
+
+    size_t GetVariantCount() const { return m_Variants.size(); }
+
+private:
+    std::string m_VertPath;
+    std::string m_FragPath;
+    std::string m_ComputePath;
 
-    uint CompileShader(uint type, const std::string& source);
-    uint CreateShader(const std::string& vert, const std::string& frag);
+    // every variant registers these in this order, so the slots line up
+    std::vector<std::pair<std::string, bool>> m_Uniforms;
+    StringMap<std::unique_ptr<Shader>> m_Variants;
 
-    std::optional<std::string> ParseShader(const std::string& filepath);
-    int GetUniformLocation(const std::string& name);
-};
\ No newline at end of file
+    int RegisterUniform(std::string_view name, bool cacheValue);
+};
@@ -0,0 +1,205 @@
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// 64 bit FNV-1a
+static uint64_t HashShaderCacheBytes(uint64_t hash, std::string_view bytes)
+{
+    for (char c : bytes)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool ShaderCache::Init()
+{
+    State& state = GetState();
+    if (state.Initialized) return state.Supported;
+    state.Initialized = true;
+
+    if (state.Directory.empty()) return false;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0)
+    {
+        std::cout << "Shader cache: the driver has no program binary formats, disabled" << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(state.Directory, error);
+    if (error)
+    {
+        std::cout << "Shader cache: can't create " << state.Directory << " (" << error.message() << "), disabled" << std::endl;
+        return false;
+    }
+
+    // separators so "ab" + "c" and "a" + "bc" differ
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const char* value = (const char*)glGetString(name);
+        hash = HashShaderCacheBytes(hash, value ? value : "");
+        hash = HashShaderCacheBytes(hash, std::string_view("\0", 1));
+    }
+    state.DriverHash = hash;
+    state.Supported = true;
+    return true;
+}
+
+uint64_t ShaderCache::GetKey(const std::vector<std::string_view>& sources)
+{
+    Init();
+    uint64_t hash = HashShaderCacheBytes(GetState().DriverHash, std::string_view((const char*)&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION)));
+    for (std::string_view source : sources)
+    {
+        hash = HashShaderCacheBytes(hash, source);
+        hash = HashShaderCacheBytes(hash, std::string_view("\0", 1));
+    }
+    return hash;
+}
+
+std::string ShaderCache::GetPath(uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(GetState().Directory) / name).string();
+}
+
+void ShaderCache::PrepareProgram(uint program)
+{
+    if (Init()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+uint ShaderCache::Load(uint64_t key)
+{
+    State& state = GetState();
+    if (!Init()) return 0;
+
+    auto start = std::chrono::steady_clock::now();
+    const std::string path = GetPath(key);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        state.Stats.Misses++;
+        return 0;
+    }
+
+    char magic[4];
+    uint32_t version = 0, format = 0, length = 0;
+    uint64_t storedKey = 0;
+    float compileMs = 0.0f;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&storedKey, sizeof(storedKey));
+    file.read((char*)&format, sizeof(format));
+    file.read((char*)&compileMs, sizeof(compileMs));
+    file.read((char*)&length, sizeof(length));
+
+    std::vector<char> binary;
+    bool valid = file && std::string_view(magic, 4) == "ESPB" && version == SHADER_CACHE_VERSION && storedKey == key && length > 0;
+    if (valid)
+    {
+        binary.resize(length);
+        valid = (bool)file.read(binary.data(), length);
+    }
+    file.close();
+
+    uint program = 0;
+    if (valid)
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), (GLsizei)length);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    if (!program)
+    {
+        // stale or from another driver build that hashes the same, compile and overwrite it
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        state.Stats.Rejected++;
+        state.Stats.Misses++;
+        return 0;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    state.Stats.Hits++;
+    state.Stats.LoadMs += ms;
+    state.Stats.SavedMs += compileMs - ms;
+    return program;
+}
+
+void ShaderCache::Store(uint64_t key, uint program, double compileMs)
+{
+    State& state = GetState();
+    state.Stats.CompileMs += compileMs;
+    if (!Init() || program == 0) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    // written next to the target and renamed, a crash halfway never leaves a truncated entry
+    const std::string path = GetPath(key);
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        uint32_t version = SHADER_CACHE_VERSION;
+        uint32_t binaryFormat = format;
+        uint32_t binaryLength = (uint32_t)length;
+        float ms = (float)compileMs;
+        file.write("ESPB", 4);
+        file.write((const char*)&version, sizeof(version));
+        file.write((const char*)&key, sizeof(key));
+        file.write((const char*)&binaryFormat, sizeof(binaryFormat));
+        file.write((const char*)&ms, sizeof(ms));
+        file.write((const char*)&binaryLength, sizeof(binaryLength));
+        file.write(binary.data(), length);
+        if (!file.good())
+        {
+            std::cout << "Shader cache: failed writing " << temporary << std::endl;
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+    state.Stats.Written++;
+}
+
+void ShaderCache::PrintStats()
+{
+    const State& state = GetState();
+    if (!state.Supported) return;
+
+    const ShaderCacheStats& stats = state.Stats;
+    std::printf("Shader cache: %u hits, %u misses (%u rejected), %.1f ms loading, %.1f ms compiling, ~%.1f ms saved\n",
+                stats.Hits, stats.Misses, stats.Rejected, stats.LoadMs, stats.CompileMs, stats.SavedMs);
+    std::fflush(stdout);
+}
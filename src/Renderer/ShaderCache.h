@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../Types.h"
+
+// linked programs saved with glGetProgramBinary, one file per program in the cache directory.
+// the key hashes the sources as they are handed to the compiler plus the GL vendor, renderer and
+// version, so a driver update or an edited shader simply misses. a binary the driver refuses is
+// deleted and the program compiled again
+//   file: "ESPB" u32 version, u64 key, u32 binary format, f32 compile ms, u32 length, binary
+
+constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheStats
+{
+    uint Hits = 0;
+    uint Misses = 0;
+    uint Rejected = 0;      // found but the driver didn't take it (counted as a miss too)
+    uint Written = 0;
+    double LoadMs = 0.0;    // spent loading hits
+    double CompileMs = 0.0; // spent compiling misses
+    double SavedMs = 0.0;   // what the hits took to compile when they were stored, minus LoadMs
+};
+
+class ShaderCache
+{
+
+public:
+    // empty disables the cache. set before the first Shader is built
+    static void SetDirectory(const std::string& directory) { GetState().Directory = directory; }
+
+    static uint64_t GetKey(const std::vector<std::string_view>& sources);
+
+    // a linked program, or 0 on a miss
+    static uint Load(uint64_t key);
+    // call on a freshly linked program built with PrepareProgram
+    static void Store(uint64_t key, uint program, double compileMs);
+    // before linking, so the driver keeps the binary around
+    static void PrepareProgram(uint program);
+
+    static const ShaderCacheStats& GetStats() { return GetState().Stats; }
+    static void PrintStats();
+
+private:
+    struct State
+    {
+        std::string Directory = "shader_cache";
+        bool Initialized = false;
+        bool Supported = false;
+        uint64_t DriverHash = 0;
+        ShaderCacheStats Stats;
+    };
+
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    // needs a current context, done on first use
+    static bool Init();
+    static std::string GetPath(uint64_t key);
+};
@@ -0,0 +1,161 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Core/Profiler.h"
+
+// the shaders name their files relative to the working directory and inotify relative to the
+// watched one, both sides are compared canonical
+static std::string CanonicalShaderPath(const std::filesystem::path& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return (error ? path.lexically_normal() : canonical).generic_string();
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    Stop();
+}
+
+bool ShaderWatcher::Start(const std::string& directory)
+{
+    Stop();
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        std::cout << "Shader watcher: " << directory << " is not a directory" << std::endl;
+        return false;
+    }
+
+#ifdef __linux__
+    m_Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_Notify >= 0)
+    {
+        // not recursive, every directory gets its own watch. editors either write in place
+        // (close_write) or write a temporary and rename it over the file (moved_to)
+        std::vector<std::filesystem::path> directories = { directory };
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+            if (entry.is_directory()) directories.push_back(entry.path());
+
+        for (const std::filesystem::path& path : directories)
+        {
+            int watch = inotify_add_watch(m_Notify, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (watch >= 0) m_Watches[watch] = path;
+        }
+    }
+    else
+    {
+        std::cout << "Shader watcher: inotify unavailable, polling instead" << std::endl;
+    }
+#endif
+
+    // the first poll only records the timestamps
+    m_LastPoll = std::chrono::steady_clock::time_point();
+    if (m_Notify < 0) ReadChanges();
+
+    m_Batch = std::make_unique<ShaderBatch>();
+    std::cout << "Shader watcher: watching " << directory << (m_Notify >= 0 ? " (inotify)" : " (polling)") << std::endl;
+    return true;
+}
+
+// reloads still pending are dropped, the shaders keep their current programs
+void ShaderWatcher::Stop()
+{
+#ifdef __linux__
+    if (m_Notify >= 0) close(m_Notify);
+#endif
+    m_Notify = -1;
+    m_Watches.clear();
+    m_Timestamps.clear();
+    m_Batch.reset();
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::ReadChanges()
+{
+    std::vector<std::filesystem::path> changes;
+
+#ifdef __linux__
+    if (m_Notify >= 0)
+    {
+        alignas(inotify_event) char buffer[4096];
+        for (;;)
+        {
+            // nonblocking, -1 with EAGAIN once the queue is empty
+            ssize_t length = read(m_Notify, buffer, sizeof(buffer));
+            if (length <= 0) break;
+
+            for (char* p = buffer; p < buffer + length;)
+            {
+                const inotify_event* event = (const inotify_event*)p;
+                auto it = m_Watches.find(event->wd);
+                if (it != m_Watches.end() && event->len > 0) changes.push_back(it->second / event->name);
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changes;
+    }
+#endif
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_LastPoll < std::chrono::milliseconds(500)) return changes;
+    m_LastPoll = now;
+
+    for (Shader* shader : Shader::GetLiveShaders())
+    {
+        for (const std::string& file : shader->GetSourceFiles())
+        {
+            std::error_code error;
+            auto time = std::filesystem::last_write_time(file, error);
+            if (error) continue;
+
+            auto [it, inserted] = m_Timestamps.try_emplace(file, time);
+            if (inserted || it->second == time) continue;
+            it->second = time;
+            changes.push_back(file);
+        }
+    }
+    return changes;
+}
+
+uint ShaderWatcher::Update()
+{
+    if (!m_Batch) return 0;
+    PROFILE_SCOPE("Shader Watcher");
+
+    std::vector<std::filesystem::path> changes = ReadChanges();
+    if (!changes.empty())
+    {
+        std::vector<std::string> changed;
+        for (const std::filesystem::path& path : changes) changed.push_back(CanonicalShaderPath(path));
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+        uint reloads = 0;
+        for (Shader* shader : Shader::GetLiveShaders())
+        {
+            const std::vector<std::string>& files = shader->GetSourceFiles();
+            bool affected = std::any_of(files.begin(), files.end(), [&](const std::string& file) {
+                return std::binary_search(changed.begin(), changed.end(), CanonicalShaderPath(file));
+            });
+            if (!affected) continue;
+
+            shader->Reload(m_Batch.get());
+            reloads++;
+        }
+
+        if (reloads > 0)
+            std::cout << "Shader watcher: " << changed.front() << (changed.size() > 1 ? " and others" : "")
+                      << " changed, reloading " << reloads << (reloads == 1 ? " program" : " programs") << std::endl;
+    }
+
+    return m_Batch->Poll();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Types.h"
+#include "Shader.h"
+
+// reloads the shaders whose files changed on disk, includes count. inotify on linux, elsewhere the
+// timestamps of the files the live shaders read are compared twice a second. the recompiles go into
+// a batch that is only polled, a frame doesn't wait for the compiler (unless the driver has no
+// parallel compile) and the old program keeps running until the new one links
+class ShaderWatcher
+{
+
+public:
+    ShaderWatcher() = default;
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // directory and everything below it, needs a current context
+    bool Start(const std::string& directory);
+    void Stop();
+    bool IsRunning() const { return m_Batch != nullptr; }
+
+    // once a frame, returns how many reloads finished (swapped in or failed)
+    uint Update();
+
+private:
+    std::unique_ptr<ShaderBatch> m_Batch;
+
+    // inotify descriptor and watch descriptor -> directory
+    int m_Notify = -1;
+    std::unordered_map<int, std::filesystem::path> m_Watches;
+
+    // timestamp fallback
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_Timestamps;
+    std::chrono::steady_clock::time_point m_LastPoll;
+
+    std::vector<std::filesystem::path> ReadChanges();
+};
@@ -0,0 +1,138 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+
+ShadowAtlas::~ShadowAtlas()
+{
+    if (m_FBO) glDeleteFramebuffers(1, &m_FBO);
+    if (m_Texture) glDeleteTextures(1, &m_Texture);
+}
+
+void ShadowAtlas::Init(uint size, uint minTileSize)
+{
+    m_Size = std::bit_ceil(size);
+    m_MinTileSize = std::min(std::bit_ceil(minTileSize), m_Size);
+    m_Levels = std::countr_zero(m_Size / m_MinTileSize) + 1;
+
+    // level l has 4^l nodes, level 0 is the whole atlas
+    m_LevelOffsets.resize(m_Levels);
+    uint offset = 0;
+    for (uint level = 0; level < m_Levels; ++level)
+    {
+        m_LevelOffsets[level] = offset;
+        offset += 1u << (2 * level);
+    }
+    m_Nodes.assign(offset, NodeState::Free);
+    m_AllocatedTiles = 0;
+    m_AllocatedTexels = 0;
+
+    glGenTextures(1, &m_Texture);
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, m_Size, m_Size);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenFramebuffers(1, &m_FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_Texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Shadow Atlas Framebuffer not complete!" << std::endl;
+
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+int ShadowAtlas::AllocateNode(uint level, uint x, uint y, uint targetLevel, bool allowSplit)
+{
+    uint index = NodeIndex(level, x, y);
+    NodeState& state = m_Nodes[index];
+
+    if (state == NodeState::Used) return -1;
+
+    if (level == targetLevel)
+    {
+        if (state != NodeState::Free) return -1;
+        state = NodeState::Used;
+        return (int)index;
+    }
+
+    if (state == NodeState::Free)
+    {
+        if (!allowSplit) return -1;
+        state = NodeState::Split;
+        for (uint i = 0; i < 4; ++i) m_Nodes[NodeIndex(level + 1, x * 2 + (i & 1), y * 2 + (i >> 1))] = NodeState::Free;
+    }
+
+    for (uint i = 0; i < 4; ++i)
+    {
+        int node = AllocateNode(level + 1, x * 2 + (i & 1), y * 2 + (i >> 1), targetLevel, allowSplit);
+        if (node >= 0) return node;
+    }
+
+    // a node split just now stays split with four free children, merge it back
+    bool allFree = true;
+    for (uint i = 0; i < 4; ++i) allFree &= m_Nodes[NodeIndex(level + 1, x * 2 + (i & 1), y * 2 + (i >> 1))] == NodeState::Free;
+    if (allFree) state = NodeState::Free;
+    return -1;
+}
+
+ShadowAtlasTile ShadowAtlas::Allocate(uint size)
+{
+    ShadowAtlasTile tile;
+    if (m_Nodes.empty()) return tile;
+
+    size = std::clamp(std::bit_ceil(size), m_MinTileSize, m_Size);
+    uint level = std::countr_zero(m_Size / size);
+
+    // fill holes in already split nodes first, that keeps big nodes free for big requests
+    int node = AllocateNode(0, 0, 0, level, false);
+    if (node < 0) node = AllocateNode(0, 0, 0, level, true);
+    if (node < 0) return tile;
+
+    uint local = node - m_LevelOffsets[level];
+    uint perRow = 1u << level;
+    tile.Node = node;
+    tile.Size = size;
+    tile.X = (local % perRow) * size;
+    tile.Y = (local / perRow) * size;
+
+    m_AllocatedTiles++;
+    m_AllocatedTexels += (size_t)size * size;
+    return tile;
+}
+
+void ShadowAtlas::Free(ShadowAtlasTile& tile)
+{
+    if (!tile.IsValid()) return;
+
+    uint level = std::countr_zero(m_Size / tile.Size);
+    uint x = tile.X / tile.Size, y = tile.Y / tile.Size;
+    m_Nodes[NodeIndex(level, x, y)] = NodeState::Free;
+
+    // merge buddies while all four siblings are free
+    while (level > 0)
+    {
+        uint px = x / 2, py = y / 2;
+        bool allFree = true;
+        for (uint i = 0; i < 4; ++i) allFree &= m_Nodes[NodeIndex(level, px * 2 + (i & 1), py * 2 + (i >> 1))] == NodeState::Free;
+        if (!allFree) break;
+
+        level--;
+        x = px;
+        y = py;
+        m_Nodes[NodeIndex(level, x, y)] = NodeState::Free;
+    }
+
+    m_AllocatedTiles--;
+    m_AllocatedTexels -= (size_t)tile.Size * tile.Size;
+    tile = ShadowAtlasTile();
+}
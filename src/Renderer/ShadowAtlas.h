@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "../Types.h"
+
+struct ShadowAtlasTile
+{
+    int Node = -1;
+    uint X = 0, Y = 0, Size = 0;    // texels
+
+    bool IsValid() const { return Node >= 0; }
+};
+
+// one big depth texture shared by every shadowed point and spot light. tiles are square powers of
+// two handed out by a quadtree: a request takes a free node of its size, splitting larger ones
+// only when no already split parent has room, and freeing a tile merges buddies back up
+class ShadowAtlas
+{
+
+public:
+    ShadowAtlas() = default;
+    ~ShadowAtlas();
+
+    ShadowAtlas(const ShadowAtlas&) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas&) = delete;
+
+    void Init(uint size, uint minTileSize);
+
+    // size is rounded up to a power of two and clamped to [minTileSize, atlas size]
+    ShadowAtlasTile Allocate(uint size);
+    void Free(ShadowAtlasTile& tile);
+
+    uint GetSize() const { return m_Size; }
+    uint GetMinTileSize() const { return m_MinTileSize; }
+    uint GetTexture() const { return m_Texture; }
+    uint GetFramebuffer() const { return m_FBO; }
+
+    uint GetAllocatedTiles() const { return m_AllocatedTiles; }
+    float GetOccupancy() const { return m_Size ? (float)m_AllocatedTexels / ((float)m_Size * m_Size) : 0.0f; }
+
+private:
+    enum class NodeState : uint8_t { Free, Split, Used };
+
+    uint m_Size = 0;
+    uint m_MinTileSize = 0;
+    uint m_Levels = 0;
+    std::vector<uint> m_LevelOffsets;
+    std::vector<NodeState> m_Nodes;
+
+    uint m_AllocatedTiles = 0;
+    size_t m_AllocatedTexels = 0;
+
+    uint m_Texture = 0;
+    uint m_FBO = 0;
+
+    uint NodeIndex(uint level, uint x, uint y) const { return m_LevelOffsets[level] + y * (1u << level) + x; }
+    int AllocateNode(uint level, uint x, uint y, uint targetLevel, bool allowSplit);
+
+};
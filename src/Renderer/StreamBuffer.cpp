@@ -0,0 +1,90 @@
+#include "StreamBuffer.h"
+
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+StreamBuffer::StreamBuffer(uint target, uint binding, size_t size, uint framesInFlight)
+    : m_Target(target), m_Binding(binding), m_Size(size), m_RegionCount(framesInFlight)
+{
+    GLint alignment = 256;
+    if (target == GL_UNIFORM_BUFFER) glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    else if (target == GL_SHADER_STORAGE_BUFFER) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+
+    m_RegionSize = (size + alignment - 1) / alignment * alignment;
+    m_Fences.resize(m_RegionCount, nullptr);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(m_Target, m_Buffer);
+    glBufferStorage(m_Target, m_RegionSize * m_RegionCount, nullptr, flags);
+    m_Mapped = static_cast<std::byte*>(glMapBufferRange(m_Target, 0, m_RegionSize * m_RegionCount, flags));
+    glBindBuffer(m_Target, 0);
+
+    if (!m_Mapped)
+        std::cerr << "failed to persistently map stream buffer (binding " << m_Binding << ")" << std::endl;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (GLsync fence : m_Fences)
+    {
+        if (fence) glDeleteSync(fence);
+    }
+
+    if (m_Buffer != 0)
+    {
+        glBindBuffer(m_Target, m_Buffer);
+        glUnmapBuffer(m_Target);
+        glBindBuffer(m_Target, 0);
+        glDeleteBuffers(1, &m_Buffer);
+    }
+}
+
+void StreamBuffer::WaitForRegion(uint region)
+{
+    GLsync& fence = m_Fences[region];
+    if (!fence) return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+    {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void* StreamBuffer::Map()
+{
+    if (!m_Mapped) return nullptr;
+
+    WaitForRegion(m_Region);
+    return m_Mapped + m_Region * m_RegionSize;
+}
+
+void StreamBuffer::Bind(size_t size)
+{
+    glBindBufferRange(m_Target, m_Binding, m_Buffer, m_Region * m_RegionSize, std::min(size, m_Size));
+}
+
+void StreamBuffer::Upload(const void* data, size_t size)
+{
+    void* dest = Map();
+    if (!dest) return;
+
+    size = std::min(size, m_Size);
+    std::memcpy(dest, data, size);
+    Bind(size);
+}
+
+void StreamBuffer::EndFrame()
+{
+    if (m_Fences[m_Region]) glDeleteSync(m_Fences[m_Region]);
+    m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_Region = (m_Region + 1) % m_RegionCount;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "../Types.h"
+
+// persistently mapped buffer split into one region per frame in flight.
+// Upload() writes the current region and binds it to the indexed binding point,
+// EndFrame() fences the region and moves on. writing a region waits for its fence
+// so the CPU never stomps on data the GPU is still reading.
+// meant for data written once per frame, uploading twice in one frame reuses the same region.
+class StreamBuffer
+{
+
+public:
+    StreamBuffer(uint target, uint binding, size_t size, uint framesInFlight = 3);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    void Upload(const void* data, size_t size);
+
+    template<typename T>
+    void Upload(const T& data) { Upload(&data, sizeof(T)); }
+
+    // mapped pointer of this frame's region, for callers that fill the data in place.
+    // call Bind() afterwards
+    void* Map();
+    void Bind(size_t size);
+
+    void EndFrame();
+
+    size_t GetSize() const { return m_Size; }
+    uint GetID() const { return m_Buffer; }
+
+private:
+    uint m_Buffer = 0;
+    uint m_Target;
+    uint m_Binding;
+
+    size_t m_Size;
+    size_t m_RegionSize;
+    uint m_RegionCount;
+    uint m_Region = 0;
+
+    std::byte* m_Mapped = nullptr;
+    std::vector<GLsync> m_Fences;
+
+    void WaitForRegion(uint region);
+};
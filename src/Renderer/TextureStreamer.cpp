@@ -0,0 +1,55 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Core/Profiler.h"
+
+RenderTexture* TextureStreamer::Get(const Texture* texture)
+{
+    auto it = m_Textures.find(texture);
+    if (it == m_Textures.end()) it = m_Textures.emplace(texture, std::make_unique<RenderTexture>(*texture, m_Enabled)).first;
+    return it->second.get();
+}
+
+void TextureStreamer::Request(const Texture* texture, float pixels)
+{
+    RenderTexture* gpuTexture = Get(texture);
+
+    // a level of margin, the samplers have a -0.6 lod bias and surfaces at an angle want more
+    // than the average density
+    float size = (float)std::max(gpuTexture->GetWidth(), gpuTexture->GetHeight());
+    float level = std::log2(size / std::max(pixels, 1.0f)) - 1.0f;
+    gpuTexture->Request((int)std::floor(std::max(level, 0.0f)));
+}
+
+void TextureStreamer::BeginFrame()
+{
+    for (auto& [source, texture] : m_Textures) texture->ResetRequest();
+}
+
+void TextureStreamer::Update()
+{
+    PROFILE_SCOPE("Texture Streaming");
+    m_UploadedBytes = 0;
+
+    m_Pending.clear();
+    for (auto& [source, texture] : m_Textures)
+        if (texture->GetRequestedLevel() < texture->GetResidentLevel()) m_Pending.push_back(texture.get());
+
+    // furthest from its request first
+    std::sort(m_Pending.begin(), m_Pending.end(), [](const RenderTexture* a, const RenderTexture* b) {
+        return a->GetResidentLevel() - a->GetRequestedLevel() > b->GetResidentLevel() - b->GetRequestedLevel();
+    });
+
+    for (RenderTexture* texture : m_Pending)
+    {
+        while (m_UploadedBytes < m_Budget)
+        {
+            size_t bytes = texture->StreamLevel(m_Budget - m_UploadedBytes);
+            if (bytes == 0) break;
+            m_UploadedBytes += bytes;
+        }
+        if (m_UploadedBytes >= m_Budget) break;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../Types.h"
+#include "RenderTexture.h"
+
+// the renderer's material textures. draws ask for a level from their size on screen, Update
+// uploads towards the requests within a per frame byte budget, the largest shortfall first
+class TextureStreamer
+{
+
+public:
+    // created (tail resident) the first time a texture is seen
+    RenderTexture* Get(const Texture* texture);
+
+    // pixels is roughly how many pixels the texture is stretched over on screen
+    void Request(const Texture* texture, float pixels);
+
+    // before the draws of a frame make their requests
+    void BeginFrame();
+    void Update();
+    void Clear() { m_Textures.clear(); }
+
+    // false creates every texture fully resident, for reproducible images
+    void SetEnabled(bool enabled) { m_Enabled = enabled; }
+    bool IsEnabled() const { return m_Enabled; }
+
+    void SetBudget(size_t bytes) { m_Budget = bytes; }
+    size_t GetBudget() const { return m_Budget; }
+    size_t GetUploadedBytes() const { return m_UploadedBytes; }
+    const std::unordered_map<const Texture*, std::unique_ptr<RenderTexture>>& GetTextures() const { return m_Textures; }
+
+private:
+    std::unordered_map<const Texture*, std::unique_ptr<RenderTexture>> m_Textures;
+    bool m_Enabled = true;
+    size_t m_Budget = 8 * 1024 * 1024;  // bytes per frame
+    size_t m_UploadedBytes = 0;         // last Update
+
+    std::vector<RenderTexture*> m_Pending;  // kept so Update doesn't allocate
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// CPU mirrors of the std140 blocks / std430 buffers declared in the shaders.
+// keep member order and padding in sync with the GLSL side, vec3s are stored as vec4.
+
+// must match the array sizes in lighting.frag / atmosphere.frag
+constexpr int MAX_CASCADES = 16;
+
+// clustered lighting grid, must match the defines in lighting.frag
+constexpr int CLUSTER_X = 16;
+constexpr int CLUSTER_Y = 9;
+constexpr int CLUSTER_Z = 24;
+constexpr int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+constexpr int MAX_CLUSTERED_POINT_LIGHTS = 8192;
+constexpr int MAX_CLUSTERED_SPOT_LIGHTS = 1024;
+constexpr int MAX_CLUSTER_LIGHT_INDICES = 512 * 1024;
+
+// shadow atlas for point and spot lights, a point light takes 6 tiles
+constexpr int SHADOW_ATLAS_SIZE = 4096;
+constexpr int SHADOW_ATLAS_MIN_TILE = 128;
+constexpr int MAX_LOCAL_SHADOW_TILES = 256;
+
+// sky-view LUT, injected into the shaders as defines
+constexpr int SKY_VIEW_LUT_WIDTH = 192;
+constexpr int SKY_VIEW_LUT_HEIGHT = 108;
+
+// camera aligned volume for aerial perspective and light shafts, must match the froxel shaders
+constexpr int FROXEL_X = 160;
+constexpr int FROXEL_Y = 90;
+constexpr int FROXEL_Z = 64;
+
+enum UniformBlockBinding : unsigned int
+{
+    FrameBlockBinding = 0,
+    CascadeBlockBinding = 1,
+};
+
+enum StorageBufferBinding : unsigned int
+{
+    PointLightBufferBinding = 0,
+    SpotLightBufferBinding = 1,
+    ClusterBufferBinding = 2,
+    LightIndexBufferBinding = 3,
+    LocalShadowBufferBinding = 4,
+};
+
+struct FrameBlock
+{
+    glm::mat4 View;
+    glm::mat4 Projection;
+    glm::mat4 InvView;
+    glm::mat4 InvProjection;
+    glm::mat4 ViewProj;
+    glm::mat4 InvViewProj;
+    glm::vec4 CameraPosition;
+    glm::vec4 SunDirection;
+    glm::vec4 SunColor;     // rgb color, a intensity
+    glm::vec4 ScreenSize;   // width, height, 1/width, 1/height
+    glm::vec4 Params;       // x exposure, y near, z far
+};
+
+struct CascadeBlock
+{
+    glm::mat4 Matrices[MAX_CASCADES];
+    glm::vec4 PlaneDistances[MAX_CASCADES]; // far distance in x, std140 pads float arrays to vec4 anyway
+    int Count;
+    int _pad[3];
+};
+
+struct PointLightData
+{
+    glm::vec4 Position;     // xyz position, w radius of influence
+    glm::vec4 Color;        // rgb color, a intensity
+    glm::vec4 Attenuation;  // constant, linear, quadratic, w first local shadow tile or -1
+};
+
+struct SpotLightData
+{
+    glm::vec4 Position;     // xyz position, w radius of influence
+    glm::vec4 Direction;
+    glm::vec4 Color;        // rgb color, a intensity
+    glm::vec4 Cone;         // cos inner, cos outer, constant attenuation, w local shadow tile or -1
+};
+
+// one per shadow atlas tile, point lights use six in a row (+x, -x, +y, -y, +z, -z)
+struct LocalShadowData
+{
+    glm::mat4 ViewProj;
+    glm::vec4 AtlasRect;    // xy offset, zw size, atlas uv. zero size while the tile has never been rendered
+};
+
+// one per cluster, indexes into the light index buffer: points first, then spots
+struct ClusterData
+{
+    unsigned int Offset;
+    unsigned int PointCount;
+    unsigned int SpotCount;
+    unsigned int _pad;
+};
+
+static_assert(sizeof(FrameBlock) == 464, "FrameBlock does not match std140 layout");
+static_assert(sizeof(CascadeBlock) == 1296, "CascadeBlock does not match std140 layout");
+static_assert(sizeof(PointLightData) == 48, "PointLightData does not match std430 layout");
+static_assert(sizeof(SpotLightData) == 64, "SpotLightData does not match std430 layout");
+static_assert(sizeof(LocalShadowData) == 80, "LocalShadowData does not match std430 layout");
@@ -10,6 +10,7 @@ void Entity::UpdateTransform()
     trans = glm::rotate(trans, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
     trans = glm::scale(trans, scale);
     transform = trans;
+    transformVersion++;
 }
 
 void Entity::SetPosition(const glm::vec3& pos)
@@ -23,6 +23,11 @@ public:
 	glm::vec3 rotation = glm::vec3(0.0f);
 	glm::vec3 scale = glm::vec3(1.0f);
 
+	// static entities are drawn once into the cached shadow maps, moving one anyway still works
+	// (transformVersion changes and the cascades it touches get re-rendered) but costs a full redraw
+	bool isStatic = false;
+	uint transformVersion = 0;
+
 	void SetPosition(const glm::vec3& pos);
 	void SetRotation(const glm::vec3& rot);
 	void SetScale(const glm::vec3& scl);
@@ -82,6 +82,13 @@ void Material::PackARM(Texture ao, Texture rough, Texture metal)
     }
 }
 
+void Material::GenerateMips()
+{
+    if (DiffuseTexture) DiffuseTexture->GenerateMips({ TextureUsage::Albedo, AlphaMasked });
+    if (NormalTexture) NormalTexture->GenerateMips({ TextureUsage::Normal, false });
+    if (ARMTexture) ARMTexture->GenerateMips({ TextureUsage::Data, false });
+}
+
 void Material::SetAO(Texture t)
 {
     BlitChannel(t, 0, 255); 
@@ -116,6 +123,7 @@ void Material::SetAlphaMask(Texture mask)
     }
 
     Translucent = true; 
+    AlphaMasked = true;
 }
 
 void Material::EnsureDiffuseRGBA()
@@ -11,6 +11,7 @@ class Material
 public:
     bool Translucent;
     float Dissolve;
+    bool AlphaMasked = false;   // map_d went into the diffuse alpha, its mips keep the coverage
 
     std::unique_ptr<Texture> DiffuseTexture;
     std::unique_ptr<Texture> NormalTexture;
@@ -31,6 +32,9 @@ public:
 
     void PackARM(Texture AO, Texture rough, Texture metal);
 
+    // once every map is set, each texture filtered for what it holds (see TextureMips.h)
+    void GenerateMips();
+
 private:
     void BlitChannel(const Texture& src, int destChannelIdx, uchar defaultValue);
     
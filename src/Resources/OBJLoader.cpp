@@ -8,6 +8,16 @@
 #include <filesystem>
 #include <charconv>
 #include <cstring>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "Core/Profiler.h"
+#include "TextureCache.h"
 
 struct VertexKey
 {
@@ -112,6 +122,7 @@ static std::string ParseTexturePath(const char*& p, const char* end, const std::
 
 void OBJLoader::ParseMTL(const std::string& filepath, std::vector<std::shared_ptr<Material>>& materials, std::unordered_map<std::string, int>& matMap)
 {
+    PROFILE_SCOPE("MTL Parse");
     std::ifstream file(filepath);
     if (!file.is_open()) return;
 
@@ -216,6 +227,95 @@ void OBJLoader::ParseMTL(const std::string& filepath, std::vector<std::shared_pt
     }
 }
 
+// hardware_concurrency threads started on the first load and kept until exit. every thread the
+// profiler sees keeps its event ring for good, a new set of threads per load would leak those
+class MipWorkers
+{
+
+public:
+    static MipWorkers& Get()
+    {
+        static MipWorkers workers;
+        return workers;
+    }
+
+    size_t GetCount() const { return m_Threads.size(); }
+
+    std::future<void> Submit(std::function<void()> job)
+    {
+        auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+        std::future<void> done = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.push_back([task] { (*task)(); });
+        }
+        m_Wake.notify_one();
+        return done;
+    }
+
+private:
+    std::vector<std::thread> m_Threads;
+    std::deque<std::function<void()>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Stop = false;
+
+    MipWorkers()
+    {
+        const uint count = std::max(1u, std::thread::hardware_concurrency());
+        for (uint i = 0; i < count; ++i) m_Threads.emplace_back([this] { Run(); });
+    }
+
+    ~MipWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_all();
+        for (std::thread& thread : m_Threads) thread.join();
+    }
+
+    void Run()
+    {
+        Profiler::SetThreadName("Mip Worker");
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+                if (m_Jobs.empty()) return;
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+// the mip chains of every material on the mip workers, each pulling the next material off a
+// shared index. started once parsing is done, they overlap the submesh grouping and the
+// normal / tangent passes
+static std::vector<std::future<void>> StartMaterialMips(const std::vector<std::shared_ptr<Material>>& materials)
+{
+    std::vector<std::future<void>> jobs;
+    if (materials.empty()) return jobs;
+
+    MipWorkers& workers = MipWorkers::Get();
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    const size_t count = std::min(materials.size(), workers.GetCount());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        jobs.push_back(workers.Submit([materials, next] {
+            PROFILE_SCOPE("Material Mips");
+            for (size_t m = (*next)++; m < materials.size(); m = (*next)++) materials[m]->GenerateMips();
+        }));
+    }
+    return jobs;
+}
+
 std::string OBJLoader::GetBaseDir(const std::string& filepath)
 {
     std::filesystem::path p(filepath);
@@ -226,6 +326,7 @@ void OBJLoader::ParseVertexIndex(const std::string& token, std::vector<unsigned
 
 LoadResult OBJLoader::Load(const std::string& filepath)
 {
+    PROFILE_SCOPE("OBJ Load");
     std::cout << " [OBJ DEBUG] Loading (Grouped by Material): " << filepath << std::endl;
     auto start_time = std::chrono::steady_clock::now();
 
@@ -430,6 +531,8 @@ LoadResult OBJLoader::Load(const std::string& filepath)
         }
     }
 
+    std::vector<std::future<void>> mipJobs = StartMaterialMips(result.materials);
+
     result.mesh->Indices.clear();
     
     // group submeshs per material
@@ -458,6 +561,11 @@ LoadResult OBJLoader::Load(const std::string& filepath)
     result.mesh->RecalculateNormals();
     result.mesh->RecalculateTangents();
 
+    {
+        PROFILE_SCOPE("Wait Material Mips");
+        for (std::future<void>& job : mipJobs) job.wait();
+    }
+
     auto end_time = std::chrono::steady_clock::now();
     long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 
@@ -468,6 +576,7 @@ LoadResult OBJLoader::Load(const std::string& filepath)
     std::cout << "  SubMeshes: " << result.mesh->SubMeshes.size() << std::endl;
     std::cout << "  Materials: " << result.materials.size() << std::endl;
     std::cout << "==================================================" << std::endl;
+    TextureCache::PrintStats();
 
     return result;
 }
\ No newline at end of file
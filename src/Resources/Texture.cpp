@@ -2,8 +2,11 @@
 
 #include <stb_image.h>
 
+#include <chrono>
 #include <iostream>
 
+#include "TextureCache.h"
+
 Texture::Texture(const std::string& filepath)
 {
     Load(filepath);
@@ -32,11 +35,13 @@ Texture::Texture(Texture&& other) noexcept
     m_Width = other.m_Width;
     m_Height = other.m_Height;
     m_Channels = other.m_Channels;
+    m_Mips = std::move(other.m_Mips);
 
     other.m_LocalBuffer = nullptr;
     other.m_Width = 0;
     other.m_Height = 0;
     other.m_Channels = 0;
+    other.m_Mips.clear();
 }
 
 Texture& Texture::operator=(Texture&& other) noexcept
@@ -49,11 +54,13 @@ Texture& Texture::operator=(Texture&& other) noexcept
         m_Width = other.m_Width;
         m_Height = other.m_Height;
         m_Channels = other.m_Channels;
+        m_Mips = std::move(other.m_Mips);
 
         other.m_LocalBuffer = nullptr;
         other.m_Width = 0;
         other.m_Height = 0;
         other.m_Channels = 0;
+        other.m_Mips.clear();
     }
 
     return *this;
@@ -101,8 +108,29 @@ void Texture::Load(const std::string& path)
     }
 }
 
+void Texture::GenerateMips(const MipSettings& settings)
+{
+    if (!m_LocalBuffer || GetLevelCount() == 1) return;
+
+    const size_t size = GetMipLevelOffset(m_Width, m_Height, m_Channels, GetLevelCount());
+    const uint64_t key = TextureCache::IsEnabled() ? TextureCache::GetKey(m_LocalBuffer, m_Width, m_Height, m_Channels, settings) : 0;
+    m_Mips = TextureCache::Load(key, size);
+    if (!m_Mips.empty()) return;
+
+    auto start = std::chrono::steady_clock::now();
+    m_Mips = BuildMipChain(m_LocalBuffer, m_Width, m_Height, m_Channels, settings);
+    TextureCache::Store(key, m_Mips, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+const uchar* Texture::GetLevelData(int level) const
+{
+    if (level == 0) return m_LocalBuffer;
+    return m_Mips.empty() ? nullptr : m_Mips.data() + GetMipLevelOffset(m_Width, m_Height, m_Channels, level);
+}
+
 void Texture::Free()
 {
+    m_Mips.clear();
     if (m_LocalBuffer)
     {
         stbi_image_free(m_LocalBuffer);
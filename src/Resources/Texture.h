@@ -1,11 +1,13 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <immintrin.h>
 
 #include <glm/glm.hpp>
 
 #include "../Types.h"
+#include "TextureMips.h"
 
 class Texture
 {
@@ -35,8 +37,16 @@ public:
     int GetHeight() const { return m_Height; }
     int GetChannels() const { return m_Channels; }
 
+    // levels 1.. (see TextureMips.h), from the texture cache or built. once the pixels are final,
+    // the asset load does it on its workers
+    void GenerateMips(const MipSettings& settings);
+    bool HasMips() const { return !m_Mips.empty(); }
+    int GetLevelCount() const { return GetMipLevelCount(m_Width, m_Height); }
+    const uchar* GetLevelData(int level) const;
+
 private:
     uchar* m_LocalBuffer = nullptr;
     int m_Width = 0, m_Height = 0, m_Channels = 0;
+    std::vector<uchar> m_Mips;
 
 };
\ No newline at end of file
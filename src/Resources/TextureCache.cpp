@@ -0,0 +1,204 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// four multiply / xorshift lanes over 32 byte blocks. a 4K texture is 64 MB, hashing it a byte
+// at a time (FNV-1a like the shader cache) would take longer than building its mips
+static uint64_t HashTextureCacheBytes(uint64_t seed, const uchar* data, size_t size)
+{
+    const uint64_t prime = 0x9e3779b97f4a7c15ull;
+    uint64_t lanes[4] = { seed, seed ^ 0x243f6a8885a308d3ull, seed ^ 0x13198a2e03707344ull, seed ^ 0xa4093822299f31d0ull };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * prime;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    uint64_t hash = seed ^ (size * prime);
+    for (uint64_t lane : lanes)
+    {
+        hash = (hash ^ lane) * prime;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+void TextureCache::SetDirectory(const std::string& directory)
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.Directory = directory;
+    state.Initialized = false;
+}
+
+bool TextureCache::Init()
+{
+    State& state = GetState();
+    if (state.Initialized) return state.Supported;
+    state.Initialized = true;
+    state.Supported = false;
+
+    if (state.Directory.empty()) return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(state.Directory, error);
+    if (error)
+    {
+        std::cout << "Texture cache: can't create " << state.Directory << " (" << error.message() << "), disabled" << std::endl;
+        return false;
+    }
+
+    state.Supported = true;
+    return true;
+}
+
+bool TextureCache::IsEnabled()
+{
+    std::lock_guard<std::mutex> lock(GetState().Mutex);
+    return Init();
+}
+
+uint64_t TextureCache::GetKey(const uchar* data, int width, int height, int channels, const MipSettings& settings)
+{
+    if (!data || std::max(width, height) < TEXTURE_CACHE_MIN_SIZE) return 0;
+
+    const uint32_t header[6] = { TEXTURE_CACHE_VERSION, (uint32_t)width, (uint32_t)height, (uint32_t)channels, (uint32_t)settings.Usage, settings.PreserveCoverage };
+    uint64_t seed = HashTextureCacheBytes(0xcbf29ce484222325ull, (const uchar*)header, sizeof(header));
+    uint64_t key = HashTextureCacheBytes(seed, data, (size_t)width * height * channels);
+    return key != 0 ? key : 1;
+}
+
+std::string TextureCache::GetPath(uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mips", (unsigned long long)key);
+    return (std::filesystem::path(GetState().Directory) / name).string();
+}
+
+std::vector<uchar> TextureCache::Load(uint64_t key, size_t size)
+{
+    State& state = GetState();
+    if (key == 0) return {};
+
+    auto start = std::chrono::steady_clock::now();
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        path = GetPath(key);
+    }
+
+    std::vector<uchar> chain;
+    float buildMs = 0.0f;
+    std::ifstream file(path, std::ios::binary);
+    if (file.is_open())
+    {
+        char magic[4];
+        uint32_t version = 0;
+        uint64_t storedKey = 0, length = 0;
+        file.read(magic, 4);
+        file.read((char*)&version, sizeof(version));
+        file.read((char*)&storedKey, sizeof(storedKey));
+        file.read((char*)&buildMs, sizeof(buildMs));
+        file.read((char*)&length, sizeof(length));
+
+        if (file && std::memcmp(magic, "ETMC", 4) == 0 && version == TEXTURE_CACHE_VERSION && storedKey == key && length == size)
+        {
+            chain.resize(size);
+            if (!file.read((char*)chain.data(), size)) chain.clear();
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    if (chain.empty())
+    {
+        state.Stats.Misses++;
+        return chain;
+    }
+
+    state.Stats.Hits++;
+    state.Stats.LoadMs += ms;
+    state.Stats.SavedMs += buildMs - ms;
+    return chain;
+}
+
+void TextureCache::Store(uint64_t key, const std::vector<uchar>& chain, double buildMs)
+{
+    State& state = GetState();
+    if (key == 0 || chain.empty()) return;
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        state.Stats.BuildMs += buildMs;
+        path = GetPath(key);
+    }
+
+    // written next to the target and renamed, a crash halfway never leaves a truncated entry. the
+    // same texture can be stored by two workers at once, each writes its own temporary
+    const std::string temporary = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        uint32_t version = TEXTURE_CACHE_VERSION;
+        uint64_t length = chain.size();
+        float ms = (float)buildMs;
+        file.write("ETMC", 4);
+        file.write((const char*)&version, sizeof(version));
+        file.write((const char*)&key, sizeof(key));
+        file.write((const char*)&ms, sizeof(ms));
+        file.write((const char*)&length, sizeof(length));
+        file.write((const char*)chain.data(), chain.size());
+        file.close();
+        if (file.fail())
+        {
+            std::cout << "Texture cache: failed writing " << temporary << std::endl;
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    state.Stats.Written++;
+}
+
+TextureCacheStats TextureCache::GetStats()
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    return state.Stats;
+}
+
+void TextureCache::PrintStats()
+{
+    TextureCacheStats stats = GetStats();
+    if (stats.Hits + stats.Misses == 0) return;
+
+    std::printf("Texture cache: %u hits, %u misses, %.1f ms loading, %.1f ms building, ~%.1f ms saved\n",
+                stats.Hits, stats.Misses, stats.LoadMs, stats.BuildMs, stats.SavedMs);
+    std::fflush(stdout);
+}
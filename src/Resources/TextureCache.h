@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../Types.h"
+#include "TextureMips.h"
+
+// mip chains from BuildMipChain saved next to the other cooked data, one file per texture in the
+// cache directory. the key hashes the level 0 texels, the size and the MipSettings, so an edited
+// image (or a differently packed ARM / alpha mask) simply misses. small textures build faster
+// than a file opens and aren't stored
+//   file: "ETMC" u32 version, u64 key, f32 build ms, u64 length, levels 1.. as BuildMipChain lays them out
+
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+constexpr int TEXTURE_CACHE_MIN_SIZE = 256;    // largest side
+
+struct TextureCacheStats
+{
+    uint Hits = 0;
+    uint Misses = 0;
+    uint Written = 0;
+    double LoadMs = 0.0;    // spent loading hits
+    double BuildMs = 0.0;   // spent building misses
+    double SavedMs = 0.0;   // what the hits took to build when they were stored, minus LoadMs
+};
+
+// Load and Store are called from the asset load's workers, the state is behind a mutex
+class TextureCache
+{
+
+public:
+    // empty disables the cache. set before assets load
+    static void SetDirectory(const std::string& directory);
+    static bool IsEnabled();
+
+    // 0 for textures too small to store
+    static uint64_t GetKey(const uchar* data, int width, int height, int channels, const MipSettings& settings);
+
+    // the chain, empty on a miss or when the stored one isn't size bytes
+    static std::vector<uchar> Load(uint64_t key, size_t size);
+    static void Store(uint64_t key, const std::vector<uchar>& chain, double buildMs);
+
+    static TextureCacheStats GetStats();
+    static void PrintStats();
+
+private:
+    struct State
+    {
+        std::string Directory = "texture_cache";
+        bool Initialized = false;
+        bool Supported = false;
+        std::mutex Mutex;
+        TextureCacheStats Stats;
+    };
+
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    // creates the directory on first use
+    static bool Init();
+    static std::string GetPath(uint64_t key);
+};
@@ -0,0 +1,406 @@
+#include "TextureMips.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// SSE2 is part of x86-64, AVX2 is compiled per function and only called after checking the cpu
+#if defined(__x86_64__) || defined(_M_X64)
+#define ECHO_MIPS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ECHO_MIPS_AVX2
+#else
+#define ECHO_MIPS_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// linear values are rounded to this many steps on the way back to srgb. adjacent dark bytes are
+// ~0.0003 apart in linear, 1/4095 keeps them apart
+constexpr int MIP_SRGB_STEPS = 4096;
+
+struct MipTables
+{
+    float ToLinear[256];
+    int ToSrgb[MIP_SRGB_STEPS];     // int for the gathers
+};
+
+static const MipTables& GetMipTables()
+{
+    static const MipTables tables = [] {
+        MipTables t;
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            t.ToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < MIP_SRGB_STEPS; ++i)
+        {
+            float l = i / (float)(MIP_SRGB_STEPS - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            t.ToSrgb[i] = (int)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+        }
+        return t;
+    }();
+    return tables;
+}
+
+static bool& GetMipSimdEnabled()
+{
+    static bool enabled = true;
+    return enabled;
+}
+
+static bool DetectMipAvx2()
+{
+#if !defined(ECHO_MIPS_X86)
+    return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    // the os has to save the ymm registers too (osxsave + xgetbv)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+void SetMipSimd(bool enabled)
+{
+    GetMipSimdEnabled() = enabled;
+}
+
+bool IsMipAvx2Available()
+{
+    static const bool available = DetectMipAvx2();
+    return available;
+}
+
+int GetMipLevelCount(int width, int height)
+{
+    const int size = std::max(width, height);
+    int count = 1;
+    while ((size >> count) > 0) count++;
+    return count;
+}
+
+int GetMipLevelSize(int size, int level)
+{
+    return std::max(1, size >> level);
+}
+
+size_t GetMipLevelBytes(int width, int height, int channels, int level)
+{
+    return (size_t)GetMipLevelSize(width, level) * GetMipLevelSize(height, level) * channels;
+}
+
+size_t GetMipLevelOffset(int width, int height, int channels, int level)
+{
+    size_t offset = 0;
+    for (int l = 1; l < level; ++l) offset += GetMipLevelBytes(width, height, channels, l);
+    return offset;
+}
+
+// output texels [begin, width) of a row, and every texel on cpus (or channel counts) without a
+// vector path. the sums are added in the same order as the AVX2 rows so both round the same
+static void DownsampleMipTexels(const uchar* row0, const uchar* row1, uchar* out, int sourceWidth, int begin, int width, int channels, TextureUsage usage)
+{
+    const MipTables& tables = GetMipTables();
+
+    for (int x = begin; x < width; ++x)
+    {
+        const int a = std::min(2 * x, sourceWidth - 1) * channels;
+        const int b = std::min(2 * x + 1, sourceWidth - 1) * channels;
+        uchar* texel = out + (size_t)x * channels;
+        int c = 0;
+
+        if (usage == TextureUsage::Albedo)
+        {
+            for (; c < 3; ++c)
+            {
+                float sum = (tables.ToLinear[row0[a + c]] + tables.ToLinear[row1[a + c]]) + (tables.ToLinear[row0[b + c]] + tables.ToLinear[row1[b + c]]);
+                texel[c] = (uchar)tables.ToSrgb[(int)(sum * (0.25f * (MIP_SRGB_STEPS - 1)) + 0.5f)];
+            }
+        }
+        else if (usage == TextureUsage::Normal)
+        {
+            float n[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                auto decode = [](uchar v) { return v * (2.0f / 255.0f) - 1.0f; };
+                n[i] = (decode(row0[a + i]) + decode(row1[a + i])) + (decode(row0[b + i]) + decode(row1[b + i]));
+            }
+
+            // opposite normals cancel out, point those straight out of the surface
+            float length2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+            if (length2 > 1e-8f)
+            {
+                float length = std::sqrt(length2);
+                for (int i = 0; i < 3; ++i) n[i] /= length;
+            }
+            else
+            {
+                n[0] = 0.0f; n[1] = 0.0f; n[2] = 1.0f;
+            }
+
+            for (; c < 3; ++c) texel[c] = (uchar)((n[c] * 0.5f + 0.5f) * 255.0f + 0.5f);
+        }
+
+        for (; c < channels; ++c)
+            texel[c] = (uchar)((row0[a + c] + row1[a + c] + row0[b + c] + row1[b + c] + 2) >> 2);
+    }
+}
+
+#ifdef ECHO_MIPS_X86
+
+// 8 ints (two texels, 0..255) to 8 bytes
+ECHO_MIPS_AVX2 static inline void StoreMipTexelsAvx2(uchar* out, __m256i values)
+{
+    // the packs work per 128 bit half, each half starts with its texel afterwards
+    __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(values, values), _mm256_setzero_si256());
+    uint32_t first = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+    uint32_t second = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+    std::memcpy(out, &first, 4);
+    std::memcpy(out + 4, &second, 4);
+}
+
+// rounded average of the four alpha bytes, in the alpha lanes
+ECHO_MIPS_AVX2 static inline __m256i AverageMipAlphaAvx2(__m256i a0, __m256i a1, __m256i b0, __m256i b1)
+{
+    __m256i sum0 = _mm256_add_epi32(a0, b0);
+    __m256i sum1 = _mm256_add_epi32(a1, b1);
+    __m256i sum = _mm256_add_epi32(_mm256_permute2x128_si256(sum0, sum1, 0x20), _mm256_permute2x128_si256(sum0, sum1, 0x31));
+    return _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(2)), 2);
+}
+
+// two output texels per iteration from 4 source texels of each row, one rgba texel per 128 bit
+// half. returns how many texels were done, the rest go through DownsampleMipTexels
+ECHO_MIPS_AVX2 static int DownsampleAlbedoRowAvx2(const uchar* row0, const uchar* row1, uchar* out, int width)
+{
+    const MipTables& tables = GetMipTables();
+    const __m256 scale = _mm256_set1_ps(0.25f * (MIP_SRGB_STEPS - 1));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    // alpha isn't gamma encoded, the gathers skip it
+    const __m256i rgb = _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m256 zero = _mm256_setzero_ps();
+
+    int x = 0;
+    for (; x + 2 <= width; x += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+        __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+        __m256i a0 = _mm256_cvtepu8_epi32(a);
+        __m256i a1 = _mm256_cvtepu8_epi32(_mm_srli_si128(a, 8));
+        __m256i b0 = _mm256_cvtepu8_epi32(b);
+        __m256i b1 = _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8));
+
+        // rows first, then the column pairs (0 + 1 and 2 + 3) meet in the same half
+        __m256 sum0 = _mm256_add_ps(_mm256_mask_i32gather_ps(zero, tables.ToLinear, a0, _mm256_castsi256_ps(rgb), 4),
+                                    _mm256_mask_i32gather_ps(zero, tables.ToLinear, b0, _mm256_castsi256_ps(rgb), 4));
+        __m256 sum1 = _mm256_add_ps(_mm256_mask_i32gather_ps(zero, tables.ToLinear, a1, _mm256_castsi256_ps(rgb), 4),
+                                    _mm256_mask_i32gather_ps(zero, tables.ToLinear, b1, _mm256_castsi256_ps(rgb), 4));
+        __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(sum0, sum1, 0x20), _mm256_permute2f128_ps(sum0, sum1, 0x31));
+
+        __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(sum, scale), half));
+        index = _mm256_min_epi32(index, _mm256_set1_epi32(MIP_SRGB_STEPS - 1));
+        __m256i color = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), tables.ToSrgb, index, rgb, 4);
+
+        StoreMipTexelsAvx2(out + x * 4, _mm256_blend_epi32(color, AverageMipAlphaAvx2(a0, a1, b0, b1), 0x88));
+    }
+    return x;
+}
+
+// byte to -1..1
+ECHO_MIPS_AVX2 static inline __m256 DecodeMipNormalAvx2(__m256i v)
+{
+    return _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(2.0f / 255.0f)), _mm256_set1_ps(1.0f));
+}
+
+ECHO_MIPS_AVX2 static int DownsampleNormalRowAvx2(const uchar* row0, const uchar* row1, uchar* out, int width)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 toByte = _mm256_set1_ps(255.0f);
+    const __m256 epsilon = _mm256_set1_ps(1e-8f);
+    const __m256 up = _mm256_setr_ps(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+
+    int x = 0;
+    for (; x + 2 <= width; x += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+        __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+        __m256i a0 = _mm256_cvtepu8_epi32(a);
+        __m256i a1 = _mm256_cvtepu8_epi32(_mm_srli_si128(a, 8));
+        __m256i b0 = _mm256_cvtepu8_epi32(b);
+        __m256i b1 = _mm256_cvtepu8_epi32(_mm_srli_si128(b, 8));
+
+        __m256 sum0 = _mm256_add_ps(DecodeMipNormalAvx2(a0), DecodeMipNormalAvx2(b0));
+        __m256 sum1 = _mm256_add_ps(DecodeMipNormalAvx2(a1), DecodeMipNormalAvx2(b1));
+        __m256 n = _mm256_add_ps(_mm256_permute2f128_ps(sum0, sum1, 0x20), _mm256_permute2f128_ps(sum0, sum1, 0x31));
+
+        // xyz dot product of each half, in all four of its lanes
+        __m256 length2 = _mm256_dp_ps(n, n, 0x7F);
+        n = _mm256_div_ps(n, _mm256_sqrt_ps(_mm256_max_ps(length2, epsilon)));
+        n = _mm256_blendv_ps(up, n, _mm256_cmp_ps(length2, epsilon, _CMP_GT_OQ));
+
+        __m256i color = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(n, half), half), toByte), half));
+        StoreMipTexelsAvx2(out + x * 4, _mm256_blend_epi32(color, AverageMipAlphaAvx2(a0, a1, b0, b1), 0x88));
+    }
+    return x;
+}
+
+#endif
+
+// data rows: the two source rows summed bytewise into 16 bit, then neighbouring texels averaged.
+// neither step cares what the channels are
+static void SumMipRows(const uchar* row0, const uchar* row1, ushort* sum, int bytes)
+{
+    int i = 0;
+#ifdef ECHO_MIPS_X86
+    if (GetMipSimdEnabled())
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= bytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(row0 + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(row1 + i));
+            _mm_storeu_si128((__m128i*)(sum + i), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+            _mm_storeu_si128((__m128i*)(sum + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+        }
+    }
+#endif
+    for (; i < bytes; ++i) sum[i] = (ushort)(row0[i] + row1[i]);
+}
+
+static void AverageMipColumns(const ushort* sum, uchar* out, int sourceWidth, int width, int channels)
+{
+    int x = 0;
+#ifdef ECHO_MIPS_X86
+    // rgba: 4 source texels (16 sums) make 2 output texels
+    if (channels == 4 && GetMipSimdEnabled())
+    {
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 2 <= width; x += 2)
+        {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(sum + x * 8));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(sum + x * 8 + 8));
+            lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+            __m128i texels = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), two), 2);
+            _mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(texels, texels));
+        }
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        const int a = std::min(2 * x, sourceWidth - 1) * channels;
+        const int b = std::min(2 * x + 1, sourceWidth - 1) * channels;
+        for (int c = 0; c < channels; ++c) out[x * channels + c] = (uchar)((sum[a + c] + sum[b + c] + 2) >> 2);
+    }
+}
+
+static void DownsampleMipRow(const uchar* row0, const uchar* row1, uchar* out, int sourceWidth, int width, int channels, TextureUsage usage, std::vector<ushort>& sum)
+{
+    if (usage == TextureUsage::Data)
+    {
+        SumMipRows(row0, row1, sum.data(), sourceWidth * channels);
+        AverageMipColumns(sum.data(), out, sourceWidth, width, channels);
+        return;
+    }
+
+    int done = 0;
+#ifdef ECHO_MIPS_X86
+    if (channels == 4 && GetMipSimdEnabled() && IsMipAvx2Available())
+        done = usage == TextureUsage::Albedo ? DownsampleAlbedoRowAvx2(row0, row1, out, width) : DownsampleNormalRowAvx2(row0, row1, out, width);
+#endif
+    DownsampleMipTexels(row0, row1, out, sourceWidth, done, width, channels, usage);
+}
+
+// fraction of the texels whose alpha, scaled, reaches the cutoff
+static float GetMipAlphaCoverage(const uint* histogram, size_t texels, float scale)
+{
+    size_t passed = 0;
+    for (int alpha = 0; alpha < 256; ++alpha)
+        if (alpha * scale >= MIP_ALPHA_CUTOFF * 255.0f) passed += histogram[alpha];
+    return passed / (float)texels;
+}
+
+static void BuildMipAlphaHistogram(const uchar* data, size_t texels, uint* histogram)
+{
+    std::fill(histogram, histogram + 256, 0u);
+    for (size_t i = 0; i < texels; ++i) histogram[data[i * 4 + 3]]++;
+}
+
+// Castaño's alpha test coverage: bisect for the alpha scale that gives this level the coverage of
+// level 0. all or nothing masks (and ones with no texel past the cutoff) are left alone
+static void PreserveMipAlphaCoverage(uchar* level, size_t texels, float target)
+{
+    if (target <= 0.0f || target >= 1.0f) return;
+
+    uint histogram[256];
+    BuildMipAlphaHistogram(level, texels, histogram);
+    if (std::abs(GetMipAlphaCoverage(histogram, texels, 1.0f) - target) <= 0.5f / texels) return;
+
+    float low = 0.0f, high = 4.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float middle = (low + high) * 0.5f;
+        if (GetMipAlphaCoverage(histogram, texels, middle) < target) low = middle;
+        else high = middle;
+    }
+
+    uchar scaled[256];
+    for (int alpha = 0; alpha < 256; ++alpha) scaled[alpha] = (uchar)std::min(255.0f, alpha * high + 0.5f);
+    for (size_t i = 0; i < texels; ++i) level[i * 4 + 3] = scaled[level[i * 4 + 3]];
+}
+
+std::vector<uchar> BuildMipChain(const uchar* source, int width, int height, int channels, const MipSettings& settings)
+{
+    const int levelCount = GetMipLevelCount(width, height);
+    if (!source || levelCount == 1 || channels <= 0) return {};
+
+    std::vector<uchar> chain(GetMipLevelOffset(width, height, channels, levelCount));
+
+    // the colour and normal filters need three channels to work on
+    const TextureUsage usage = channels >= 3 ? settings.Usage : TextureUsage::Data;
+    const bool coverage = settings.PreserveCoverage && channels == 4;
+
+    float targetCoverage = 0.0f;
+    if (coverage)
+    {
+        uint histogram[256];
+        BuildMipAlphaHistogram(source, (size_t)width * height, histogram);
+        targetCoverage = GetMipAlphaCoverage(histogram, (size_t)width * height, 1.0f);
+    }
+
+    std::vector<ushort> sum((size_t)width * channels);
+    const uchar* previous = source;
+    uchar* level = chain.data();
+
+    for (int l = 1; l < levelCount; ++l)
+    {
+        const int sourceWidth = GetMipLevelSize(width, l - 1);
+        const int sourceHeight = GetMipLevelSize(height, l - 1);
+        const int w = GetMipLevelSize(width, l);
+        const int h = GetMipLevelSize(height, l);
+        const size_t sourceStride = (size_t)sourceWidth * channels;
+
+        for (int y = 0; y < h; ++y)
+        {
+            const uchar* row0 = previous + std::min(2 * y, sourceHeight - 1) * sourceStride;
+            const uchar* row1 = previous + std::min(2 * y + 1, sourceHeight - 1) * sourceStride;
+            DownsampleMipRow(row0, row1, level + (size_t)y * w * channels, sourceWidth, w, channels, usage, sum);
+        }
+
+        if (coverage) PreserveMipAlphaCoverage(level, (size_t)w * h, targetCoverage);
+
+        previous = level;
+        level += (size_t)w * h * channels;
+    }
+
+    return chain;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../Types.h"
+
+// what a texture's texels mean, decides how four of them are averaged into one
+enum class TextureUsage
+{
+    Data,       // ao / roughness / metal and anything else: plain average
+    Albedo,     // srgb colour, averaged in linear. alpha is linear
+    Normal,     // tangent space normal in rgb, averaged then renormalized
+};
+
+// alpha the coverage preserving filter keeps the pass rate of. forward.frag blends rather than
+// cuts, this is where a mask reads as half covered
+constexpr float MIP_ALPHA_CUTOFF = 0.5f;
+
+struct MipSettings
+{
+    TextureUsage Usage = TextureUsage::Data;
+    // scale each level's alpha so as many texels pass MIP_ALPHA_CUTOFF as in level 0, for map_d
+    // masks that would otherwise thin out (foliage, fences) in the distance
+    bool PreserveCoverage = false;
+};
+
+int GetMipLevelCount(int width, int height);
+int GetMipLevelSize(int size, int level);
+size_t GetMipLevelBytes(int width, int height, int channels, int level);
+// where level (1..) starts in a chain from BuildMipChain
+size_t GetMipLevelOffset(int width, int height, int channels, int level);
+
+// levels 1.. one after another, tightly packed. level 0 is the source itself and isn't included.
+// 2x2 box per level from the one before it, the last row / column of a level with a side of 1 is
+// counted twice. 4 channel albedo and normal rows use AVX2 when the cpu has it, data rows SSE2
+std::vector<uchar> BuildMipChain(const uchar* source, int width, int height, int channels, const MipSettings& settings);
+
+// off forces the scalar paths, for comparing (EchoBench). the output is the same either way
+void SetMipSimd(bool enabled);
+bool IsMipAvx2Available();
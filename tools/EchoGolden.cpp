@@ -0,0 +1,252 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Core/Benchmark.h"
+#include "Core/GoldenTest.h"
+#include "Core/HeadlessContext.h"
+#include "Core/LaunchOptions.h"
+#include "Core/Profiler.h"
+#include "Renderer/ImageDiff.h"
+#include "Renderer/Renderer.h"
+
+// renders the views of a golden manifest (see Core/GoldenTest.h) offscreen, reads back the final
+// image and the gbuffer attachments and compares each against <references>/<view>_<target>.ppm.
+// every view is also timed like --benchmark, so a change is checked for speed and output in one run.
+// views run in manifest order on one renderer, history (shadow cache, sky probe...) carries over
+// the same way every run
+
+static void PrintGoldenUsage(const char* program)
+{
+    std::cout
+        << "usage: " << program << " [manifest] [options]\n"
+        << "  manifest            views and thresholds (assets/golden/views.txt)\n"
+        << "  --references <dir>  reference images (<manifest dir>/references)\n"
+        << "  --output <dir>      timings, summary and images of failed targets (golden_out)\n"
+        << "  --update            write the references instead of comparing\n"
+        << "exit codes as EchoEngine --benchmark, 7 when an image is off or has no reference" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string manifestPath = "assets/golden/views.txt";
+    std::string referenceDir;
+    std::string outputDir = "golden_out";
+    bool update = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintGoldenUsage(argv[0]);
+            return (int)ExitCode::Ok;
+        }
+        else if (arg == "--references" && hasValue) referenceDir = argv[++i];
+        else if (arg == "--output" && hasValue)     outputDir = argv[++i];
+        else if (arg == "--update")                 update = true;
+        else if (arg[0] != '-')                     manifestPath = arg;
+        else
+        {
+            std::cout << "Unknown or incomplete argument '" << arg << "'" << std::endl;
+            PrintGoldenUsage(argv[0]);
+            return (int)ExitCode::BadArguments;
+        }
+    }
+
+    GoldenManifest manifest;
+    if (!manifest.Load(manifestPath)) return (int)ExitCode::LoadFailed;
+
+    namespace fs = std::filesystem;
+    if (referenceDir.empty()) referenceDir = (fs::path(manifestPath).parent_path() / "references").string();
+
+    std::error_code error;
+    fs::create_directories(outputDir, error);
+    if (update) fs::create_directories(referenceDir, error);
+    if (error)
+    {
+        std::cout << "Golden: " << error.message() << std::endl;
+        return (int)ExitCode::WriteFailed;
+    }
+
+    Profiler::SetThreadName("Main");
+
+    GLFWwindow* window = CreateHeadlessWindow(manifest.Width, manifest.Height);
+    if (!window) return (int)ExitCode::NoContext;
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to init Glad\n";
+        return (int)ExitCode::NoContext;
+    }
+
+    // every scene stays loaded for the whole run, the static shadow cache keys on entity pointers
+    std::map<std::string, std::unique_ptr<Entity>> scenes;
+    for (const GoldenView& view : manifest.Views)
+    {
+        if (scenes.count(view.Scene)) continue;
+
+        std::unique_ptr<Entity> entity = std::make_unique<Entity>();
+        entity->LoadFromOBJ(view.Scene);
+        entity->isStatic = true;
+        if (!entity->meshAsset || entity->meshAsset->Vertices.empty())
+        {
+            std::cout << "Golden: " << view.Scene << " has no geometry, its views are skipped" << std::endl;
+            entity.reset();
+        }
+        scenes[view.Scene] = std::move(entity);
+    }
+
+    Camera camera;
+    SceneData scene;
+    scene.activeCamera = &camera;
+    scene.m_Sun.Direction = manifest.SunDirection;
+    scene.m_Sun.Color = glm::vec3(1.0f);
+    scene.m_Sun.Intensity = manifest.SunIntensity;
+    camera.SetProjectionMatrix((float)manifest.Width / (float)manifest.Height, camera.GetNear(), camera.GetFar());
+
+    // like the Application, never destroyed: its GL objects would outlive the context otherwise
+    Renderer* renderer = new Renderer();
+    renderer->SetScene(scene);
+    renderer->SetOffscreenOutput(true);
+    renderer->SetTargetReadback(true);
+    // the images mustn't depend on how far the uploads got
+    renderer->SetTextureStreaming(false);
+    renderer->Init(manifest.Width, manifest.Height);
+
+    const std::string glRenderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "Golden: " << glRenderer << ", " << manifest.Width << "x" << manifest.Height << ", " << manifest.Views.size() << " views, "
+              << (update ? "updating references in " : "comparing against ") << referenceDir << std::endl;
+
+    std::vector<GoldenViewSummary> summaries;
+    std::vector<GoldenResult> results;
+    uint glErrors = 0;
+    bool writeFailed = false;
+
+    for (const GoldenView& view : manifest.Views)
+    {
+        GoldenViewSummary& summary = summaries.emplace_back();
+        summary.View = view.Name;
+
+        Entity* entity = scenes[view.Scene].get();
+        if (!entity)
+        {
+            summary.Skipped = true;
+            continue;
+        }
+
+        scene.m_Entities = { entity };
+        camera.SetPosition(view.Position);
+        camera.SetYaw(view.Yaw);
+        camera.SetPitch(view.Pitch);
+
+        BenchmarkReport report;
+        report.Scene = view.Scene;
+        report.CameraPath = view.Name;
+        report.GLRenderer = glRenderer;
+        report.GLVersion = (const char*)glGetString(GL_VERSION);
+        report.Width = manifest.Width;
+        report.Height = manifest.Height;
+
+        {
+            BenchmarkRecorder recorder(manifest.WarmupFrames, manifest.MeasuredFrames);
+            while (!recorder.IsDone())
+            {
+                recorder.BeginFrame();
+                renderer->BeginFrame();
+                renderer->DrawScene();
+                renderer->EndFrame();
+                recorder.EndFrame();
+            }
+            recorder.Finish(report);
+        }
+
+        // one more frame of the same view for the readback, so the copies stay out of the timings
+        renderer->RequestTargetReadback();
+        renderer->BeginFrame();
+        renderer->DrawScene();
+        renderer->EndFrame();
+        Profiler::EndFrame();
+
+        std::vector<RenderTargetImage> images;
+        renderer->ReadbackTargets(images);
+
+        glErrors += report.GLErrors;
+        summary.FrameMs = ComputeBenchmarkStats(report.FrameMs).Avg;
+        for (const BenchmarkScope& scope : report.GpuScopes)
+        {
+            if (RenderProfiler::GetTimerMap()[scope.Name].Depth == 0) summary.GpuMs += ComputeBenchmarkStats(scope.Ms).Avg;
+        }
+        writeFailed |= !WriteBenchmarkReport(report, (fs::path(outputDir) / (view.Name + ".json")).string());
+
+        for (const RenderTargetImage& image : images)
+        {
+            const std::string fileName = view.Name + "_" + image.Name;
+            const std::string referencePath = (fs::path(referenceDir) / (fileName + ".ppm")).string();
+
+            GoldenResult& result = results.emplace_back();
+            result.View = view.Name;
+            result.Target = image.Name;
+            result.Threshold = manifest.GetThreshold(image.Name);
+
+            if (update)
+            {
+                result.HasReference = result.Passed = ImageDiff::WritePPM(referencePath, image.Pixels, manifest.Width, manifest.Height);
+                writeFailed |= !result.Passed;
+                continue;
+            }
+
+            std::vector<uint8_t> reference;
+            uint width = 0, height = 0;
+            result.HasReference = ImageDiff::ReadPPM(referencePath, reference, width, height) &&
+                                  width == (uint)manifest.Width && height == (uint)manifest.Height;
+
+            if (result.HasReference)
+            {
+                result.Diff = ImageDiff::Compare(reference, image.Pixels, width, height);
+                result.Passed = result.Diff.PSNR >= result.Threshold.MinPSNR &&
+                                result.Diff.SSIM >= result.Threshold.MinSSIM &&
+                                result.Diff.MaxError <= result.Threshold.MaxError;
+            }
+
+            if (result.Passed) continue;
+
+            std::cout << "Golden: " << fileName << (result.HasReference ? " differs" : " has no reference at this resolution");
+            if (result.HasReference) std::cout << ", psnr " << result.Diff.PSNR << " ssim " << result.Diff.SSIM << " max " << result.Diff.MaxError;
+            std::cout << std::endl;
+
+            fs::path out = fs::path(outputDir) / fileName;
+            ImageDiff::WritePPM(out.string() + ".ppm", image.Pixels, manifest.Width, manifest.Height);
+            if (result.HasReference) ImageDiff::WritePPM(out.string() + "_diff.ppm", result.Diff.Heatmap, manifest.Width, manifest.Height);
+        }
+
+        std::cout << "Golden: " << view.Name << " frame avg " << summary.FrameMs << " ms, gpu " << summary.GpuMs << " ms" << std::endl;
+    }
+
+    writeFailed |= !WriteGoldenSummary(summaries, results, (fs::path(outputDir) / "golden.json").string());
+
+    size_t failed = 0, skipped = 0;
+    for (const GoldenResult& result : results) failed += !result.Passed;
+    for (const GoldenViewSummary& summary : summaries) skipped += summary.Skipped;
+    std::cout << "Golden: " << results.size() - failed << "/" << results.size() << " images "
+              << (update ? "written" : "match") << ", " << skipped << " views skipped" << std::endl;
+
+    if (writeFailed) return (int)ExitCode::WriteFailed;
+    if (glErrors > 0)
+    {
+        std::cout << "Golden: " << glErrors << " GL errors" << std::endl;
+        return (int)ExitCode::GLErrors;
+    }
+    if (failed > 0) return (int)ExitCode::GoldenMismatch;
+
+    return (int)ExitCode::Ok;
+}
@@ -0,0 +1,142 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Core/Benchmark.h"
+#include "Core/HeadlessContext.h"
+#include "Core/LaunchOptions.h"
+#include "Core/Profiler.h"
+#include "Renderer/FrameCapture.h"
+#include "Renderer/Renderer.h"
+
+// feeds a frame capture (Renderer "Frame Capture" in the engine) to the renderer in a loop, no
+// window, input or ImGui. measured frame i is always capture frame i % count so the reports of two
+// builds line up frame by frame. output is the same JSON / CSV as --benchmark
+
+static void PrintReplayUsage(const char* program)
+{
+    std::cout
+        << "usage: " << program << " <capture.ecap> [options]\n"
+        << "  --loops <n>       times the capture is played while measuring (1)\n"
+        << "  --warmup <n>      frames played before measuring (60)\n"
+        << "  --width <px>      render width (the captured one)\n"
+        << "  --height <px>     render height (the captured one)\n"
+        << "  --output <json>   results, a .csv is written next to it (replay.json)\n"
+        << "exit codes as EchoEngine --benchmark, 6 when the draw commands differ from the capture" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string capturePath;
+    std::string outputPath = "replay.json";
+    int loops = 1;
+    int warmup = 60;
+    int width = 0;
+    int height = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintReplayUsage(argv[0]);
+            return (int)ExitCode::Ok;
+        }
+        else if (arg == "--loops" && hasValue)  loops = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue) warmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--width" && hasValue)  width = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--height" && hasValue) height = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--output" && hasValue) outputPath = argv[++i];
+        else if (arg[0] != '-' && capturePath.empty()) capturePath = arg;
+        else
+        {
+            std::cout << "Unknown or incomplete argument '" << arg << "'" << std::endl;
+            PrintReplayUsage(argv[0]);
+            return (int)ExitCode::BadArguments;
+        }
+    }
+
+    if (capturePath.empty())
+    {
+        PrintReplayUsage(argv[0]);
+        return (int)ExitCode::BadArguments;
+    }
+
+    Profiler::SetThreadName("Main");
+
+    // before the context, the captured resolution is needed to create it
+    FrameReplay* replay = new FrameReplay();
+    if (!replay->Load(capturePath)) return (int)ExitCode::LoadFailed;
+
+    if (width == 0) width = (int)replay->GetFrame(0).Width;
+    if (height == 0) height = (int)replay->GetFrame(0).Height;
+
+    GLFWwindow* window = CreateHeadlessWindow(width, height);
+    if (!window) return (int)ExitCode::NoContext;
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to init Glad\n";
+        return (int)ExitCode::NoContext;
+    }
+
+    // like the Application, never destroyed: its GL objects would outlive the context otherwise
+    Renderer* renderer = new Renderer();
+    const RenderSettings& first = replay->Apply(0);
+    renderer->SetScene(replay->GetScene());
+    renderer->SetOffscreenOutput(true);
+    renderer->Init(width, height);
+    renderer->ApplySettings(first);
+
+    const size_t frameCount = replay->GetFrameCount();
+    const int measured = (int)frameCount * loops;
+
+    BenchmarkReport report;
+    report.Scene = capturePath;
+    report.GLRenderer = (const char*)glGetString(GL_RENDERER);
+    report.GLVersion = (const char*)glGetString(GL_VERSION);
+    report.Width = width;
+    report.Height = height;
+
+    std::cout << "Replay: " << report.GLRenderer << ", " << width << "x" << height << ", " << frameCount << " captured frames, "
+              << warmup << " warmup + " << measured << " measured" << std::endl;
+
+    uint drawMismatches = 0;
+    BenchmarkRecorder recorder(warmup, measured);
+    for (int frame = 0; !recorder.IsDone(); ++frame)
+    {
+        const int index = recorder.GetMeasuredIndex();
+        const size_t captured = (size_t)(index >= 0 ? index : frame) % frameCount;
+        renderer->ApplySettings(replay->Apply(captured));
+
+        recorder.BeginFrame();
+        renderer->BeginFrame();
+        renderer->DrawScene();
+        if (renderer->GetDrawCmdCount() != replay->GetFrame(captured).DrawCount) drawMismatches++;
+        renderer->EndFrame();
+        recorder.EndFrame();
+    }
+    recorder.Finish(report);
+
+    // the workload is not the captured one, timings can't be compared to the other build's
+    if (drawMismatches)
+    {
+        std::cout << "Replay: " << drawMismatches << " frames built a different number of draw commands than captured" << std::endl;
+    }
+
+    BenchmarkStats frameStats = ComputeBenchmarkStats(report.FrameMs);
+    std::cout << "Replay: frame avg " << frameStats.Avg << " ms, p95 " << frameStats.P95 << " ms, p99 " << frameStats.P99 << " ms" << std::endl;
+
+    if (!WriteBenchmarkReport(report, outputPath)) return (int)ExitCode::WriteFailed;
+    if (report.GLErrors > 0) return (int)ExitCode::GLErrors;
+    if (drawMismatches > 0) return (int)ExitCode::ReplayMismatch;
+
+    return (int)ExitCode::Ok;
+}